@@ -5,10 +5,14 @@
 
 #include "console/Console.hpp"
 #include "core/Core.hpp"
+#include "core/FramePacer.hpp"
 #include "filesystem/FileSystem.hpp"
 #include "input/Input.hpp"
+#include "jobsystem/JobSystem.hpp"
 #include "assetmanager/ModelManager.hpp"
 #include "pluginsystem/PluginSystem.hpp"
+#include "pluginsystem/ApplicationUpdateGraph.hpp"
+#include "profiler/Profiler.hpp"
 
 #include "Engine.hpp"
 
@@ -42,3 +46,180 @@ bool Engine::Command_Quit( const ConsoleCommandArgs& args )
 	adm::Singleton<Engine>::GetInstance().shutdownRequested = true;
 	return true;
 }
+
+// ============================
+// Engine::Command_FrameStats
+// 
+// Prints how precisely frames start on time,
+// and starts measuring anew
+// ============================
+bool Engine::Command_FrameStats( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+	const FramePacerStatistics& statistics = self.framePacer.GetStatistics();
+
+	self.console.Print( adm::format( "Frame pacing over %u frames:", statistics.numFrames ) );
+	self.console.Print( adm::format( "   * mean error:         %.1f us", statistics.meanError ) );
+	self.console.Print( adm::format( "   * max error:          %.1f us", statistics.maxError ) );
+	self.console.Print( adm::format( "   * standard deviation: %.1f us", statistics.standardDeviation ) );
+	self.console.Print( adm::format( "   * missed frames:      %u", statistics.numMissedFrames ) );
+
+	self.framePacer.ResetStatistics();
+	return true;
+}
+
+// ============================
+// Engine::Command_LookupStats
+// 
+// Lookups only get this far if the file index
+// didn't have the path, so these are all misses
+// ============================
+bool Engine::Command_LookupStats( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+	const NegativeLookupCache& negativeLookups = self.fileSystem.GetNegativeLookupCache();
+
+	const size_t numHits = negativeLookups.GetNumHits();
+	const size_t numMisses = negativeLookups.GetNumMisses();
+	const double hitRate = numHits + numMisses > 0U ? 100.0 * numHits / (numHits + numMisses) : 0.0;
+
+	self.console.Print( "Failed path lookups:" );
+	self.console.Print( adm::format( "   * cached (hits):      %zu", numHits ) );
+	self.console.Print( adm::format( "   * checked on disk:    %zu", numMisses ) );
+	self.console.Print( adm::format( "   * hit rate:           %.1f%%", hitRate ) );
+	self.console.Print( adm::format( "   * cached paths:       %zu", negativeLookups.GetNumEntries() ) );
+	return true;
+}
+
+// ============================
+// Engine::Command_LookupBenchmark
+// 
+// Implementation of the "console_lookupBenchmark"
+// console command
+// ============================
+bool Engine::Command_LookupBenchmark( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+
+	const int numLookups = args.empty() ? 1000000 : std::atoi( args[0].c_str() );
+	if ( numLookups <= 0 )
+	{
+		self.console.Warning( "console_lookupBenchmark: the number of lookups must be greater than 0" );
+		return false;
+	}
+
+	self.console.RequestLookupBenchmark( static_cast<uint32_t>( numLookups ) );
+	return true;
+}
+
+// ============================
+// Engine::Command_PrintBenchmark
+// 
+// Implementation of the "console_printBenchmark"
+// console command
+// ============================
+bool Engine::Command_PrintBenchmark( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+
+	const int numLines = args.empty() ? 100000 : std::atoi( args[0].c_str() );
+	if ( numLines <= 0 )
+	{
+		self.console.Warning( "console_printBenchmark: the number of lines must be greater than 0" );
+		return false;
+	}
+
+	self.console.RequestPrintBenchmark( static_cast<uint32_t>( numLines ) );
+	return true;
+}
+
+// ============================
+// Engine::Command_IndexBenchmark
+// 
+// Implementation of the "fs_indexBenchmark"
+// console command
+// ============================
+bool Engine::Command_IndexBenchmark( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+
+	const int numLookups = args.empty() ? 1000000 : std::atoi( args[0].c_str() );
+	if ( numLookups <= 0 )
+	{
+		self.console.Warning( "fs_indexBenchmark: the number of lookups must be greater than 0" );
+		return false;
+	}
+
+	self.fileSystem.RequestIndexBenchmark( static_cast<uint32_t>( numLookups ) );
+	return true;
+}
+
+// ============================
+// Engine::Command_ModelBenchmark
+// 
+// Implementation of the "model_benchmark"
+// console command
+// ============================
+bool Engine::Command_ModelBenchmark( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+
+	if ( args.empty() )
+	{
+		self.console.Warning( "model_benchmark: no model path given" );
+		return false;
+	}
+
+	const int numModels = args.size() < 2U ? 100 : std::atoi( args[1].c_str() );
+	if ( numModels <= 0 )
+	{
+		self.console.Warning( "model_benchmark: the number of models must be greater than 0" );
+		return false;
+	}
+
+	self.modelManager.RequestLoadBenchmark( args[0], static_cast<uint32_t>( numModels ) );
+	return true;
+}
+
+// ============================
+// Engine::Command_ModelChurnBenchmark
+// 
+// Implementation of the "model_churnBenchmark"
+// console command
+// ============================
+bool Engine::Command_ModelChurnBenchmark( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+
+	const int numModels = args.empty() ? 10000 : std::atoi( args[0].c_str() );
+	const int numOperations = args.size() < 2U ? 100000 : std::atoi( args[1].c_str() );
+	if ( numModels <= 0 || numOperations < 0 )
+	{
+		self.console.Warning( "model_churnBenchmark: the number of models must be greater than 0" );
+		return false;
+	}
+
+	self.modelManager.RequestChurnBenchmark( static_cast<uint32_t>( numModels ), static_cast<uint32_t>( numOperations ) );
+	return true;
+}
+
+// ============================
+// Engine::Command_ProfileCapture
+// 
+// Implementation of the "profile_capture"
+// console command
+// ============================
+bool Engine::Command_ProfileCapture( const ConsoleCommandArgs& args )
+{
+	Engine& self = adm::Singleton<Engine>::GetInstance();
+
+	const int numFrames = args.empty() ? 1 : std::atoi( args[0].c_str() );
+	if ( numFrames <= 0 )
+	{
+		self.console.Warning( "profile_capture: the number of frames must be greater than 0" );
+		return false;
+	}
+
+	self.profiler.RequestCapture( numFrames );
+	return true;
+}
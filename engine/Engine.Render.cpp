@@ -5,10 +5,14 @@
 
 #include "console/Console.hpp"
 #include "core/Core.hpp"
+#include "core/FramePacer.hpp"
 #include "filesystem/FileSystem.hpp"
 #include "input/Input.hpp"
+#include "jobsystem/JobSystem.hpp"
 #include "assetmanager/ModelManager.hpp"
 #include "pluginsystem/PluginSystem.hpp"
+#include "pluginsystem/ApplicationUpdateGraph.hpp"
+#include "profiler/Profiler.hpp"
 
 #include "elegy-rhi/DeviceManager.hpp"
 
@@ -5,14 +5,25 @@
 
 #include "console/Console.hpp"
 #include "core/Core.hpp"
+#include "core/FramePacer.hpp"
 #include "filesystem/FileSystem.hpp"
 #include "input/Input.hpp"
+#include "jobsystem/JobSystem.hpp"
 #include "assetmanager/ModelManager.hpp"
 #include "pluginsystem/PluginSystem.hpp"
+#include "pluginsystem/ApplicationUpdateGraph.hpp"
+#include "profiler/Profiler.hpp"
 
 #include "Engine.hpp"
 
+#include <cmath>
+
 CVar engine_tickRate( "engine_tickRate", "144", 0, "Ticks per second, acts as a framerate cap too" );
+CVar engine_fixedTimestep( "engine_fixedTimestep", "0", 0, "Update applications in fixed steps of 1/engine_tickRate, decoupled from the frame rate" );
+CVar engine_maxCatchUpSteps( "engine_maxCatchUpSteps", "5", 0, "With engine_fixedTimestep, most steps per frame before the simulation gives up on catching up" );
+CVar engine_maxFps( "engine_maxFps", "0", 0, "With engine_fixedTimestep, caps the frame rate, 0 means uncapped if anything updates every frame, otherwise the tick rate" );
+CVar engine_framePacing( "engine_framePacing", "1", 0, "How to wait for the next tick: 0 = sleep, 1 = sleep then spin (precise), 2 = spin (burns a core)" );
+CVar engine_parallelUpdate( "engine_parallelUpdate", "1", 0, "Update independent applications in parallel, see 'applications' in plugins.json" );
 
 // ============================
 // GetEngineAPI
@@ -36,6 +47,9 @@ bool Engine::Init( int argc, char** argv )
 	console.Setup( &core );
 	console.Init( argc, argv );
 	console.Print( "Initing the engine..." );
+
+	profiler.Setup( &console );
+	profiler.SetThreadName( "Main thread" );
 	
 	// If this somehow happens, congrats
 	if ( !coreSuccess )
@@ -50,6 +64,15 @@ bool Engine::Init( int argc, char** argv )
 	// Let the core know if this instance is meant to be windowed or not
 	core.SetHeadless( args.GetBool( "-headless" ) );
 
+	// Worker threads for engine subsystems and plugins
+	// -jobWorkers 0 (the default) picks one per hardware thread, minus the main thread
+	jobSystem.Setup( &console );
+	if ( !jobSystem.Init( std::max( 0, std::atoi( args.GetCString( "-jobWorkers", "0" ) ) ) ) )
+	{
+		Shutdown( "job system failure" );
+		return false;
+	}
+
 	// Load the engine config file
 	engineConfig = EngineConfig( "engineConfig.json" );
 	if ( !engineConfig )
@@ -73,7 +96,7 @@ bool Engine::Init( int argc, char** argv )
 	String gameName = args.GetString( "-game", engineConfig.GetGameFolder().data() );
 
 	// Filesystem initialisation
-	fileSystem.Setup( &core, &console );
+	fileSystem.Setup( &core, &console, &jobSystem );
 	if ( !fileSystem.Init( gameName, engineConfig.GetEngineFolder() ) )
 	{
 		Shutdown( "filesystem failure" );
@@ -88,6 +111,30 @@ bool Engine::Init( int argc, char** argv )
 		return false;
 	}
 
+	// Plugins may create models from here on, the renderer is passed in once it's up
+	modelManager.Setup( &core, &console, &pluginSystem, &fileSystem, &jobSystem, nullptr );
+	modelManager.Init();
+
+	// Loader plugins may still be parsing models when they're unloaded, and the update
+	// graph points straight at applications, so it has to let go of them first
+	pluginSystem.SetUnloadCallback( [this]( IPlugin* plugin )
+		{
+			applicationUpdateGraph.Clear();
+			modelManager.OnPluginUnloading( plugin );
+		} );
+
+	// Libraries loaded or unloaded at runtime bring or take applications with them
+	pluginSystem.SetLibraryChangeCallback( [this]()
+		{
+			applicationUpdateGraph.Build( pluginSystem, &console );
+		} );
+
+	// Only does anything with fs_hotReload
+	fileSystem.WatchPath( "", [this]( const Path& path )
+		{
+			OnFileChanged( path );
+		} );
+
 	// Initialise pointers for API exchange
 	SetupAPIForExchange();
 
@@ -116,6 +163,7 @@ bool Engine::Init( int argc, char** argv )
 		// Now that the renderer is initialised, set up
 		// the API again so applications can use the renderer
 		SetupAPIForExchange();
+		modelManager.Setup( &core, &console, &pluginSystem, &fileSystem, &jobSystem, renderFrontend );
 	}
 
 	// Initialise applications and give them the engine API
@@ -125,6 +173,9 @@ bool Engine::Init( int argc, char** argv )
 		return false;
 	}
 
+	// Figure out which applications may update in parallel
+	applicationUpdateGraph.Build( pluginSystem, &console );
+
 	console.Print( adm::format( "Developer level: %i", core.DevLevel() ) );
 
 	// Start applications now that the engine is fully loaded
@@ -153,9 +204,13 @@ void Engine::Shutdown( const char* why )
 
 	console.Print( adm::format( "Engine: Shutting down, reason: %s", why ) );
 
+	applicationUpdateGraph.Clear();
+	modelManager.Shutdown();
 	pluginSystem.Shutdown();
 	input.Shutdown();
 	fileSystem.Shutdown();
+	jobSystem.Shutdown();
+	profiler.Shutdown();
 	console.Shutdown();
 	core.Shutdown();
 
@@ -175,35 +230,140 @@ const EngineAPI& Engine::GetAPI() const
 // ============================
 bool Engine::RunFrame()
 {
-	syncTimer.Reset();
+	profiler.BeginFrame();
 
 	// Update the keyboard state etc.
 	input.Update();
 
+	// Deliver finished async file reads
+	fileSystem.Update();
+	// Hand models that finished loading over to their owners
+	modelManager.Update();
+
+	const bool fixedTimestep = engine_fixedTimestep.GetBool();
+	const double tickTime = 1.0 / std::max( 1.0f, engine_tickRate.GetFloat() );
+
 	// Update games, apps, tools etc.
-	pluginSystem.ForEachPluginOfType<IApplication>( []( IApplication* plugin )
-		{
-			plugin->Update();
-		} );
+	if ( fixedTimestep )
+	{
+		RunFixedSteps( tickTime );
+	}
+	else
+	{
+		UpdateApplications();
+		core.SetInterpolationAlpha( 1.0f );
+	}
+
+	// Render, interpolate etc. once per frame, with the real frame time
+	UpdateFrameApplications();
 
 	// Update console listeners
 	console.Update();
 
-	// Normally we'd have more updating stuff here, so syncTimeElapsed would be significantly larger
-	// But, if it works, it works
-	const int syncTime = (1'000'000.0f / engine_tickRate.GetFloat());
-	int syncTimeElapsed = syncTimer.GetElapsed( adm::TimeUnits::Microseconds );
-	if ( syncTimeElapsed < syncTime )
+	// With a fixed timestep, the tick rate only applies to the simulation,
+	// frames can go as fast as engine_maxFps allows. Uncapped frames are only
+	// worth it if something draws them, otherwise we'd spin between steps
+	double frameTime = tickTime;
+	if ( fixedTimestep )
 	{
-		std::this_thread::sleep_for( chrono::microseconds( syncTime - syncTimeElapsed ) );
+		if ( engine_maxFps.GetFloat() > 0.0f )
+		{
+			frameTime = 1.0 / engine_maxFps.GetFloat();
+		}
+		else if ( applicationUpdateGraph.HasFrameApplications() && !core.IsHeadless() )
+		{
+			frameTime = 0.0;
+		}
 	}
 
-	deltaTime = syncTimer.GetElapsed( adm::TimeUnits::Seconds );
+	// Wait until the next frame is due
+	const FramePacingMode pacingMode = static_cast<FramePacingMode>( std::clamp( engine_framePacing.GetInt(), 0, 2 ) );
+
+	deltaTime = framePacer.WaitForNextFrame( frameTime, pacingMode );
 	core.SetDeltaTime( deltaTime );
 
+	profiler.EndFrame();
+
 	return !input.IsWindowClosing() && !shutdownRequested;
 }
 
+// ============================
+// Engine::UpdateApplications
+// ============================
+void Engine::UpdateApplications()
+{
+	BTX_PROFILE_FUNCTION();
+
+	// Ordering constraints are respected either way
+	if ( engine_parallelUpdate.GetBool() )
+	{
+		applicationUpdateGraph.Update( jobSystem );
+	}
+	else
+	{
+		applicationUpdateGraph.UpdateSerial();
+	}
+}
+
+// ============================
+// Engine::UpdateFrameApplications
+// ============================
+void Engine::UpdateFrameApplications()
+{
+	BTX_PROFILE_FUNCTION();
+
+	applicationUpdateGraph.UpdateFrame();
+}
+
+// ============================
+// Engine::RunFixedSteps
+// ============================
+void Engine::RunFixedSteps( double tickTime )
+{
+	// deltaTime is still the duration of the previous frame here
+	simulationAccumulator += deltaTime;
+
+	const int maxSteps = std::max( 1, engine_maxCatchUpSteps.GetInt() );
+	int numSteps = 0;
+
+	// Applications only ever see the fixed step as their delta time
+	core.SetDeltaTime( tickTime );
+	while ( simulationAccumulator >= tickTime && numSteps < maxSteps )
+	{
+		UpdateApplications();
+		simulationAccumulator -= tickTime;
+		numSteps++;
+	}
+
+	// The simulation can't keep up, so instead of spiralling into
+	// more and more steps per frame, let it run in slow motion
+	if ( simulationAccumulator >= tickTime )
+	{
+		simulationAccumulator = std::fmod( simulationAccumulator, tickTime );
+	}
+
+	// How far we are between the last and the next step,
+	// for the client to interpolate rendered state with
+	core.SetInterpolationAlpha( simulationAccumulator / tickTime );
+
+	// Listeners and such go by real time
+	core.SetDeltaTime( deltaTime );
+}
+
+// ============================
+// Engine::OnFileChanged
+// ============================
+void Engine::OnFileChanged( const Path& path )
+{
+	modelManager.OnFileChanged( path );
+
+	if ( pluginSystem.OnFileChanged( path ) )
+	{
+		applicationUpdateGraph.Clear();
+		applicationUpdateGraph.Build( pluginSystem, &console );
+	}
+}
+
 // ============================
 // Engine::SetupAPIForExchange
 // ============================
@@ -20,6 +20,33 @@ public:
 	static bool			Command_Quit( const ConsoleCommandArgs& args );
 	inline static CVar	quit = CVar( "quit", Engine::Command_Quit, "Quits the game." );
 
+	static bool			Command_FrameStats( const ConsoleCommandArgs& args );
+	inline static CVar	frameStats = CVar( "engine_frameStats", Engine::Command_FrameStats, "Prints frame pacing jitter since the last call." );
+
+	static bool			Command_LookupStats( const ConsoleCommandArgs& args );
+	inline static CVar	lookupStats = CVar( "fs_lookupStats", Engine::Command_LookupStats, "Prints how many failed path lookups were answered from the negative lookup cache." );
+
+	// Commands run on the main thread, but in the middle of the console's update, so the
+	// benchmarks and the profile capture below only ask for a run, see DeferredRequest
+	// They run during the next update of the subsystem in question, or the next frame
+	static bool			Command_LookupBenchmark( const ConsoleCommandArgs& args );
+	inline static CVar	lookupBenchmark = CVar( "console_lookupBenchmark", Engine::Command_LookupBenchmark, "Times finding, searching and re-registering console commands and variables. Usage: console_lookupBenchmark [numLookups]" );
+
+	static bool			Command_PrintBenchmark( const ConsoleCommandArgs& args );
+	inline static CVar	printBenchmark = CVar( "console_printBenchmark", Engine::Command_PrintBenchmark, "Times splitting large multi-line messages for the listeners and writing them out through the basic listener, with the output discarded. Usage: console_printBenchmark [numLines]" );
+
+	static bool			Command_IndexBenchmark( const ConsoleCommandArgs& args );
+	inline static CVar	indexBenchmark = CVar( "fs_indexBenchmark", Engine::Command_IndexBenchmark, "Times rescanning every mount and resolving paths with and without the file index. Usage: fs_indexBenchmark [numLookups]" );
+
+	static bool			Command_ModelBenchmark( const ConsoleCommandArgs& args );
+	inline static CVar	modelBenchmark = CVar( "model_benchmark", Engine::Command_ModelBenchmark, "Loads a model many times and prints how many models per second were loaded. Usage: model_benchmark modelPath [numModels]" );
+
+	static bool			Command_ModelChurnBenchmark( const ConsoleCommandArgs& args );
+	inline static CVar	modelChurnBenchmark = CVar( "model_churnBenchmark", Engine::Command_ModelChurnBenchmark, "Times creating, destroying and iterating over lots of models. Usage: model_churnBenchmark [numModels] [numOperations]" );
+
+	static bool			Command_ProfileCapture( const ConsoleCommandArgs& args );
+	inline static CVar	profileCapture = CVar( "profile_capture", Engine::Command_ProfileCapture, "Profiles the next N frames into a Chrome trace file. Usage: profile_capture numFrames" );
+
 private:
 	// Populates engineAPI with pointers to subsystems
 	void				SetupAPIForExchange();
@@ -30,6 +57,17 @@ private:
 	// Creates the main application window
 	bool				CreateWindow();
 
+	// Updates IApplication plugins once, in parallel if allowed
+	void				UpdateApplications();
+	// Updates IApplication plugins as many times as the accumulated
+	// frame time allows, see engine_fixedTimestep
+	void				RunFixedSteps( double tickTime );
+	// Updates IApplication plugins with updateEveryFrame in plugins.json, once per frame
+	// after the steps, so they can render with Core::InterpolationAlpha
+	void				UpdateFrameApplications();
+	// Passes hot-reloaded files on to the subsystems that use them
+	void				OnFileChanged( const Path& path );
+
 private: // Renderer backend stuff (Engine.Render.cpp)
 	// Initialises the render frontend plugin
 	// Not called in headless mode
@@ -43,18 +81,23 @@ private:
 	Core				core;
 	FileSystem			fileSystem;
 	Input				input;
+	JobSystem			jobSystem;
+	// Shared with the BTX_PROFILE_* macros
+	Profiler&			profiler{ adm::Singleton<Profiler>::GetInstance() };
 	ModelManager		modelManager;
 	PluginSystem		pluginSystem;
+	ApplicationUpdateGraph applicationUpdateGraph;
 	IRenderFrontend*	renderFrontend{ nullptr };
 	RenderBackend*		renderBackendManager{ nullptr };
 
 	EngineAPI			engineAPI;
 	EngineConfig		engineConfig;
 
-	// Synchronisation timer, works kinda like V-sync but more flexible
-	// Sync time is in microseconds
-	TimerPreciseDouble	syncTimer;
+	// Caps the tick rate, works kinda like V-sync but more flexible
+	FramePacer			framePacer;
 	float				deltaTime{ 0.0f };
+	// Frame time that hasn't been simulated yet, with engine_fixedTimestep
+	double				simulationAccumulator{ 0.0 };
 	// The application requested a shutdown, so Shutdown will be called
 	bool				shutdownRequested{ false };
 	// Shutdown could be potentially called twice, so this prevents it
@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// IModelLoader
+//
+// Plugin interface for model file formats, the model manager picks
+// a loader by the file's extension, reads the file through the
+// filesystem and hands the contents over to the loader
+//
+// LoadModel is called from worker threads, possibly for several files
+// at once, so it must only touch its arguments and thread-safe APIs
+// ============================
+class IModelLoader : public IPlugin
+{
+public:
+	static constexpr const char* Name = "IModelLoader";
+
+	const char*			GetInterfaceName() const override
+	{
+		return Name;
+	}
+
+	// Lowercase, without the dot, e.g. "obj"
+	virtual bool		SupportsExtension( StringView extension ) const = 0;
+
+	// Path is relative to the mounts, for error messages
+	// Returns false if the file is faulty
+	virtual bool		LoadModel( const uint8_t* data, size_t size, StringView path, RenderData::Model& outModel ) = 0;
+};
@@ -7,7 +7,7 @@
 using namespace Assets;
 
 Model::Model( const ModelDesc& modelDesc )
-	: desc( modelDesc )
+	: desc( modelDesc ), loadState( modelDesc.modelPath.empty() ? LoadState::Loaded : LoadState::Loading )
 {
 
 }
@@ -31,3 +31,33 @@ const ModelDesc& Model::GetDesc() const
 {
 	return desc;
 }
+
+void Model::SetCompiledData( FileView compiledData )
+{
+	this->compiledData = std::move( compiledData );
+}
+
+const FileView& Model::GetCompiledData() const
+{
+	return compiledData;
+}
+
+LoadState Model::GetLoadState() const
+{
+	return loadState;
+}
+
+void Model::SetLoadState( LoadState state )
+{
+	loadState = state;
+}
+
+uint32_t Model::GetDataRevision() const
+{
+	return dataRevision;
+}
+
+void Model::OnDataChanged()
+{
+	dataRevision++;
+}
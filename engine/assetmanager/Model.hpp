@@ -3,8 +3,19 @@
 
 #pragma once
 
+#include "../filesystem/FileView.hpp"
+
 namespace Assets
 {
+	enum class LoadState : uint8_t
+	{
+		// Waiting for its file, streamed models show the placeholder meanwhile
+		Loading,
+		// Models that aren't from a file are always loaded
+		Loaded,
+		Failed
+	};
+
 	class Model : public IModel
 	{
 	public:
@@ -22,7 +33,25 @@ namespace Assets
 		ModelDesc&			GetDesc() override;
 		const ModelDesc&	GetDesc() const override;
 
+		// Models in the engine's own format keep their compiled file
+		// around (see ModelFormat.hpp), its vertex and index data are
+		// used in place. Invalid for models loaded by plugins
+		void				SetCompiledData( FileView compiledData );
+		const FileView&		GetCompiledData() const;
+
+		// A loaded model that's being reloaded stays Loaded, with its old data until the new data is in
+		LoadState			GetLoadState() const;
+		void				SetLoadState( LoadState state );
+
+		// Goes up whenever the model manager swaps in other data (the placeholder, the
+		// loaded model, a reload), so renderers can tell when to rebuild their buffers
+		uint32_t			GetDataRevision() const;
+		void				OnDataChanged();
+
 	private:
 		ModelDesc			desc;
+		FileView			compiledData;
+		LoadState			loadState{ LoadState::Loaded };
+		uint32_t			dataRevision{ 0U };
 	};
 }
@@ -0,0 +1,461 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// Shared with tools/ModelCooker, so it sticks to the standard library
+#include "ModelFormat.hpp"
+#include "../filesystem/ContentHash.hpp"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// ============================
+// BtxModel text compiler
+//
+// Turns the text format (.btm) into the compiled format (.btmc)
+// Only meshes are supported so far, other top-level blocks
+// (bones, animations...) are skipped and counted
+// ============================
+namespace BtxModel
+{
+	struct TextSurface
+	{
+		std::string		material;
+		// Relative to the mesh's first vertex
+		std::vector<uint32_t> indices;
+	};
+
+	struct TextMesh
+	{
+		std::string		name;
+		std::vector<Vertex> vertices;
+		std::vector<TextSurface> surfaces;
+	};
+
+	struct TextModel
+	{
+		std::vector<TextMesh> meshes;
+		uint32_t		numSkippedBlocks{ 0U };
+	};
+
+	// ============================
+	// TextReader
+	//
+	// Splits the text into words, quoted strings and braces,
+	// skipping whitespace and // comments
+	// ============================
+	class TextReader final
+	{
+	public:
+		TextReader( std::string_view modelText )
+			: text( modelText )
+		{
+		}
+
+		// Returns an empty token at the end
+		std::string_view Next()
+		{
+			SkipWhitespaceAndComments();
+			if ( position >= text.size() )
+			{
+				return {};
+			}
+
+			const size_t start = position;
+			if ( text[position] == '{' || text[position] == '}' )
+			{
+				position++;
+				return text.substr( start, 1U );
+			}
+
+			// Quotes are part of the token, so "" isn't mistaken for the end
+			if ( text[position] == '"' )
+			{
+				const size_t end = text.find( '"', position + 1U );
+				position = end == std::string_view::npos ? text.size() : end + 1U;
+				return text.substr( start, position - start );
+			}
+
+			while ( position < text.size() && !IsSpace( text[position] ) && text[position] != '{' && text[position] != '}' )
+			{
+				position++;
+			}
+
+			return text.substr( start, position - start );
+		}
+
+		std::string_view Peek()
+		{
+			const size_t oldPosition = position;
+			const uint32_t oldLine = line;
+			const std::string_view token = Next();
+			position = oldPosition;
+			line = oldLine;
+			return token;
+		}
+
+		uint32_t		GetLine() const
+		{
+			return line;
+		}
+
+		static bool		IsQuoted( std::string_view token )
+		{
+			return token.size() >= 2U && token.front() == '"' && token.back() == '"';
+		}
+
+		static std::string_view Unquote( std::string_view token )
+		{
+			return IsQuoted( token ) ? token.substr( 1U, token.size() - 2U ) : token;
+		}
+
+	private:
+		static bool		IsSpace( char character )
+		{
+			return character == ' ' || character == '\t' || character == '\r' || character == '\n';
+		}
+
+		void			SkipWhitespaceAndComments()
+		{
+			while ( position < text.size() )
+			{
+				if ( text[position] == '\n' )
+				{
+					line++;
+				}
+
+				if ( IsSpace( text[position] ) )
+				{
+					position++;
+				}
+				else if ( text.substr( position, 2U ) == "//" )
+				{
+					while ( position < text.size() && text[position] != '\n' )
+					{
+						position++;
+					}
+				}
+				else
+				{
+					break;
+				}
+			}
+		}
+
+	private:
+		std::string_view text;
+		size_t			position{ 0U };
+		uint32_t		line{ 1U };
+	};
+
+	namespace Detail
+	{
+		inline bool Fail( const TextReader& reader, const std::string& message, std::string& outError )
+		{
+			outError = "line " + std::to_string( reader.GetLine() ) + ": " + message;
+			return false;
+		}
+
+		inline bool Expect( TextReader& reader, std::string_view expected, std::string& outError )
+		{
+			const std::string_view token = reader.Next();
+			if ( token != expected )
+			{
+				return Fail( reader, "expected '" + std::string( expected ) + "', got '" + std::string( token ) + "'", outError );
+			}
+
+			return true;
+		}
+
+		template<typename T>
+		inline bool ParseNumber( std::string_view token, T& outNumber )
+		{
+			// Tokens aren't null-terminated, and numbers are short
+			char buffer[64];
+			if ( token.empty() || token.size() >= sizeof( buffer ) )
+			{
+				return false;
+			}
+
+			std::memcpy( buffer, token.data(), token.size() );
+			buffer[token.size()] = '\0';
+
+			char* end = nullptr;
+			if constexpr ( std::is_floating_point_v<T> )
+			{
+				outNumber = static_cast<T>( std::strtod( buffer, &end ) );
+			}
+			else
+			{
+				if ( buffer[0] == '-' )
+				{
+					return false;
+				}
+
+				const unsigned long long value = std::strtoull( buffer, &end, 10 );
+				if ( value > UINT32_MAX )
+				{
+					return false;
+				}
+				outNumber = static_cast<T>( value );
+			}
+
+			return end == buffer + token.size();
+		}
+
+		// Skips a block whose opening brace was already read
+		inline bool SkipBlock( TextReader& reader, std::string& outError )
+		{
+			for ( uint32_t depth = 1U; depth > 0U; )
+			{
+				const std::string_view token = reader.Next();
+				if ( token.empty() )
+				{
+					return Fail( reader, "unexpected end of file, missing '}'", outError );
+				}
+
+				depth += token == "{" ? 1U : 0U;
+				depth -= token == "}" ? 1U : 0U;
+			}
+
+			return true;
+		}
+
+		inline bool ParseVertices( TextReader& reader, TextMesh& mesh, std::string& outError )
+		{
+			if ( !Expect( reader, "{", outError ) )
+			{
+				return false;
+			}
+
+			while ( reader.Peek() != "}" )
+			{
+				Vertex vertex{};
+				float* components[8] = { &vertex.position[0], &vertex.position[1], &vertex.position[2],
+					&vertex.normal[0], &vertex.normal[1], &vertex.normal[2], &vertex.uv[0], &vertex.uv[1] };
+
+				for ( float* component : components )
+				{
+					const std::string_view token = reader.Next();
+					if ( !ParseNumber( token, *component ) )
+					{
+						return Fail( reader, "expected a number for a vertex (x y z nx ny nz u v), got '" + std::string( token ) + "'", outError );
+					}
+				}
+
+				mesh.vertices.push_back( vertex );
+			}
+
+			reader.Next();
+			return true;
+		}
+
+		inline bool ParseSurface( TextReader& reader, TextMesh& mesh, std::string& outError )
+		{
+			const std::string_view material = reader.Next();
+			if ( !TextReader::IsQuoted( material ) )
+			{
+				return Fail( reader, "expected a quoted material name after 'surface'", outError );
+			}
+
+			if ( !Expect( reader, "{", outError ) )
+			{
+				return false;
+			}
+
+			TextSurface& surface = mesh.surfaces.emplace_back();
+			surface.material = TextReader::Unquote( material );
+			while ( reader.Peek() != "}" )
+			{
+				const std::string_view token = reader.Next();
+				uint32_t index = 0U;
+				if ( !ParseNumber( token, index ) )
+				{
+					return Fail( reader, "expected a vertex index, got '" + std::string( token ) + "'", outError );
+				}
+
+				surface.indices.push_back( index );
+			}
+			reader.Next();
+
+			if ( surface.indices.size() % 3U != 0U )
+			{
+				return Fail( reader, "surface '" + surface.material + "' doesn't consist of whole triangles", outError );
+			}
+
+			return true;
+		}
+
+		inline bool ParseMesh( TextReader& reader, TextModel& model, std::string& outError )
+		{
+			const std::string_view name = reader.Next();
+			if ( !TextReader::IsQuoted( name ) )
+			{
+				return Fail( reader, "expected a quoted name after 'mesh'", outError );
+			}
+
+			if ( !Expect( reader, "{", outError ) )
+			{
+				return false;
+			}
+
+			TextMesh& mesh = model.meshes.emplace_back();
+			mesh.name = TextReader::Unquote( name );
+			while ( true )
+			{
+				const std::string_view token = reader.Next();
+				if ( token == "}" )
+				{
+					break;
+				}
+
+				if ( token == "vertices" )
+				{
+					if ( !ParseVertices( reader, mesh, outError ) )
+					{
+						return false;
+					}
+				}
+				else if ( token == "surface" )
+				{
+					if ( !ParseSurface( reader, mesh, outError ) )
+					{
+						return false;
+					}
+				}
+				else
+				{
+					return Fail( reader, "unknown mesh element '" + std::string( token ) + "'", outError );
+				}
+			}
+
+			for ( const TextSurface& surface : mesh.surfaces )
+			{
+				for ( const uint32_t index : surface.indices )
+				{
+					if ( index >= mesh.vertices.size() )
+					{
+						return Fail( reader, "mesh '" + mesh.name + "' has an index out of range: " + std::to_string( index ), outError );
+					}
+				}
+			}
+
+			return true;
+		}
+	}
+
+	// Returns false and describes the problem in outError if the text is faulty
+	inline bool ParseText( std::string_view text, TextModel& outModel, std::string& outError )
+	{
+		TextReader reader( text );
+		while ( true )
+		{
+			const std::string_view token = reader.Next();
+			if ( token.empty() )
+			{
+				return true;
+			}
+
+			if ( token == "mesh" )
+			{
+				if ( !Detail::ParseMesh( reader, outModel, outError ) )
+				{
+					return false;
+				}
+				continue;
+			}
+
+			// Not supported yet: keyword, optional name, then a block
+			if ( TextReader::IsQuoted( reader.Peek() ) )
+			{
+				reader.Next();
+			}
+
+			if ( !Detail::Expect( reader, "{", outError ) || !Detail::SkipBlock( reader, outError ) )
+			{
+				return false;
+			}
+
+			outModel.numSkippedBlocks++;
+		}
+	}
+
+	// Returns the compiled model, see Header
+	inline std::vector<uint8_t> Compile( const TextModel& model, uint64_t sourceSize, uint64_t sourceHash )
+	{
+		std::vector<Mesh> meshes;
+		std::vector<Surface> surfaces;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::string strings;
+
+		for ( const TextMesh& textMesh : model.meshes )
+		{
+			Mesh& mesh = meshes.emplace_back();
+			mesh.nameOffset = static_cast<uint32_t>( strings.size() );
+			mesh.nameLength = static_cast<uint32_t>( textMesh.name.size() );
+			mesh.firstVertex = static_cast<uint32_t>( vertices.size() );
+			mesh.numVertices = static_cast<uint32_t>( textMesh.vertices.size() );
+			mesh.firstSurface = static_cast<uint32_t>( surfaces.size() );
+			mesh.numSurfaces = static_cast<uint32_t>( textMesh.surfaces.size() );
+			strings += textMesh.name;
+			vertices.insert( vertices.end(), textMesh.vertices.begin(), textMesh.vertices.end() );
+
+			for ( const TextSurface& textSurface : textMesh.surfaces )
+			{
+				Surface& surface = surfaces.emplace_back();
+				surface.materialOffset = static_cast<uint32_t>( strings.size() );
+				surface.materialLength = static_cast<uint32_t>( textSurface.material.size() );
+				surface.firstIndex = static_cast<uint32_t>( indices.size() );
+				surface.numIndices = static_cast<uint32_t>( textSurface.indices.size() );
+				strings += textSurface.material;
+				indices.insert( indices.end(), textSurface.indices.begin(), textSurface.indices.end() );
+			}
+		}
+
+		Header header{};
+		std::memcpy( header.magic, Magic, sizeof( Magic ) );
+		header.version = Version;
+		header.numMeshes = static_cast<uint32_t>( meshes.size() );
+		header.numSurfaces = static_cast<uint32_t>( surfaces.size() );
+		header.numVertices = static_cast<uint32_t>( vertices.size() );
+		header.numIndices = static_cast<uint32_t>( indices.size() );
+		header.stringTableSize = static_cast<uint32_t>( strings.size() );
+		header.vertexStride = sizeof( Vertex );
+		header.sourceSize = sourceSize;
+		header.sourceHash = sourceHash;
+
+		header.meshTableOffset = sizeof( Header );
+		header.surfaceTableOffset = header.meshTableOffset + meshes.size() * sizeof( Mesh );
+		header.stringTableOffset = header.surfaceTableOffset + surfaces.size() * sizeof( Surface );
+		header.vertexDataOffset = Align( header.stringTableOffset + strings.size() );
+		header.indexDataOffset = Align( header.vertexDataOffset + vertices.size() * sizeof( Vertex ) );
+
+		// Zeroes in the padding keep the output reproducible
+		std::vector<uint8_t> output( header.indexDataOffset + indices.size() * sizeof( uint32_t ), 0U );
+		const auto write = [&output]( uint64_t offset, const void* data, size_t size )
+		{
+			if ( size > 0U )
+			{
+				std::memcpy( output.data() + offset, data, size );
+			}
+		};
+
+		write( 0U, &header, sizeof( header ) );
+		write( header.meshTableOffset, meshes.data(), meshes.size() * sizeof( Mesh ) );
+		write( header.surfaceTableOffset, surfaces.data(), surfaces.size() * sizeof( Surface ) );
+		write( header.stringTableOffset, strings.data(), strings.size() );
+		write( header.vertexDataOffset, vertices.data(), vertices.size() * sizeof( Vertex ) );
+		write( header.indexDataOffset, indices.data(), indices.size() * sizeof( uint32_t ) );
+		return output;
+	}
+
+	// True if the compiled model is damaged, of another version, or wasn't compiled from this source
+	inline bool IsStale( const uint8_t* compiled, size_t compiledSize, const uint8_t* source, size_t sourceSize )
+	{
+		const Header* header = ReadHeader( compiled, compiledSize );
+		return nullptr == header || header->sourceSize != sourceSize || header->sourceHash != ContentHash::Hash( source, sourceSize );
+	}
+}
@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// This header is shared with tools/ModelCooker, which doesn't
+// link against anything, so it sticks to the standard library
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// ============================
+// BTX compiled model format (.btmc)
+//
+// Compiled from the text format (.btm, see docs/Spec-ModelFormat.md),
+// meant to be memory-mapped and used in place:
+//   [Header] [Mesh table] [Surface table] [strings] [vertex data] [index data]
+//
+// Vertex and index data start at multiples of DataAlignment, and can be
+// uploaded to the GPU as they are: vertices are interleaved Vertex structs,
+// indices are 32-bit triangle lists, relative to their mesh's first vertex
+// Strings are not null-terminated
+//
+// The header remembers the size and hash (ContentHash) of the text model
+// it was compiled from, so a compiled model whose source has changed since,
+// or which was compiled into an older version of this format, is stale
+//
+// All numbers are little-endian
+// ============================
+namespace BtxModel
+{
+	constexpr char Magic[6] = { 'B', 'T', 'X', 'M', 'D', 'L' };
+	constexpr uint8_t Version = 1U;
+	constexpr uint64_t DataAlignment = 64U;
+	constexpr std::string_view TextExtension = ".btm";
+	constexpr std::string_view CompiledExtension = ".btmc";
+
+	struct Header
+	{
+		char			magic[6];
+		uint8_t			version;
+		uint8_t			reserved;
+		uint32_t		numMeshes;
+		uint32_t		numSurfaces;
+		uint32_t		numVertices;
+		uint32_t		numIndices;
+		uint32_t		stringTableSize;
+		// sizeof( Vertex ), so a different vertex layout is caught early
+		uint32_t		vertexStride;
+		uint64_t		meshTableOffset;
+		uint64_t		surfaceTableOffset;
+		uint64_t		stringTableOffset;
+		uint64_t		vertexDataOffset;
+		uint64_t		indexDataOffset;
+		// Of the text model this was compiled from
+		uint64_t		sourceSize;
+		uint64_t		sourceHash;
+	};
+	static_assert( sizeof( Header ) == 88U );
+
+	struct Mesh
+	{
+		uint32_t		nameOffset;
+		uint32_t		nameLength;
+		uint32_t		firstVertex;
+		uint32_t		numVertices;
+		uint32_t		firstSurface;
+		uint32_t		numSurfaces;
+	};
+	static_assert( sizeof( Mesh ) == 24U );
+
+	struct Surface
+	{
+		uint32_t		materialOffset;
+		uint32_t		materialLength;
+		// Into the model's index data
+		uint32_t		firstIndex;
+		uint32_t		numIndices;
+	};
+	static_assert( sizeof( Surface ) == 16U );
+
+	struct Vertex
+	{
+		float			position[3];
+		float			normal[3];
+		float			uv[2];
+	};
+	static_assert( sizeof( Vertex ) == 32U );
+
+	inline uint64_t Align( uint64_t offset )
+	{
+		return (offset + DataAlignment - 1U) & ~(DataAlignment - 1U);
+	}
+
+	// Returns nullptr if the data isn't a valid compiled model of this version
+	// Every table, mesh, surface and index is checked, so the GPU
+	// never gets to see an index that's out of range
+	inline const Header* ReadHeader( const uint8_t* data, size_t size )
+	{
+		if ( size < sizeof( Header ) )
+		{
+			return nullptr;
+		}
+
+		const Header* header = reinterpret_cast<const Header*>( data );
+		if ( std::memcmp( header->magic, Magic, sizeof( Magic ) ) != 0 || header->version != Version || header->vertexStride != sizeof( Vertex ) )
+		{
+			return nullptr;
+		}
+
+		const auto fits = [size]( uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t alignment )
+		{
+			return offset % alignment == 0U && offset <= size && count <= (size - offset) / elementSize;
+		};
+
+		if ( !fits( header->meshTableOffset, header->numMeshes, sizeof( Mesh ), alignof( Mesh ) )
+			|| !fits( header->surfaceTableOffset, header->numSurfaces, sizeof( Surface ), alignof( Surface ) )
+			|| !fits( header->stringTableOffset, header->stringTableSize, 1U, 1U )
+			|| !fits( header->vertexDataOffset, header->numVertices, sizeof( Vertex ), DataAlignment )
+			|| !fits( header->indexDataOffset, header->numIndices, sizeof( uint32_t ), DataAlignment ) )
+		{
+			return nullptr;
+		}
+
+		const Mesh* meshes = reinterpret_cast<const Mesh*>( data + header->meshTableOffset );
+		const Surface* surfaces = reinterpret_cast<const Surface*>( data + header->surfaceTableOffset );
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>( data + header->indexDataOffset );
+		for ( uint32_t meshIndex = 0U; meshIndex < header->numMeshes; meshIndex++ )
+		{
+			const Mesh& mesh = meshes[meshIndex];
+			if ( uint64_t( mesh.nameOffset ) + mesh.nameLength > header->stringTableSize
+				|| uint64_t( mesh.firstVertex ) + mesh.numVertices > header->numVertices
+				|| uint64_t( mesh.firstSurface ) + mesh.numSurfaces > header->numSurfaces )
+			{
+				return nullptr;
+			}
+
+			for ( uint32_t surfaceIndex = mesh.firstSurface; surfaceIndex < mesh.firstSurface + mesh.numSurfaces; surfaceIndex++ )
+			{
+				const Surface& surface = surfaces[surfaceIndex];
+				if ( uint64_t( surface.materialOffset ) + surface.materialLength > header->stringTableSize
+					|| uint64_t( surface.firstIndex ) + surface.numIndices > header->numIndices )
+				{
+					return nullptr;
+				}
+
+				for ( uint32_t i = surface.firstIndex; i < surface.firstIndex + surface.numIndices; i++ )
+				{
+					if ( indices[i] >= mesh.numVertices )
+					{
+						return nullptr;
+					}
+				}
+			}
+		}
+
+		return header;
+	}
+
+	// The header must've been validated by ReadHeader
+	inline const Mesh* GetMeshes( const uint8_t* data, const Header& header )
+	{
+		return reinterpret_cast<const Mesh*>( data + header.meshTableOffset );
+	}
+
+	inline const Surface* GetSurfaces( const uint8_t* data, const Header& header )
+	{
+		return reinterpret_cast<const Surface*>( data + header.surfaceTableOffset );
+	}
+
+	inline const Vertex* GetVertices( const uint8_t* data, const Header& header )
+	{
+		return reinterpret_cast<const Vertex*>( data + header.vertexDataOffset );
+	}
+
+	inline const uint32_t* GetIndices( const uint8_t* data, const Header& header )
+	{
+		return reinterpret_cast<const uint32_t*>( data + header.indexDataOffset );
+	}
+
+	inline std::string_view GetString( const uint8_t* data, const Header& header, uint32_t offset, uint32_t length )
+	{
+		return std::string_view( reinterpret_cast<const char*>( data + header.stringTableOffset + offset ), length );
+	}
+}
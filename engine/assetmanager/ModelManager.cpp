@@ -2,48 +2,185 @@
 // SPDX-License-Identifier: MIT
 
 #include "common/Precompiled.hpp"
+#include "IModelLoader.hpp"
+#include "ModelCompiler.hpp"
 #include "ModelManager.hpp"
+#include "../filesystem/FileSystem.hpp"
 
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
 using namespace Assets;
 
+CVar model_placeholder( "model_placeholder", "", 0, "Model that streamed models show until they're loaded, set before the model manager starts. Empty means they're empty until then" );
+CVar model_streamBudget( "model_streamBudget", "1024", 0, "How many kilobytes of streamed models may be swapped in per frame, by file size. At least one model is swapped in every frame" );
+CVar model_saveCompiled( "model_saveCompiled", "1", 0, "Save text models (.btm) compiled at load time next to their source, so the next load doesn't have to compile them again" );
+
 bool ModelManager::Init()
 {
+	ModelDesc placeholderDesc;
+	placeholderDesc.modelPath = model_placeholder.GetString();
+	placeholderDesc.modelData.name = "placeholder";
+	placeholderDesc.shouldStream = false;
+	placeholder = std::make_unique<Model>( placeholderDesc );
+
+	// It's not an error to have none, streamed models are simply empty until they're loaded
+	if ( !placeholderDesc.modelPath.empty() )
+	{
+		IModelLoader* loader = nullptr;
+		if ( !FindLoader( placeholderDesc.modelPath, loader ) )
+		{
+			Console->Warning( adm::format( "ModelManager: No plugin can load the placeholder model '%s'", placeholderDesc.modelPath.c_str() ) );
+			return true;
+		}
+
+		StartLoad( placeholder.get(), loader );
+	}
+
 	return true;
 }
 
 void ModelManager::Shutdown()
 {
-	models.clear();
+	if ( numSharedModels > 0U )
+	{
+		Console->Print( adm::format( "ModelManager: Model cache shared %zu models, currently saving %.1f KiB",
+			numSharedModels, GetNumSavedBytes() / 1024.0 ) );
+	}
+
+	// Parse jobs use the loader plugins, which are about to be unloaded
+	if ( nullptr != Jobs )
+	{
+		for ( const ParseJob& parseJob : parseJobs )
+		{
+			Jobs->Wait( parseJob.job );
+		}
+	}
+	parseJobs.clear();
+
+	for ( const auto& [loadId, pendingLoad] : pendingLoads )
+	{
+		FileSystem->CancelRead( pendingLoad.readRequest );
+	}
+	pendingLoads.clear();
+	finishedLoads.clear();
+	loadsToApply.clear();
+	streamedLoads.clear();
+	loadCallbacks.clear();
+	placeholder.reset();
+	benchmarkModels.clear();
+	numBenchmarkLoadsLeft = 0U;
+
+	modelCache.clear();
+	numSharedModels = 0U;
+	models.Clear();
 }
 
-void ModelManager::Setup( ICore* core, IConsole* console, IPluginSystem* pluginSystem, IFileSystem* fileSystem, IRenderFrontend* renderFrontend )
+void ModelManager::Setup( ICore* core, IConsole* console, IPluginSystem* pluginSystem, ::FileSystem* fileSystem, JobSystem* jobSystem, IRenderFrontend* renderFrontend )
 {
 	Core = core;
 	Console = console;
 	PluginSystem = pluginSystem;
 	FileSystem = fileSystem;
+	Jobs = jobSystem;
 	Renderer = renderFrontend;
 }
 
 IModel* ModelManager::CreateModel( const ModelDesc& desc )
 {
-	// TODO: Try seeing if there are any same models first
-	// We could do this by hashing the names of models and doing a quick check on them
+	return CreateModelInternal( desc, true );
+}
 
-	// TODO: Load model from file (ModelDesc::modelPath) and so with plugins
+Model* ModelManager::CreateModelInternal( const ModelDesc& desc, bool shared )
+{
+	const String cacheKey = shared ? GetCacheKey( desc ) : String();
+	if ( !cacheKey.empty() )
+	{
+		const auto iterator = modelCache.find( cacheKey );
+		if ( iterator != modelCache.end() )
+		{
+			iterator->second.numReferences++;
+			numSharedModels++;
+			return iterator->second.model;
+		}
+	}
+
+	IModelLoader* loader = nullptr;
 	if ( !desc.modelPath.empty() )
 	{
-		Console->Error( "Model loading from files is not yet implemented" );
-		return nullptr;
+		if ( !FindLoader( desc.modelPath, loader ) )
+		{
+			Console->Error( adm::format( "ModelManager: No plugin can load '%s'", desc.modelPath.c_str() ) );
+			return nullptr;
+		}
 	}
 
-	// TODO: Deferred model loading if it's from a file and shouldStream is true
+	Model* model = models.Get( models.Emplace( desc ) );
+	if ( !desc.modelPath.empty() && desc.shouldStream )
+	{
+		ShowPlaceholder( model );
+	}
 
-	return models.emplace_back( new Model( desc ) ).get();
+	if ( !cacheKey.empty() )
+	{
+		// Models from files get their size once they're loaded, others have their data already
+		modelCache[cacheKey] = CachedModel{ model, 1U, sizeof( Model ) + GetModelDataSize( model->GetModelData() ) };
+	}
+
+	if ( !desc.modelPath.empty() )
+	{
+		StartLoad( model, loader );
+	}
+
+	return model;
 }
 
 bool ModelManager::UpdateModel( IModel* model, const ModelDesc& desc )
 {
+	// Models loaded from files are simply loaded again,
+	// and keep their current data until that's done
+	if ( !desc.modelPath.empty() )
+	{
+		IModelLoader* loader = nullptr;
+		if ( !FindLoader( desc.modelPath, loader ) )
+		{
+			return false;
+		}
+
+		Model* fileModel = static_cast<Model*>( model );
+		if ( &fileModel->GetDesc() != &desc && fileModel->GetDesc().modelPath != desc.modelPath )
+		{
+			// It's a different file now, so it's cached under a different key
+			const auto iterator = modelCache.find( GetCacheKey( fileModel->GetDesc() ) );
+			const bool cached = iterator != modelCache.end() && iterator->second.model == fileModel;
+			if ( cached && iterator->second.numReferences > 1U )
+			{
+				// Everyone else who created it would suddenly get a different file
+				Console->Warning( adm::format( "ModelManager: Can't change '%s' to '%s', it's shared with other users",
+					fileModel->GetDesc().modelPath.c_str(), desc.modelPath.c_str() ) );
+				return false;
+			}
+
+			const CachedModel cachedModel = cached ? iterator->second : CachedModel{};
+			if ( cached )
+			{
+				modelCache.erase( iterator );
+			}
+
+			// If another model already has the new file, this one simply isn't shared anymore,
+			// its only reference is the caller's, and DestroyModel won't touch the other's entry
+			fileModel->GetDesc().modelPath = desc.modelPath;
+			if ( cached )
+			{
+				modelCache.try_emplace( GetCacheKey( fileModel->GetDesc() ), cachedModel );
+			}
+		}
+
+		StartLoad( fileModel, loader );
+		return true;
+	}
+
 	// TODO: Implement
 	// TODO: Alert the render frontend about the model update to regenerate vertex buffers
 	return false;
@@ -51,29 +188,690 @@ bool ModelManager::UpdateModel( IModel* model, const ModelDesc& desc )
 
 void ModelManager::DestroyModel( IModel* model )
 {
-	for ( auto it = models.begin(); it != models.end(); it++ )
+	const auto handle = models.GetHandle( static_cast<const Model*>( model ) );
+	if ( !handle.IsValid() )
+	{
+		Console->Warning( "Attempted to destroy an invalid model" );
+		return;
+	}
+
+	Model* modelToDestroy = models.Get( handle );
+	const auto iterator = modelCache.find( GetCacheKey( modelToDestroy->GetDesc() ) );
+	if ( iterator != modelCache.end() && iterator->second.model == modelToDestroy )
 	{
-		if ( it->get() == model )
+		// Still used by whoever else created it
+		if ( --iterator->second.numReferences > 0U )
 		{
-			models.erase( it );
 			return;
 		}
+
+		modelCache.erase( iterator );
 	}
 
-	Console->Warning( "Attempted to destroy an invalid model" );
+	CancelLoads( modelToDestroy );
+	loadCallbacks.erase( modelToDestroy );
+	models.Erase( handle );
 }
 
 size_t ModelManager::GetNumModels() const
 {
-	return models.size();
+	return models.Size();
 }
 
 IModel* ModelManager::GetModel( uint32_t index ) const
 {
-	if ( index >= models.size() )
+	if ( index >= models.Size() )
 	{
 		return nullptr;
 	}
 
-	return models.at( index ).get();
+	return &models.At( index );
+}
+
+void ModelManager::Update()
+{
+	parseJobs.erase( std::remove_if( parseJobs.begin(), parseJobs.end(), []( const ParseJob& parseJob )
+		{
+			return parseJob.job->IsFinished();
+		} ), parseJobs.end() );
+
+	{
+		std::lock_guard<std::mutex> lock( finishedLoadsMutex );
+		std::swap( finishedLoads, loadsToApply );
+	}
+
+	for ( FinishedLoad& finishedLoad : loadsToApply )
+	{
+		const auto iterator = pendingLoads.find( finishedLoad.loadId );
+		if ( iterator == pendingLoads.end() )
+		{
+			continue;
+		}
+
+		// Still pending until it's swapped in, so destroying the model cancels it
+		if ( iterator->second.model->GetDesc().shouldStream )
+		{
+			streamedLoads.push_back( std::move( finishedLoad ) );
+			continue;
+		}
+
+		ApplyLoad( finishedLoad );
+	}
+	loadsToApply.clear();
+
+	// Swapping models in is cheap now, but it'll mean uploading them to the GPU
+	const size_t streamBudget = static_cast<size_t>( std::max( 0, model_streamBudget.GetInt() ) ) * 1024U;
+	size_t numStreamedBytes = 0U;
+	bool swappedAny = false;
+	while ( !streamedLoads.empty() && (!swappedAny || numStreamedBytes + streamedLoads.front().fileSize <= streamBudget) )
+	{
+		FinishedLoad finishedLoad = std::move( streamedLoads.front() );
+		streamedLoads.pop_front();
+
+		// Cancelled ones are free
+		if ( pendingLoads.count( finishedLoad.loadId ) == 0U )
+		{
+			continue;
+		}
+
+		numStreamedBytes += finishedLoad.fileSize;
+		swappedAny = true;
+		ApplyLoad( finishedLoad );
+	}
+
+	if ( !benchmarkModels.empty() && 0U == numBenchmarkLoadsLeft )
+	{
+		FinishLoadBenchmark();
+	}
+
+	if ( const auto request = benchmarkRequest.Take() )
+	{
+		StartLoadBenchmark( request->modelPath, request->numModels );
+	}
+
+	if ( const auto churnRequest = churnBenchmarkRequest.Take() )
+	{
+		RunChurnBenchmark( churnRequest->numModels, churnRequest->numOperations );
+	}
+}
+
+size_t ModelManager::GetNumPendingLoads() const
+{
+	return pendingLoads.size();
+}
+
+LoadState ModelManager::GetLoadState( const IModel* model ) const
+{
+	return static_cast<const Model*>( model )->GetLoadState();
+}
+
+bool ModelManager::IsLoaded( const IModel* model ) const
+{
+	return GetLoadState( model ) == LoadState::Loaded;
+}
+
+void ModelManager::AddLoadCallback( IModel* model, ModelLoadCallback callback )
+{
+	const LoadState state = GetLoadState( model );
+	if ( state != LoadState::Loading )
+	{
+		callback( model, state );
+		return;
+	}
+
+	loadCallbacks.emplace( static_cast<const Model*>( model ), std::move( callback ) );
+}
+
+size_t ModelManager::GetNumQueuedStreamedModels() const
+{
+	return streamedLoads.size();
+}
+
+size_t ModelManager::GetNumSharedModels() const
+{
+	return numSharedModels;
+}
+
+size_t ModelManager::GetNumSavedBytes() const
+{
+	size_t numSavedBytes = 0U;
+	for ( const auto& [cacheKey, cachedModel] : modelCache )
+	{
+		numSavedBytes += (cachedModel.numReferences - 1U) * cachedModel.size;
+	}
+
+	return numSavedBytes;
+}
+
+void ModelManager::RequestLoadBenchmark( StringView modelPath, uint32_t numModels )
+{
+	benchmarkRequest.Request( LoadBenchmarkRequest{ String( modelPath ), numModels } );
+}
+
+void ModelManager::RequestChurnBenchmark( uint32_t numModels, uint32_t numOperations )
+{
+	churnBenchmarkRequest.Request( ChurnBenchmarkRequest{ numModels, numOperations } );
+}
+
+void ModelManager::OnFileChanged( const Path& path )
+{
+	models.ForEach( [&]( Model& model )
+		{
+			ModelDesc& desc = model.GetDesc();
+			if ( desc.modelPath.empty() || Path( desc.modelPath ).lexically_normal() != path )
+			{
+				return;
+			}
+
+			Console->Print( adm::format( "ModelManager: Reloading '%s'", path.string().c_str() ) );
+			if ( !UpdateModel( &model, desc ) )
+			{
+				Console->Warning( adm::format( "ModelManager: Couldn't reload '%s', keeping the old one", path.string().c_str() ) );
+			}
+		} );
+}
+
+size_t ModelManager::GetModelDataSize( const RenderData::Model& modelData )
+{
+	return modelData.name.capacity();
+}
+
+String ModelManager::GetCacheKey( const ModelDesc& desc )
+{
+	// Prefixed, so a model named like a file isn't mistaken for it
+	if ( !desc.modelPath.empty() )
+	{
+		return "file:" + FileIndex::Normalise( desc.modelPath );
+	}
+
+	if ( !desc.modelData.name.empty() )
+	{
+		return "name:" + String( desc.modelData.name );
+	}
+
+	return {};
+}
+
+bool ModelManager::FindLoader( const Path& modelPath, IModelLoader*& outLoader )
+{
+	outLoader = nullptr;
+	String extension = modelPath.extension().string();
+	if ( extension.size() < 2U )
+	{
+		return false;
+	}
+
+	std::transform( extension.begin(), extension.end(), extension.begin(), []( char character )
+		{
+			return static_cast<char>( std::tolower( static_cast<unsigned char>( character ) ) );
+		} );
+
+	// The engine's own format doesn't need a plugin
+	if ( extension == BtxModel::TextExtension || extension == BtxModel::CompiledExtension )
+	{
+		return true;
+	}
+
+	extension.erase( 0U, 1U );
+
+	// Looked up every time, since plugins may be loaded and unloaded at runtime
+	for ( IPlugin* plugin : PluginSystem->GetPluginList( IModelLoader::Name ).GetPluginLinks() )
+	{
+		IModelLoader* loader = static_cast<IModelLoader*>( plugin );
+		if ( loader->SupportsExtension( extension ) )
+		{
+			outLoader = loader;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ModelManager::StartLoad( Model* model, IModelLoader* loader )
+{
+	// Reloading a model supersedes whatever was loading before
+	CancelLoads( model );
+	if ( model->GetLoadState() == LoadState::Failed )
+	{
+		model->SetLoadState( LoadState::Loading );
+	}
+
+	const uint64_t loadId = nextLoadId++;
+	PendingLoad& pendingLoad = pendingLoads[loadId];
+	pendingLoad.model = model;
+	pendingLoad.loader = loader;
+
+	// Compiled models are read on the worker thread, since there may be two files to read
+	if ( nullptr == loader )
+	{
+		auto load = [this, loadId, modelPath = String( model->GetDesc().modelPath )]
+		{
+			FinishedLoad finishedLoad;
+			finishedLoad.loadId = loadId;
+			finishedLoad.loaded = LoadCompiledModel( modelPath, finishedLoad.compiledData, finishedLoad.error );
+			finishedLoad.fileSize = finishedLoad.compiledData.GetSize();
+
+			std::lock_guard<std::mutex> lock( finishedLoadsMutex );
+			finishedLoads.push_back( std::move( finishedLoad ) );
+		};
+
+		if ( nullptr == Jobs )
+		{
+			load();
+			return;
+		}
+
+		parseJobs.push_back( ParseJob{ Jobs->Schedule( std::move( load ) ), nullptr } );
+		return;
+	}
+
+	// The callback comes from FileSystem::Update, on the main thread
+	pendingLoad.readRequest = FileSystem->ReadFileAsync( model->GetDesc().modelPath,
+		[this, loadId, modelPath = String( model->GetDesc().modelPath )]( FileRequestStatus status, const FileView& view )
+		{
+			const auto iterator = pendingLoads.find( loadId );
+			if ( iterator == pendingLoads.end() )
+			{
+				return;
+			}
+
+			// Looked up only now, the plugin may have been unloaded while the file was read
+			IModelLoader* loader = iterator->second.loader;
+			if ( status != FileRequestStatus::Completed || nullptr == loader )
+			{
+				FinishedLoad finishedLoad{ loadId, false };
+				if ( nullptr == loader )
+				{
+					finishedLoad.error = "its loader plugin was unloaded";
+				}
+
+				std::lock_guard<std::mutex> lock( finishedLoadsMutex );
+				finishedLoads.push_back( std::move( finishedLoad ) );
+				return;
+			}
+
+			auto parse = [this, loadId, loader, modelPath, view]
+			{
+				FinishedLoad finishedLoad;
+				finishedLoad.loadId = loadId;
+				finishedLoad.fileSize = view.GetSize();
+				finishedLoad.loaded = loader->LoadModel( view.GetData(), view.GetSize(), modelPath, finishedLoad.modelData );
+
+				std::lock_guard<std::mutex> lock( finishedLoadsMutex );
+				finishedLoads.push_back( std::move( finishedLoad ) );
+			};
+
+			if ( nullptr == Jobs )
+			{
+				parse();
+				return;
+			}
+
+			parseJobs.push_back( ParseJob{ Jobs->Schedule( std::move( parse ) ), loader } );
+		}, model->GetDesc().shouldStream ? FileRequestPriority::Low : FileRequestPriority::Normal );
+}
+
+void ModelManager::OnPluginUnloading( IPlugin* plugin )
+{
+	if ( std::strcmp( plugin->GetInterfaceName(), IModelLoader::Name ) != 0 )
+	{
+		return;
+	}
+
+	const IModelLoader* loader = static_cast<const IModelLoader*>( plugin );
+
+	// Files that are still being read fail once they're in, instead of being parsed
+	for ( auto& [loadId, pendingLoad] : pendingLoads )
+	{
+		if ( pendingLoad.loader == loader )
+		{
+			pendingLoad.loader = nullptr;
+		}
+	}
+
+	// Parses that already started need the loader's code until they're done
+	if ( nullptr != Jobs )
+	{
+		for ( const ParseJob& parseJob : parseJobs )
+		{
+			if ( parseJob.loader == loader )
+			{
+				Jobs->Wait( parseJob.job );
+			}
+		}
+	}
+}
+
+void ModelManager::CancelLoads( const Model* model )
+{
+	for ( auto iterator = pendingLoads.begin(); iterator != pendingLoads.end(); )
+	{
+		if ( iterator->second.model != model )
+		{
+			iterator++;
+			continue;
+		}
+
+		const uint64_t loadId = iterator->first;
+
+		// Parsing may already be underway, in which case the result is thrown away
+		FileSystem->CancelRead( iterator->second.readRequest );
+		iterator = pendingLoads.erase( iterator );
+
+		if ( loadId >= benchmarkFirstLoadId && loadId < benchmarkFirstLoadId + benchmarkModels.size() )
+		{
+			numBenchmarkLoadsLeft--;
+		}
+	}
+}
+
+bool ModelManager::LoadCompiledModel( const String& modelPath, FileView& outCompiledData, String& outError ) const
+{
+	const Path sourcePath = Path( modelPath ).replace_extension( Path( BtxModel::TextExtension ) );
+	const Path compiledPath = Path( modelPath ).replace_extension( Path( BtxModel::CompiledExtension ) );
+	const Optional<Path> resolvedSourcePath = FileSystem->GetPathTo( sourcePath, IFileSystem::Path_File, false, true );
+	const FileView source = resolvedSourcePath ? FileSystem->ReadFile( sourcePath ) : FileView();
+
+	// A compiled model only counts if it's right beside the text model, which is where
+	// SaveCompiledModel puts it. A stale one in a higher priority mount would otherwise
+	// always win, and the model would be compiled and saved again on every load
+	FileView compiled;
+	if ( !resolvedSourcePath )
+	{
+		compiled = FileSystem->ReadFile( compiledPath );
+	}
+	else
+	{
+		const Path besideSourcePath = Path( *resolvedSourcePath ).replace_extension( Path( BtxModel::CompiledExtension ) );
+		const Optional<Path> resolvedCompiledPath = FileSystem->GetPathTo( compiledPath, IFileSystem::Path_File, false, true );
+		// Files in the same pack don't exist on disk, so they're read by their relative path
+		compiled = resolvedCompiledPath == besideSourcePath ? FileSystem->ReadFile( compiledPath ) : FileSystem->ReadFile( besideSourcePath );
+	}
+
+	// Games may ship only the compiled model
+	if ( !source )
+	{
+		if ( !compiled )
+		{
+			outError = "there's neither a text model nor a compiled model";
+			return false;
+		}
+
+		if ( nullptr == BtxModel::ReadHeader( compiled.GetData(), compiled.GetSize() ) )
+		{
+			outError = "the compiled model is damaged or out of date, and there's no text model to compile it from";
+			return false;
+		}
+
+		outCompiledData = compiled;
+		return true;
+	}
+
+	if ( compiled && !BtxModel::IsStale( compiled.GetData(), compiled.GetSize(), source.GetData(), source.GetSize() ) )
+	{
+		outCompiledData = compiled;
+		return true;
+	}
+
+	BtxModel::TextModel textModel;
+	std::string parseError;
+	if ( !BtxModel::ParseText( source.GetString(), textModel, parseError ) )
+	{
+		outError = adm::format( "%s, %s", sourcePath.string().c_str(), parseError.c_str() );
+		return false;
+	}
+
+	auto compiledData = std::make_shared<Vector<uint8_t>>(
+		BtxModel::Compile( textModel, source.GetSize(), ContentHash::Hash( source.GetData(), source.GetSize() ) ) );
+	outCompiledData = FileView( compiledData, compiledData->data(), compiledData->size() );
+
+	if ( model_saveCompiled.GetBool() && !SaveCompiledModel( sourcePath, *compiledData ) )
+	{
+		outError = "compiled it, but couldn't save it, so it'll be compiled again next time";
+	}
+
+	return true;
+}
+
+bool ModelManager::SaveCompiledModel( const Path& sourcePath, const Vector<uint8_t>& compiledData ) const
+{
+	const Optional<Path> resolvedSourcePath = FileSystem->GetPathTo( sourcePath, IFileSystem::Path_File, false, true );
+	// Packed files resolve to a path inside the pack, which doesn't exist on disk
+	if ( !resolvedSourcePath || !fs::is_regular_file( *resolvedSourcePath ) )
+	{
+		return false;
+	}
+
+	// Written under another name first, so a model that's being loaded
+	// at the same time never sees a half-written file
+	const Path compiledPath = Path( *resolvedSourcePath ).replace_extension( Path( BtxModel::CompiledExtension ) );
+	Path temporaryPath = compiledPath;
+	temporaryPath += adm::format( ".%zu.tmp", std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+
+	std::FILE* file = std::fopen( temporaryPath.string().c_str(), "wb" );
+	if ( nullptr == file )
+	{
+		return false;
+	}
+
+	std::fwrite( compiledData.data(), 1U, compiledData.size(), file );
+	const bool written = std::ferror( file ) == 0;
+	std::fclose( file );
+
+	std::error_code error;
+	if ( written )
+	{
+		fs::rename( temporaryPath, compiledPath, error );
+	}
+
+	if ( !written || error )
+	{
+		fs::remove( temporaryPath, error );
+		return false;
+	}
+
+	return true;
+}
+
+void ModelManager::ApplyLoad( FinishedLoad& finishedLoad )
+{
+	const auto iterator = pendingLoads.find( finishedLoad.loadId );
+	Model* model = iterator->second.model;
+	pendingLoads.erase( iterator );
+
+	const bool benchmarkLoad = finishedLoad.loadId >= benchmarkFirstLoadId && finishedLoad.loadId < benchmarkFirstLoadId + benchmarkModels.size();
+	if ( benchmarkLoad )
+	{
+		numBenchmarkLoadsLeft--;
+	}
+
+	if ( !finishedLoad.loaded )
+	{
+		numBenchmarkFailures += benchmarkLoad ? 1U : 0U;
+		if ( finishedLoad.error.empty() )
+		{
+			Console->Error( adm::format( "ModelManager: Couldn't load '%s'", model->GetDesc().modelPath.c_str() ) );
+		}
+		else
+		{
+			Console->Error( adm::format( "ModelManager: Couldn't load '%s': %s", model->GetDesc().modelPath.c_str(), finishedLoad.error.c_str() ) );
+		}
+
+		// A model that failed to reload keeps its old data
+		if ( model->GetLoadState() == LoadState::Loading )
+		{
+			model->SetLoadState( LoadState::Failed );
+		}
+	}
+	else
+	{
+		if ( !finishedLoad.error.empty() )
+		{
+			Console->Warning( adm::format( "ModelManager: '%s': %s", model->GetDesc().modelPath.c_str(), finishedLoad.error.c_str() ) );
+		}
+
+		ModelDesc& desc = model->GetDesc();
+		if ( finishedLoad.modelData.name.empty() )
+		{
+			finishedLoad.modelData.name = desc.modelData.name;
+		}
+
+		// Swapped in one go, so nothing ever sees half of the placeholder and half of the model
+		// Renderers notice the new revision and regenerate their vertex buffers
+		desc.modelData = std::move( finishedLoad.modelData );
+		model->SetCompiledData( std::move( finishedLoad.compiledData ) );
+		model->OnDataChanged();
+		model->SetLoadState( LoadState::Loaded );
+
+		const auto cacheIterator = modelCache.find( GetCacheKey( desc ) );
+		if ( cacheIterator != modelCache.end() && cacheIterator->second.model == model )
+		{
+			cacheIterator->second.size = sizeof( Model ) + finishedLoad.fileSize;
+		}
+
+		// Streamed models that were created before the placeholder was loaded
+		if ( model == placeholder.get() )
+		{
+			models.ForEach( [this]( Model& streamedModel )
+				{
+					if ( streamedModel.GetDesc().shouldStream && streamedModel.GetLoadState() == LoadState::Loading )
+					{
+						ShowPlaceholder( &streamedModel );
+					}
+				} );
+		}
+	}
+
+	// Taken out first, since callbacks may create and destroy models, or add more callbacks
+	Vector<ModelLoadCallback> callbacks;
+	const auto [callbacksBegin, callbacksEnd] = loadCallbacks.equal_range( model );
+	for ( auto callbackIterator = callbacksBegin; callbackIterator != callbacksEnd; callbackIterator++ )
+	{
+		callbacks.push_back( std::move( callbackIterator->second ) );
+	}
+	loadCallbacks.erase( callbacksBegin, callbacksEnd );
+
+	// Only models that were Loading have callbacks, see AddLoadCallback
+	const LoadState state = model->GetLoadState();
+	for ( const ModelLoadCallback& callback : callbacks )
+	{
+		callback( model, state );
+	}
+}
+
+void ModelManager::ShowPlaceholder( Model* model ) const
+{
+	if ( nullptr == placeholder )
+	{
+		return;
+	}
+
+	ModelDesc& desc = model->GetDesc();
+	String name = std::move( desc.modelData.name );
+	desc.modelData = placeholder->GetModelData();
+	desc.modelData.name = std::move( name );
+	model->SetCompiledData( placeholder->GetCompiledData() );
+	model->OnDataChanged();
+}
+
+void ModelManager::StartLoadBenchmark( const String& modelPath, uint32_t numModels )
+{
+	if ( !benchmarkModels.empty() )
+	{
+		Console->Warning( "ModelManager: A load benchmark is already running" );
+		return;
+	}
+
+	IModelLoader* loader = nullptr;
+	if ( 0U == numModels || !FindLoader( modelPath, loader ) )
+	{
+		Console->Warning( adm::format( "ModelManager: Can't benchmark loading '%s'", modelPath.c_str() ) );
+		return;
+	}
+
+	ModelDesc desc;
+	desc.modelPath = modelPath;
+
+	Console->Print( adm::format( "ModelManager: Loading '%s' %u times...", modelPath.c_str(), numModels ) );
+	benchmarkFirstLoadId = nextLoadId;
+	numBenchmarkLoadsLeft = numModels;
+	numBenchmarkFailures = 0U;
+	benchmarkStartTime = chrono::steady_clock::now();
+
+	benchmarkModels.reserve( numModels );
+	for ( uint32_t i = 0U; i < numModels; i++ )
+	{
+		// Not shared, otherwise only the first one would actually be loaded
+		benchmarkModels.push_back( CreateModelInternal( desc, false ) );
+	}
+}
+
+void ModelManager::FinishLoadBenchmark()
+{
+	const chrono::duration<double> benchmarkTime = chrono::steady_clock::now() - benchmarkStartTime;
+	const uint32_t numModels = static_cast<uint32_t>( benchmarkModels.size() );
+	const uint32_t numLoaded = numModels - numBenchmarkFailures;
+
+	// Measured up to the frame the last model arrived in, so it includes waiting for that frame
+	Console->Print( adm::format( "ModelManager: Loaded %u of %u models in %.1f ms, %.1f models per second",
+		numLoaded, numModels, benchmarkTime.count() * 1000.0, numLoaded / std::max( benchmarkTime.count(), 1e-9 ) ) );
+
+	for ( Model* model : benchmarkModels )
+	{
+		models.Erase( models.GetHandle( model ) );
+	}
+
+	benchmarkModels.clear();
+}
+
+void ModelManager::RunChurnBenchmark( uint32_t numModels, uint32_t numOperations )
+{
+	using Clock = chrono::steady_clock;
+
+	// Unnamed, so they're never shared and every create and destroy is real
+	ModelDesc desc;
+	Vector<IModel*> liveModels;
+	liveModels.reserve( numModels );
+	std::mt19937 random( 1U );
+
+	const Clock::time_point createStartTime = Clock::now();
+	for ( uint32_t i = 0U; i < numModels; i++ )
+	{
+		liveModels.push_back( CreateModel( desc ) );
+	}
+
+	const Clock::time_point churnStartTime = Clock::now();
+	for ( uint32_t i = 0U; i < numOperations; i++ )
+	{
+		IModel*& model = liveModels[random() % numModels];
+		DestroyModel( model );
+		model = CreateModel( desc );
+	}
+
+	// After all that churn, live models are scattered all over the slots
+	const Clock::time_point iterationStartTime = Clock::now();
+	size_t numNameCharacters = 0U;
+	for ( uint32_t i = 0U; i < GetNumModels(); i++ )
+	{
+		numNameCharacters += GetModel( i )->GetName().size();
+	}
+
+	const Clock::time_point destroyStartTime = Clock::now();
+	for ( IModel* model : liveModels )
+	{
+		DestroyModel( model );
+	}
+
+	const Clock::time_point endTime = Clock::now();
+	const auto nanoseconds = []( Clock::duration duration )
+	{
+		return chrono::duration<double, std::nano>( duration ).count();
+	};
+
+	Console->Print( adm::format( "ModelManager: Churn benchmark with %u models, %u destroy-create pairs:", numModels, numOperations ) );
+	Console->Print( adm::format( "   * create:             %.1f ns per model", nanoseconds( churnStartTime - createStartTime ) / numModels ) );
+	Console->Print( adm::format( "   * destroy + create:   %.1f ns per pair", nanoseconds( iterationStartTime - churnStartTime ) / std::max( numOperations, 1U ) ) );
+	Console->Print( adm::format( "   * iterate:            %.2f ns per model (%zu)", nanoseconds( destroyStartTime - iterationStartTime ) / numModels, numNameCharacters ) );
+	Console->Print( adm::format( "   * destroy:            %.1f ns per model", nanoseconds( endTime - destroyStartTime ) / numModels ) );
 }
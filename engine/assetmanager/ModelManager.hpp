@@ -4,6 +4,16 @@
 #pragma once
 
 #include "Model.hpp"
+#include "SlotMap.hpp"
+#include "../console/DeferredRequest.hpp"
+#include "../filesystem/AsyncFileQueue.hpp"
+#include "../jobsystem/JobSystem.hpp"
+
+class FileSystem;
+class IModelLoader;
+
+// Called on the main thread, with the model's state after the load: Loaded or Failed
+using ModelLoadCallback = std::function<void( Assets::IModel* model, Assets::LoadState state )>;
 
 class ModelManager : public IModelManager
 {
@@ -12,24 +22,175 @@ public:
 	void				Shutdown() override;
 
 	// To import APIs from the engine
-	void				Setup( ICore* core, IConsole* console, IPluginSystem* pluginSystem, IFileSystem* fileSystem, IRenderFrontend* renderFrontend );
+	void				Setup( ICore* core, IConsole* console, IPluginSystem* pluginSystem, ::FileSystem* fileSystem, JobSystem* jobSystem, IRenderFrontend* renderFrontend );
 
+	// Models with a modelPath are returned right away and filled in by Update once they're loaded
+	// Streamed models (shouldStream) show the placeholder model until then, and are swapped
+	// in a few per frame, see model_streamBudget. Others are swapped in as soon as they're loaded
+	// Requesting the same file or the same name again returns the same model, see GetCacheKey
 	Assets::IModel*		CreateModel( const Assets::ModelDesc& desc ) override;
+	// Models from files are loaded again, from a different file if the path changed
+	// A model shared by several users can't change its file, and is left as it is
 	bool				UpdateModel( Assets::IModel* model, const Assets::ModelDesc& desc ) override;
+	// Shared models are only destroyed once every CreateModel is matched by a DestroyModel
+	// Destroying a model again is caught until its slot is reused, see SlotMap::MinFreeSlots
 	void				DestroyModel( Assets::IModel* model ) override;
 
 	size_t				GetNumModels() const override;
+	// Indices aren't stable, destroying a model moves the last one into its place
 	Assets::IModel*		GetModel( uint32_t index ) const override;
 
+	// Hands finished loads over to their models, called
+	// every frame after FileSystem::Update
+	void				Update();
+
+	size_t				GetNumPendingLoads() const;
+
+	// These would belong in IModelManager, they're here until the interface catches up
+	Assets::LoadState	GetLoadState( const Assets::IModel* model ) const;
+	bool				IsLoaded( const Assets::IModel* model ) const;
+	// Called once the model's current load is swapped in or fails, right away if it isn't Loading
+	// Dropped without being called if the model is destroyed before that
+	void				AddLoadCallback( Assets::IModel* model, ModelLoadCallback callback );
+	// Streamed models that are loaded but waiting for their turn to be swapped in
+	size_t				GetNumQueuedStreamedModels() const;
+
+	// How many CreateModel calls returned a model that already existed
+	size_t				GetNumSharedModels() const;
+	// Memory that shared models would currently take up if each CreateModel made its own
+	size_t				GetNumSavedBytes() const;
+
+	// Thread-safe, the benchmark starts with the next Update
+	// Loads a model numModels times, then prints how many models per second were loaded
+	void				RequestLoadBenchmark( StringView modelPath, uint32_t numModels );
+	// Thread-safe, the benchmark runs during the next Update
+	// Keeps numModels models around, destroying and creating them numOperations times
+	void				RequestChurnBenchmark( uint32_t numModels, uint32_t numOperations );
+
+	// Reloads models that were loaded from path, relative to the mounts
+	void				OnFileChanged( const Path& path );
+	// Called before a plugin is unloaded. If it's a loader, waits for the files it's
+	// parsing, and files that are still being read fail instead of going to it
+	void				OnPluginUnloading( IPlugin* plugin );
+
 private:
-	// Cheaper to resize, but more fragmented this way
-	// Todo: *maybe* compare the performance of
-	// Vector<Render::Model> versus this
-	Vector<UniquePtr<Assets::Model>> models;
+	// Models from files are identified by their path, others by their name
+	// Returns an empty string for unnamed models, which are never shared
+	static String		GetCacheKey( const Assets::ModelDesc& desc );
+	// What copying the data allocates on top of sizeof( Model ), as far as it's known here
+	static size_t		GetModelDataSize( const RenderData::Model& modelData );
+	Assets::Model*		CreateModelInternal( const Assets::ModelDesc& desc, bool shared );
+	// Returns false if nothing can load this kind of file
+	// outLoader is nullptr for the engine's own format, see ModelFormat.hpp
+	bool				FindLoader( const Path& modelPath, IModelLoader*& outLoader );
+	// Reads the file in the background, then parses it on a worker thread
+	// Without a loader, the compiled model is loaded, see LoadCompiledModel
+	void				StartLoad( Assets::Model* model, IModelLoader* loader );
+	// Drops loads that haven't finished yet, e.g. because the model is gone
+	void				CancelLoads( const Assets::Model* model );
+	struct FinishedLoad;
+	// Swaps the loaded data into the model and calls its load callbacks
+	void				ApplyLoad( FinishedLoad& finishedLoad );
+	// Keeps the model's name, so it can still be found while it's streaming
+	void				ShowPlaceholder( Assets::Model* model ) const;
+	// Called on a worker thread. Uses the compiled model (.btmc) if it's up to date
+	// with its text model (.btm), otherwise compiles the text model and saves it
+	// outError says why it failed, or has a warning if it was loaded anyway
+	bool				LoadCompiledModel( const String& modelPath, FileView& outCompiledData, String& outError ) const;
+	// Next to the source, unless it's in a pack. Returns false if that didn't work out
+	bool				SaveCompiledModel( const Path& sourcePath, const Vector<uint8_t>& compiledData ) const;
+	void				StartLoadBenchmark( const String& modelPath, uint32_t numModels );
+	void				FinishLoadBenchmark();
+	void				RunChurnBenchmark( uint32_t numModels, uint32_t numOperations );
+
+private:
+	// Models don't move, since they're handed out as pointers,
+	// but creating and destroying them doesn't search or shift anything
+	SlotMap<Assets::Model> models;
+
+	struct CachedModel
+	{
+		Assets::Model*	model{ nullptr };
+		uint32_t		numReferences{ 0U };
+		// The model itself, plus the file it was loaded from, or its data if it isn't from a file
+		size_t			size{ 0U };
+	};
+
+	// GetCacheKey -> model
+	std::unordered_map<String, CachedModel> modelCache;
+	size_t				numSharedModels{ 0U };
+
+	struct PendingLoad
+	{
+		Assets::Model*	model{ nullptr };
+		// nullptr for the engine's own format, or once the loader plugin is unloaded
+		IModelLoader*	loader{ nullptr };
+		FileRequestId	readRequest{ 0U };
+	};
+
+	struct FinishedLoad
+	{
+		uint64_t		loadId{ 0U };
+		bool			loaded{ false };
+		size_t			fileSize{ 0U };
+		RenderData::Model modelData;
+		// Only for the engine's own format
+		FileView		compiledData;
+		// Why it failed, or a warning if it was loaded anyway
+		String			error;
+	};
+
+	// Load ID -> model, loads that aren't in here anymore are discarded once they finish
+	std::unordered_map<uint64_t, PendingLoad> pendingLoads;
+	uint64_t			nextLoadId{ 1U };
+	// Parsed on worker threads, applied on the main thread
+	std::mutex			finishedLoadsMutex;
+	Vector<FinishedLoad> finishedLoads;
+	Vector<FinishedLoad> loadsToApply;
+	struct ParseJob
+	{
+		JobHandle		job;
+		// nullptr for the engine's own format
+		IModelLoader*	loader{ nullptr };
+	};
+
+	// Waited on during shutdown, since they write into finishedLoads,
+	// and before their loader plugin is unloaded
+	Vector<ParseJob>	parseJobs;
+	// Loaded streamed models, swapped in first come, first served within the budget
+	std::deque<FinishedLoad> streamedLoads;
+
+	// Shown by streamed models until they're loaded, see model_placeholder
+	// Not in models, so it's never handed out or destroyed by anyone
+	UniquePtr<Assets::Model> placeholder;
+	std::unordered_multimap<const Assets::Model*, ModelLoadCallback> loadCallbacks;
+
+	struct LoadBenchmarkRequest
+	{
+		String			modelPath;
+		uint32_t		numModels{ 0U };
+	};
+
+	DeferredRequest<LoadBenchmarkRequest> benchmarkRequest;
+	// Benchmark loads get consecutive IDs starting from this one
+	uint64_t			benchmarkFirstLoadId{ 0U };
+	Vector<Assets::Model*> benchmarkModels;
+	uint32_t			numBenchmarkLoadsLeft{ 0U };
+	uint32_t			numBenchmarkFailures{ 0U };
+	chrono::steady_clock::time_point benchmarkStartTime;
+
+	struct ChurnBenchmarkRequest
+	{
+		uint32_t		numModels{ 0U };
+		uint32_t		numOperations{ 0U };
+	};
+
+	DeferredRequest<ChurnBenchmarkRequest> churnBenchmarkRequest;
 
 	ICore* Core{ nullptr };
 	IConsole* Console{ nullptr };
 	IPluginSystem* PluginSystem{ nullptr };
-	IFileSystem* FileSystem{ nullptr };
+	::FileSystem* FileSystem{ nullptr };
+	JobSystem* Jobs{ nullptr };
 	IRenderFrontend* Renderer{ nullptr };
 };
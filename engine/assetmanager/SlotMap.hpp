@@ -0,0 +1,246 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <deque>
+
+// ============================
+// SlotMap
+//
+// Owns objects that are created and destroyed a lot, both in O(1):
+// freed slots are reused through a free list, and objects never move,
+// since the public API hands out raw pointers to them
+//
+// Slots live in blocks that double in size, so there are only a
+// handful of allocations, and finding the slot of a pointer only
+// has to check a handful of blocks. Live objects are also listed in
+// a dense array, so iterating over them never touches free slots
+//
+// Handles carry a generation, so a handle to a destroyed object
+// stays invalid even after its slot is reused
+//
+// Raw pointers don't have a generation: a pointer to a destroyed object
+// is only recognised as such until its slot is reused, after which it
+// points to the new object. Freed slots are therefore reused first in,
+// first out, and only while more than MinFreeSlots are free, so a freed
+// slot is only handed out again after at least MinFreeSlots other objects
+// ============================
+template<typename T>
+class SlotMap final
+{
+public:
+	static constexpr uint32_t InvalidIndex = ~0U;
+	// Every block after the first one is twice as big as the previous one
+	static constexpr uint32_t FirstBlockSize = 64U;
+	// Emplace adds a block rather than dig deeper into the free list
+	static constexpr uint32_t MinFreeSlots = 64U;
+
+	struct Handle
+	{
+		uint32_t		index{ InvalidIndex };
+		uint32_t		generation{ 0U };
+
+		bool			IsValid() const
+		{
+			return index != InvalidIndex;
+		}
+
+		bool			operator==( const Handle& other ) const
+		{
+			return index == other.index && generation == other.generation;
+		}
+	};
+
+	SlotMap() = default;
+	SlotMap( const SlotMap& ) = delete;
+	SlotMap& operator=( const SlotMap& ) = delete;
+
+	~SlotMap()
+	{
+		Clear();
+	}
+
+	template<typename... Args>
+	Handle				Emplace( Args&&... args )
+	{
+		if ( freeSlots.size() <= MinFreeSlots )
+		{
+			AddBlock();
+		}
+
+		const uint32_t index = freeSlots.front();
+		Slot& slot = GetSlot( index );
+		new ( slot.storage ) T( std::forward<Args>( args )... );
+		freeSlots.pop_front();
+
+		slot.denseIndex = static_cast<uint32_t>( denseSlots.size() );
+		denseSlots.push_back( index );
+		return Handle{ index, slot.generation };
+	}
+
+	// Returns false if the handle is stale
+	// The last object in the dense array takes the erased one's place there
+	bool				Erase( Handle handle )
+	{
+		if ( nullptr == Get( handle ) )
+		{
+			return false;
+		}
+
+		Slot& slot = GetSlot( handle.index );
+		GetObject( slot ).~T();
+
+		const uint32_t lastSlotIndex = denseSlots.back();
+		denseSlots[slot.denseIndex] = lastSlotIndex;
+		GetSlot( lastSlotIndex ).denseIndex = slot.denseIndex;
+		denseSlots.pop_back();
+
+		slot.denseIndex = InvalidIndex;
+		slot.generation++;
+		freeSlots.push_back( handle.index );
+		return true;
+	}
+
+	// Returns nullptr if the handle is stale
+	T*					Get( Handle handle ) const
+	{
+		if ( handle.index >= capacity )
+		{
+			return nullptr;
+		}
+
+		const Slot& slot = GetSlot( handle.index );
+		if ( slot.denseIndex == InvalidIndex || slot.generation != handle.generation )
+		{
+			return nullptr;
+		}
+
+		return &GetObject( slot );
+	}
+
+	// Returns an invalid handle if the object isn't in this map
+	// Never dereferences the pointer, so it's fine to pass destroyed objects,
+	// as long as their slot hasn't been reused yet, see MinFreeSlots
+	Handle				GetHandle( const T* object ) const
+	{
+		const uintptr_t address = reinterpret_cast<uintptr_t>( object );
+		for ( uint32_t blockIndex = 0U; blockIndex < blocks.size(); blockIndex++ )
+		{
+			const uintptr_t begin = reinterpret_cast<uintptr_t>( blocks[blockIndex].get() );
+			const uintptr_t end = begin + GetBlockSize( blockIndex ) * sizeof( Slot );
+			if ( address < begin || address >= end || (address - begin) % sizeof( Slot ) != 0U )
+			{
+				continue;
+			}
+
+			const uint32_t index = GetBlockStart( blockIndex ) + static_cast<uint32_t>( (address - begin) / sizeof( Slot ) );
+			const Slot& slot = GetSlot( index );
+			if ( slot.denseIndex == InvalidIndex )
+			{
+				return {};
+			}
+
+			return Handle{ index, slot.generation };
+		}
+
+		return {};
+	}
+
+	size_t				Size() const
+	{
+		return denseSlots.size();
+	}
+
+	bool				Empty() const
+	{
+		return denseSlots.empty();
+	}
+
+	// In no particular order, see Erase
+	T&					At( size_t denseIndex ) const
+	{
+		return GetObject( GetSlot( denseSlots[denseIndex] ) );
+	}
+
+	template<typename Function>
+	void				ForEach( Function&& function ) const
+	{
+		for ( const uint32_t index : denseSlots )
+		{
+			function( GetObject( GetSlot( index ) ) );
+		}
+	}
+
+	// Destroys all objects, but keeps the memory around
+	// Handles from before are all stale afterwards
+	void				Clear()
+	{
+		while ( !denseSlots.empty() )
+		{
+			const uint32_t index = denseSlots.back();
+			Erase( Handle{ index, GetSlot( index ).generation } );
+		}
+	}
+
+private:
+	struct Slot
+	{
+		// First, so the address of a slot is the address of its object
+		alignas( T ) unsigned char storage[sizeof( T )];
+		uint32_t		generation{ 0U };
+		// Into denseSlots, InvalidIndex if the slot is free
+		uint32_t		denseIndex{ InvalidIndex };
+	};
+
+	static uint32_t		GetBlockSize( uint32_t blockIndex )
+	{
+		return FirstBlockSize << blockIndex;
+	}
+
+	static uint32_t		GetBlockStart( uint32_t blockIndex )
+	{
+		return FirstBlockSize * ((1U << blockIndex) - 1U);
+	}
+
+	static T&			GetObject( const Slot& slot )
+	{
+		return *std::launder( reinterpret_cast<T*>( const_cast<unsigned char*>( slot.storage ) ) );
+	}
+
+	Slot&				GetSlot( uint32_t index ) const
+	{
+		// Index / FirstBlockSize + 1 lies in [2^block, 2^(block + 1))
+		uint32_t blockIndex = 0U;
+		for ( uint32_t value = index / FirstBlockSize + 1U; value > 1U; value >>= 1U )
+		{
+			blockIndex++;
+		}
+
+		return blocks[blockIndex][index - GetBlockStart( blockIndex )];
+	}
+
+	void				AddBlock()
+	{
+		const uint32_t blockIndex = static_cast<uint32_t>( blocks.size() );
+		const uint32_t blockSize = GetBlockSize( blockIndex );
+		blocks.emplace_back( new Slot[blockSize] );
+
+		// Behind the slots that were freed before, lower slots first
+		const uint32_t blockStart = GetBlockStart( blockIndex );
+		for ( uint32_t i = 0U; i < blockSize; i++ )
+		{
+			freeSlots.push_back( blockStart + i );
+		}
+
+		capacity = blockStart + blockSize;
+	}
+
+private:
+	Vector<UniquePtr<Slot[]>> blocks;
+	uint32_t			capacity{ 0U };
+	// Freed slots go to the back, Emplace takes them from the front
+	std::deque<uint32_t> freeSlots;
+	// Slot indices of live objects
+	Vector<uint32_t>	denseSlots;
+};
@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// This header is shared with tools/LogDecoder, which doesn't
+// link against anything, so it sticks to the standard library
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ============================
+// Binary console log format
+// 
+// A file starts with an 8-byte header, followed by records:
+//   Format:  [RecordFormat] [varint id] [varint length] [bytes]
+//   Message: [RecordMessage] [varint time delta in µs] [varint format id]
+//            [varint arg count] { [varint length] [bytes] }...
+// 
+// Formats are message templates, where every '%s' stands for an argument,
+// and '%%' for a literal '%'. They are defined once per file, before first use,
+// so every file can be decoded on its own. Time deltas are relative to the
+// previous message in the same file, and the first one is relative to zero
+// ============================
+namespace BinaryLog
+{
+	constexpr char Magic[6] = { 'B', 'T', 'X', 'L', 'O', 'G' };
+	constexpr uint8_t Version = 1U;
+	constexpr size_t HeaderSize = 8U;
+
+	enum RecordType : uint8_t
+	{
+		RecordFormat = 1,
+		RecordMessage = 2
+	};
+
+	inline void WriteHeader( std::string& out )
+	{
+		out.append( Magic, sizeof( Magic ) );
+		out += char( Version );
+		out += char( 0 ); // reserved
+	}
+
+	inline bool ReadHeader( const uint8_t* data, size_t size )
+	{
+		return size >= HeaderSize
+			&& std::memcmp( data, Magic, sizeof( Magic ) ) == 0
+			&& data[sizeof( Magic )] == Version;
+	}
+
+	// LEB128, 7 bits per byte
+	inline void WriteVarint( std::string& out, uint64_t value )
+	{
+		while ( value >= 0x80U )
+		{
+			out += char( (value & 0x7FU) | 0x80U );
+			value >>= 7U;
+		}
+		out += char( value );
+	}
+
+	// Returns false if the data ends in the middle of the number
+	inline bool ReadVarint( const uint8_t*& data, const uint8_t* end, uint64_t& outValue )
+	{
+		outValue = 0U;
+		for ( uint32_t shift = 0U; data < end && shift < 64U; shift += 7U )
+		{
+			const uint8_t byte = *data++;
+			outValue |= uint64_t( byte & 0x7FU ) << shift;
+			if ( !(byte & 0x80U) )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline void WriteString( std::string& out, std::string_view string )
+	{
+		WriteVarint( out, string.size() );
+		out.append( string.data(), string.size() );
+	}
+
+	// Splits a formatted message back into a template and its arguments
+	// Quoted text ('like this') and numbers become arguments, which is how
+	// the engine formats paths, names and counts in practically every message:
+	// "Mounting 'games/base'..." -> "Mounting '%s'..." + { "games/base" }
+	inline void ExtractTemplate( std::string_view text, std::string& outFormat, std::vector<std::string_view>& outArguments )
+	{
+		outFormat.clear();
+		outArguments.clear();
+
+		const auto isDigit = []( char c )
+		{
+			return c >= '0' && c <= '9';
+		};
+
+		for ( size_t i = 0U; i < text.size(); i++ )
+		{
+			const char c = text[i];
+
+			if ( c == '%' )
+			{
+				outFormat += "%%";
+				continue;
+			}
+
+			if ( c == '\'' )
+			{
+				const size_t closingQuote = text.find( '\'', i + 1U );
+				if ( closingQuote != std::string_view::npos )
+				{
+					outArguments.push_back( text.substr( i + 1U, closingQuote - i - 1U ) );
+					outFormat += "'%s'";
+					i = closingQuote;
+					continue;
+				}
+			}
+
+			// Numbers glued to letters are usually a part of a name, like "Vec3"
+			const bool startsNumber = isDigit( c ) && (i == 0U || !std::isalpha( static_cast<unsigned char>( text[i - 1U] ) ));
+			if ( startsNumber )
+			{
+				size_t end = i + 1U;
+				while ( end < text.size() && (isDigit( text[end] ) || (text[end] == '.' && end + 1U < text.size() && isDigit( text[end + 1U] ))) )
+				{
+					end++;
+				}
+
+				outArguments.push_back( text.substr( i, end - i ) );
+				outFormat += "%s";
+				i = end - 1U;
+				continue;
+			}
+
+			outFormat += c;
+		}
+	}
+
+	// The reverse of ExtractTemplate
+	inline void ExpandTemplate( std::string_view format, const std::vector<std::string_view>& arguments, std::string& outText )
+	{
+		outText.clear();
+		size_t argumentIndex = 0U;
+
+		for ( size_t i = 0U; i < format.size(); i++ )
+		{
+			if ( format[i] == '%' && i + 1U < format.size() )
+			{
+				if ( format[i + 1U] == '%' )
+				{
+					outText += '%';
+					i++;
+					continue;
+				}
+
+				if ( format[i + 1U] == 's' )
+				{
+					if ( argumentIndex < arguments.size() )
+					{
+						outText.append( arguments[argumentIndex].data(), arguments[argumentIndex].size() );
+					}
+					argumentIndex++;
+					i++;
+					continue;
+				}
+			}
+
+			outText += format[i];
+		}
+	}
+}
@@ -3,6 +3,10 @@
 
 #include "common/Precompiled.hpp"
 #include "Console.hpp"
+#include "../profiler/Profiler.hpp"
+
+#include <iostream>
+#include <random>
 
 // ============================
 // Console::Init
@@ -10,12 +14,16 @@
 // ============================
 bool Console::Init( int argc, char** argv )
 {
+	// Messages from other threads are delivered on this one
+	mainThreadId = std::this_thread::get_id();
+
 	ParseArguments( argc, argv );
 
 	EngineConsole = this;
 	CVar::RegisterAll();
 
 	cvarList.reserve( 1024U );
+	cvarMap.reserve( 1024U );
 
 	Print( "Scanning for console listeners..." );
 	String consoleListenerArguments = arguments.GetCString( "-console_listener", "" );
@@ -28,6 +36,7 @@ bool Console::Init( int argc, char** argv )
 		// fight for the console, such as Basic and TUI
 		bool alreadyDoingBasicOrInteractive = false;
 		bool alreadyAddedFileout = false;
+		bool alreadyAddedBinary = false;
 
 		Lexer lex( consoleListenerArguments );
 		lex.SetDelimiters( "," );
@@ -51,6 +60,11 @@ bool Console::Init( int argc, char** argv )
 				AddListener( CreateListenerFileOut() );
 				alreadyAddedFileout = true;
 			}
+			else if ( token == "binary" && !alreadyAddedBinary )
+			{
+				AddListener( CreateListenerBinary() );
+				alreadyAddedBinary = true;
+			}
 			else
 			{
 				Warning( adm::format( "  * unknown listener option '%s'", token.c_str() ) );
@@ -72,8 +86,12 @@ bool Console::Init( int argc, char** argv )
 void Console::Shutdown()
 {
 	Print( "Console::Shutdown" );
+	// Whatever's left must reach the listeners before they're gone
+	Flush();
+
 	CVar::UnregisterAll();
 	cvarList.clear();
+	cvarMap.clear();
 	arguments.Clear();
 
 	for ( auto*& listener : consoleListeners )
@@ -90,10 +108,41 @@ void Console::Shutdown()
 // ============================
 void Console::Update()
 {
+	BTX_PROFILE_FUNCTION();
+
+	Flush();
+
 	for ( auto* listener : consoleListeners )
 	{
 		listener->OnUpdate();
 	}
+
+	// Not while the listeners are being updated, the print benchmark swaps them out
+	if ( const auto numLookups = lookupBenchmarkRequest.Take() )
+	{
+		RunLookupBenchmark( *numLookups );
+	}
+
+	if ( const auto numLines = printBenchmarkRequest.Take() )
+	{
+		RunPrintBenchmark( *numLines );
+	}
+}
+
+// ============================
+// Console::RequestLookupBenchmark
+// ============================
+void Console::RequestLookupBenchmark( uint32_t numLookups )
+{
+	lookupBenchmarkRequest.Request( numLookups );
+}
+
+// ============================
+// Console::RequestPrintBenchmark
+// ============================
+void Console::RequestPrintBenchmark( uint32_t numLines )
+{
+	printBenchmarkRequest.Request( numLines );
 }
 
 // ============================
@@ -139,9 +188,29 @@ void Console::Print( const char* string )
 	ConsoleMessage message;
 	message.text = string;
 	message.timeSubmitted = core->Time();
+	// Stamped here, messages may wait in the queue for a while
 	message.date = DateTime::Now();
 
-	Log( message );
+	if ( messageQueue.Push( std::move( message ) ) )
+	{
+		return;
+	}
+
+	// The queue is full. On the main thread we can simply empty
+	// it right here, other threads can't touch the listeners
+	if ( !IsMainThread() )
+	{
+		numDroppedMessages.fetch_add( 1U, std::memory_order_relaxed );
+		return;
+	}
+
+	Flush();
+
+	// Other threads may have filled it up again in the meantime
+	if ( !messageQueue.Push( std::move( message ) ) )
+	{
+		numDroppedMessages.fetch_add( 1U, std::memory_order_relaxed );
+	}
 }
 
 // ============================
@@ -169,6 +238,13 @@ void Console::Warning( const char* string )
 void Console::Error( const char* string )
 {
 	Print( adm::format( "%sERROR: %s", PrintRed, string ) );
+
+	// Errors often come right before a shutdown or a crash,
+	// so don't let them wait for the next Update
+	if ( IsMainThread() )
+	{
+		Flush();
+	}
 }
 
 // ============================
@@ -182,12 +258,14 @@ void Console::Register( CVarBase* cvar )
 	}
 
 	// Can't have duplicates
-	for ( auto* internalCvar : cvarList )
+	auto result = cvarMap.try_emplace( cvar->GetName(), CVarSlot{ cvar, static_cast<uint32_t>( cvarList.size() ) } );
+	if ( !result.second )
 	{
-		if ( internalCvar == cvar )
+		if ( result.first->second.cvar != cvar )
 		{
-			return;
+			Warning( adm::format( "Console::Register: CVar '%s' is already registered", String( cvar->GetName() ).c_str() ) );
 		}
+		return;
 	}
 
 	cvarList.push_back( cvar );
@@ -198,14 +276,25 @@ void Console::Register( CVarBase* cvar )
 // ============================
 void Console::Unregister( CVarBase* cvar )
 {
-	for ( auto it = cvarList.begin(); it != cvarList.end(); it++ )
+	if ( nullptr == cvar )
 	{
-		if ( *it == cvar )
-		{
-			cvarList.erase( it );
-			return;
-		}
+		return;
+	}
+
+	auto mapIterator = cvarMap.find( cvar->GetName() );
+	if ( mapIterator == cvarMap.end() || mapIterator->second.cvar != cvar )
+	{
+		return;
 	}
+
+	// The last CVar takes this one's place, so nothing else has to move
+	const uint32_t listIndex = mapIterator->second.listIndex;
+	CVarBase* lastCVar = cvarList.back();
+	cvarList[listIndex] = lastCVar;
+	cvarMap[lastCVar->GetName()].listIndex = listIndex;
+
+	cvarList.pop_back();
+	cvarMap.erase( mapIterator );
 }
 
 // ============================
@@ -259,15 +348,13 @@ bool Console::Execute( StringView command, const ConsoleCommandArgs& args )
 // ============================
 const CVarBase* Console::Find( StringView name ) const
 {
-	for ( const auto* cvar : cvarList )
+	auto result = cvarMap.find( name );
+	if ( result == cvarMap.end() )
 	{
-		if ( cvar->GetName() == name )
-		{
-			return cvar;
-		}
+		return nullptr;
 	}
 
-	return nullptr;
+	return result->second.cvar;
 }
 
 // ============================
@@ -283,6 +370,12 @@ Vector<const CVarBase*> Console::Search( StringView nameFragment ) const
 			cvars.push_back( cvar );
 		}
 	}
+
+	// The list's order changes as CVars come and go
+	std::sort( cvars.begin(), cvars.end(), []( const CVarBase* a, const CVarBase* b )
+		{
+			return a->GetName() < b->GetName();
+		} );
 	return cvars;
 }
 
@@ -333,6 +426,37 @@ void Console::ParseArguments( int argc, char** argv )
 	}
 }
 
+// ============================
+// Console::IsMainThread
+// ============================
+bool Console::IsMainThread() const
+{
+	return std::this_thread::get_id() == mainThreadId;
+}
+
+// ============================
+// Console::Flush
+// ============================
+void Console::Flush()
+{
+	ConsoleMessage message;
+	if ( !messageQueue.Pop( message ) )
+	{
+		return;
+	}
+
+	do
+	{
+		Log( message );
+	} while ( messageQueue.Pop( message ) );
+
+	const uint32_t numDropped = numDroppedMessages.exchange( 0U, std::memory_order_relaxed );
+	if ( numDropped > 0U )
+	{
+		Warning( adm::format( "Console: the message queue was full, %u messages were dropped", numDropped ) );
+	}
+}
+
 // ============================
 // Console::LogLine
 // ============================
@@ -353,56 +477,229 @@ void Console::LogLine( const ConsoleMessage& message )
 // ============================
 void Console::Log( const ConsoleMessage& message )
 {
-	constexpr size_t MaxCharacters = 1024ULL;
-
-	const char* string = message.text.c_str();
-	bool hasNewline = message.text.find( '\n' ) != String::npos;
+	const StringView text = message.text;
 
 	// Save us the trouble
-	if ( !hasNewline )
+	if ( text.find( '\n' ) == StringView::npos )
 	{
 		return LogLine( message );
 	}
 
-	size_t start = 0;
-	size_t end = 0;
-
-	char buffer[MaxCharacters];
-	size_t max = std::min( MaxCharacters, std::strlen( string ) );
-
 	// Divide the string by newlines, so for example:
 	// abc\ndef becomes:
 	// abc
 	// def
-	ConsoleMessage lineMessage = message;
-	for ( size_t i = 0U; i < max; i++ )
+	// Each line is a slice of the original text, copied into a message
+	// that is reused across calls, so its capacity only ever grows
+	lineMessage.timeSubmitted = message.timeSubmitted;
+	lineMessage.date = message.date;
+
+	size_t lineStart = 0U;
+	while ( lineStart < text.size() )
 	{
-		if ( string[i] == '\n' && !start && i < max-1 )
+		size_t lineEnd = text.find( '\n', lineStart );
+		if ( lineEnd == StringView::npos )
 		{
-			start = i + 1;
-			end = 0;
-			continue;
+			lineEnd = text.size();
 		}
 
-		// Special case on the right: there was at least one newline,
-		// but there's no newline at the end
-		if ( (string[i] == '\n' && !end) || (i == max-2) )
-		{
-			end = (i == max-2) ? max : i;
+		const StringView line = text.substr( lineStart, lineEnd - lineStart );
+		lineMessage.text.assign( line.data(), line.size() );
+		LogLine( lineMessage );
 
-			// TODO: turn this into adm::SubString
-			// TODO: could've been done using memcpy
-			size_t s;
-			for ( s = 0; s < (end-start); s++ )
-			{
-				buffer[s] = string[start + s];
-			}
-			buffer[s] = '\0';
+		lineStart = lineEnd + 1U;
+	}
+}
+
+// ============================
+// Console::RunLookupBenchmark
+// ============================
+void Console::RunLookupBenchmark( uint32_t numLookups )
+{
+	using Clock = chrono::steady_clock;
+
+	if ( cvarList.empty() )
+	{
+		Warning( "console_lookupBenchmark: there are no CVars" );
+		return;
+	}
+
+	// Random names, with copies of the strings, like typed in commands would be
+	std::mt19937 random( 1U );
+	Vector<String> existingNames;
+	Vector<String> missingNames;
+	existingNames.reserve( numLookups );
+	missingNames.reserve( numLookups );
+	for ( uint32_t i = 0U; i < numLookups; i++ )
+	{
+		const StringView name = cvarList[random() % cvarList.size()]->GetName();
+		existingNames.emplace_back( name );
+		missingNames.emplace_back( String( name ) + "_missing" );
+	}
+
+	size_t numFound = 0U;
+	const Clock::time_point hitStartTime = Clock::now();
+	for ( const String& name : existingNames )
+	{
+		numFound += nullptr != Find( name ) ? 1U : 0U;
+	}
+
+	const Clock::time_point missStartTime = Clock::now();
+	for ( const String& name : missingNames )
+	{
+		numFound += nullptr != Find( name ) ? 1U : 0U;
+	}
 
-			start = 0;
+	// Searching goes through every CVar, so it gets fewer rounds
+	const uint32_t numSearches = std::max( numLookups / 1000U, 1U );
+	const Clock::time_point searchStartTime = Clock::now();
+	for ( uint32_t i = 0U; i < numSearches; i++ )
+	{
+		numFound += Search( StringView( existingNames[i % numLookups] ).substr( 0U, 3U ) ).size();
+	}
 
-			lineMessage.text = buffer;
-			LogLine( lineMessage );
+	// Unregistering and registering the same CVars again, like plugins coming and going
+	const uint32_t numReregistrations = std::min<uint32_t>( numLookups, cvarList.size() );
+	const Clock::time_point reregisterStartTime = Clock::now();
+	for ( uint32_t i = 0U; i < numReregistrations; i++ )
+	{
+		CVarBase* cvar = const_cast<CVarBase*>( Find( existingNames[i] ) );
+		if ( nullptr != cvar )
+		{
+			Unregister( cvar );
+			Register( cvar );
 		}
 	}
+
+	const Clock::time_point endTime = Clock::now();
+	const auto nanoseconds = []( Clock::duration duration )
+	{
+		return chrono::duration<double, std::nano>( duration ).count();
+	};
+
+	Print( adm::format( "Console: Lookup benchmark with %zu CVars, %u lookups:", cvarList.size(), numLookups ) );
+	Print( adm::format( "   * find (hit):         %.1f ns per lookup", nanoseconds( missStartTime - hitStartTime ) / numLookups ) );
+	Print( adm::format( "   * find (miss):        %.1f ns per lookup", nanoseconds( searchStartTime - missStartTime ) / numLookups ) );
+	Print( adm::format( "   * search:             %.1f us per search", nanoseconds( reregisterStartTime - searchStartTime ) / 1000.0 / numSearches ) );
+	Print( adm::format( "   * re-register:        %.1f ns per CVar (%zu)", nanoseconds( endTime - reregisterStartTime ) / std::max( numReregistrations, 1U ), numFound ) );
+}
+
+// ============================
+// ConsoleListenerBenchmark
+// 
+// Stands in for the real listeners during
+// the print benchmark, only counts lines
+// ============================
+class ConsoleListenerBenchmark final : public ConsoleListenerBase
+{
+public:
+	void Init( ICore* core, IConsole* console ) override
+	{
+		ConsoleListenerBase::Init( core, console );
+	}
+
+	void Shutdown() override
+	{
+
+	}
+
+	void OnLog( const ConsoleMessage& message ) override
+	{
+		numLines++;
+	}
+
+	void OnUpdate() override
+	{
+
+	}
+
+	const char* GetName() override
+	{
+		return "Benchmark";
+	}
+
+	size_t numLines{ 0U };
+};
+
+// ============================
+// NullStreamBuffer
+// 
+// Swallows std::cout, so the basic listener
+// can be timed without the terminal
+// ============================
+class NullStreamBuffer final : public std::streambuf
+{
+protected:
+	int_type overflow( int_type character ) override
+	{
+		return traits_type::not_eof( character );
+	}
+
+	std::streamsize xsputn( const char* data, std::streamsize size ) override
+	{
+		return size;
+	}
+};
+
+// ============================
+// Console::RunPrintBenchmark
+// ============================
+void Console::RunPrintBenchmark( uint32_t numLines )
+{
+	using Clock = chrono::steady_clock;
+	constexpr uint32_t LinesPerMessage = 64U;
+
+	// Something like a CVar list or a plugin error report, colour codes included
+	String text;
+	for ( uint32_t i = 0U; i < LinesPerMessage; i++ )
+	{
+		text += adm::format( "   * %sbenchmark_line_%02u%s - printed as a part of a multi-line message\n", PrintYellow, i, PrintGreen );
+	}
+	text.pop_back();
+
+	ConsoleMessage message;
+	message.text = text;
+	message.timeSubmitted = core->Time();
+	const uint32_t numMessages = std::max( numLines / LinesPerMessage, 1U );
+
+	// The real listeners are set aside, so the benchmark doesn't end up in the terminal
+	// or the logs. Other threads only push into the queue, which isn't flushed meanwhile
+	ConsoleListenerBenchmark benchmarkListener;
+	benchmarkListener.Init( core, this );
+	Vector<IConsoleListener*> listeners{ &benchmarkListener };
+	listeners.swap( consoleListeners );
+
+	const Clock::time_point splitStartTime = Clock::now();
+	for ( uint32_t i = 0U; i < numMessages; i++ )
+	{
+		Log( message );
+	}
+
+	// Same messages again, through the basic listener
+	NullStreamBuffer nullStreamBuffer;
+	std::streambuf* outputBuffer = std::cout.rdbuf( &nullStreamBuffer );
+	UniquePtr<IConsoleListener> basicListener( CreateListenerBasic() );
+	basicListener->Init( core, this );
+	consoleListeners[0] = basicListener.get();
+
+	const Clock::time_point basicStartTime = Clock::now();
+	for ( uint32_t i = 0U; i < numMessages; i++ )
+	{
+		Log( message );
+	}
+
+	const Clock::time_point endTime = Clock::now();
+	basicListener->Shutdown();
+	std::cout.rdbuf( outputBuffer );
+	consoleListeners.swap( listeners );
+
+	const auto nanoseconds = []( Clock::duration duration )
+	{
+		return chrono::duration<double, std::nano>( duration ).count();
+	};
+
+	const double numLinesLogged = double( numMessages ) * LinesPerMessage;
+	Print( adm::format( "Console: Print benchmark with %u messages of %u lines:", numMessages, LinesPerMessage ) );
+	Print( adm::format( "   * split into lines:   %.1f ns per line (%zu)", nanoseconds( basicStartTime - splitStartTime ) / numLinesLogged, benchmarkListener.numLines ) );
+	Print( adm::format( "   * basic listener:     %.1f ns per line", nanoseconds( endTime - basicStartTime ) / numLinesLogged ) );
 }
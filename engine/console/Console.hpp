@@ -3,17 +3,31 @@
 
 #pragma once
 
+#include "ConsoleMessageQueue.hpp"
+#include "DeferredRequest.hpp"
+
 class IConsole;
 
 using CVarList = Vector<CVarBase*>;
 
+// Where a CVar is in the CVar list, so it can be unregistered in constant time
+struct CVarSlot
+{
+	CVarBase*	cvar{ nullptr };
+	uint32_t	listIndex{ 0U };
+};
+
+// CVar names are owned by the CVars themselves, so lookups
+// can go through StringViews without allocating anything
+using CVarMap = std::unordered_map<StringView, CVarSlot>;
+
 class Console final : public IConsole
 {
 public:
 	bool		Init( int argc, char** argv ) override;
 	void		Shutdown() override;
 
-	// Called by the engine to update the listeners
+	// Called by the engine to deliver queued messages and update the listeners
 	void		Update();
 	// Called by the engine to execute launch arguments
 	void		ExecuteLaunchArguments();
@@ -32,6 +46,7 @@ public:
 	bool		Execute( StringView command, const ConsoleCommandArgs& args ) override;
 
 	const CVarBase* Find( StringView name ) const override;
+	// Sorted by name
 	Vector<const CVarBase*> Search( StringView nameFragment ) const override;
 
 	const adm::Dictionary& GetArguments() const override;
@@ -41,15 +56,28 @@ public:
 		this->core = core;
 	}
 
+	// Times Find, Search and re-registering CVars during the next Update. Thread-safe
+	void		RequestLookupBenchmark( uint32_t numLookups );
+	// Times splitting multi-line messages and the basic listener during the next Update. Thread-safe
+	void		RequestPrintBenchmark( uint32_t numLines );
+
 	// Glue for the automatic CVar registration system - look at CVarTemplate
 	static inline IConsole* EngineConsole = nullptr; // I trust that nobody will fiddle with this
 
 private:
 	void		ParseArguments( int argc, char** argv );
 
+	bool		IsMainThread() const;
+	// Delivers all queued messages to the listeners
+	// Only ever called on the main thread
+	void		Flush();
+
 	void		LogLine( const ConsoleMessage& message );
 	void		Log( const ConsoleMessage& message );
 
+	void		RunLookupBenchmark( uint32_t numLookups );
+	void		RunPrintBenchmark( uint32_t numLines );
+
 	// ConsoleListenerBasic.cpp
 	// Non-interactive terminal output
 	static IConsoleListener* CreateListenerBasic();
@@ -59,10 +87,27 @@ private:
 	// ConsoleListenerFileOut.cpp
 	// File logger for this console
 	static IConsoleListener* CreateListenerFileOut();
+	// ConsoleListenerBinary.cpp
+	// Compact binary file logger
+	static IConsoleListener* CreateListenerBinary();
 
 private:
 	Vector<IConsoleListener*> consoleListeners;
+	// Print may be called from any thread, messages
+	// wait in here until the main thread flushes them
+	ConsoleMessageQueue messageQueue;
+	// Messages that didn't fit into the queue from other threads
+	std::atomic<uint32_t> numDroppedMessages{ 0U };
+	std::thread::id mainThreadId;
+	// Scratch message for Log, so splitting multi-line
+	// messages doesn't allocate a new string per line
+	ConsoleMessage lineMessage;
+	// For Search & autocomplete, unregistering moves the last CVar into the gap
 	CVarList	cvarList;
+	// Name -> CVar and its index in cvarList, for Find, Execute and Register
+	CVarMap		cvarMap;
+	DeferredRequest<uint32_t> lookupBenchmarkRequest;
+	DeferredRequest<uint32_t> printBenchmarkRequest;
 	Dictionary	arguments;
 	ICore*		core{ nullptr };
 };
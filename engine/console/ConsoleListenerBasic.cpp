@@ -47,30 +47,25 @@ void ConsoleListenerBasic::Shutdown()
 // ============================
 void ConsoleListenerBasic::OnLog( const ConsoleMessage& message )
 {
-	constexpr size_t MaxMessageLength = 1024;
-	const size_t max = std::min( MaxMessageLength, message.text.size() );
+	const StringView text = message.text;
+	size_t segmentStart = 0U;
 
-	const char* string = message.text.c_str();
-	char buffer[MaxMessageLength];
-	size_t position = 0U;
+	std::cout << GenerateTimeString( message.timeSubmitted ) << " | ";
 
 	// Too lazy to implement colours at the moment
-	for ( size_t i = 0U; i < max; i++ )
+	// Write out everything between the $-colour sequences
+	for ( size_t i = 0U; i < text.size(); i++ )
 	{
-		// Initiate the skipping
-		if ( string[i] == PrintColorIdentifier )
+		if ( text[i] == PrintColorIdentifier )
 		{
+			std::cout.write( text.data() + segmentStart, i - segmentStart );
 			i++; // skip the $-colour sequence
-			continue; // does i += 1
+			segmentStart = std::min( i + 1U, text.size() );
 		}
-		// Store the character
-		buffer[position] = string[i];
-		position++;
 	}
 
-	buffer[position] = '\0';
-
-	std::cout << GenerateTimeString( message.timeSubmitted ) << " | " << buffer << std::endl;
+	std::cout.write( text.data() + segmentStart, text.size() - segmentStart );
+	std::cout << std::endl;
 }
 
 // ============================
@@ -0,0 +1,208 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "Console.hpp"
+#include "LogFileWriter.hpp"
+#include "BinaryLogFormat.hpp"
+
+// ============================
+// ConsoleListenerBinary
+// 
+// Writes compact binary logs, see BinaryLogFormat.hpp
+// Decode them with tools/LogDecoder
+// ============================
+class ConsoleListenerBinary final : public ConsoleListenerBase
+{
+public:
+	void Init( ICore* core, IConsole* console ) override;
+	void Shutdown() override;
+
+	void OnLog( const ConsoleMessage& message ) override;
+	void OnUpdate() override;
+
+	const char* GetName() override
+	{
+		return "Binary file output";
+	}
+
+private:
+	// Begins a new file and forgets all formats
+	void StartNewFile();
+
+private:
+	// Past this, a new file is started so the table doesn't grow forever
+	static constexpr size_t MaxFormatsPerFile = 65536U;
+
+	LogFileWriter writer;
+	std::unordered_map<String, uint32_t> formatIds;
+	uint64_t previousTime{ 0U };
+
+	// Reused for every message, to avoid allocating
+	String recordBuffer;
+	String textBuffer;
+	String formatBuffer;
+	Vector<StringView> argumentBuffer;
+
+	// CVars are re-read periodically, not every frame
+	float timeToUpdate{ 1.0f };
+	uint64_t numReportedDroppedBytes{ 0U };
+};
+
+// ============================
+// ConsoleListenerBinary::Init
+// ============================
+void ConsoleListenerBinary::Init( ICore* core, IConsole* console )
+{
+	ConsoleListenerBase::Init( core, console );
+
+	recordBuffer.reserve( 1024U );
+	textBuffer.reserve( 256U );
+	formatBuffer.reserve( 256U );
+	argumentBuffer.reserve( 16U );
+	formatIds.reserve( 1024U );
+
+	LogFileWriterDesc desc = LogFileWriter::GetDescFromCVars();
+	desc.extension = ".btxlog";
+
+	if ( !writer.Start( desc ) )
+	{
+		console->Warning( adm::format( "ConsoleListenerBinary: cannot create a log file in '%s'", desc.directory.string().c_str() ) );
+		return;
+	}
+
+	StartNewFile();
+	console->Print( adm::format( "ConsoleListenerBinary: logging to '%s'", writer.GetCurrentFilePath().string().c_str() ) );
+}
+
+// ============================
+// ConsoleListenerBinary::Shutdown
+// ============================
+void ConsoleListenerBinary::Shutdown()
+{
+	writer.Stop();
+}
+
+// ============================
+// ConsoleListenerBinary::OnLog
+// ============================
+void ConsoleListenerBinary::OnLog( const ConsoleMessage& message )
+{
+	if ( !writer.IsRunning() )
+	{
+		return;
+	}
+
+	if ( writer.ShouldRotate() || formatIds.size() >= MaxFormatsPerFile )
+	{
+		writer.Rotate();
+		StartNewFile();
+	}
+
+	// Colour codes mean nothing in a log file, and would split otherwise identical formats
+	const StringView text = message.text;
+	textBuffer.clear();
+	for ( size_t i = 0U; i < text.size(); i++ )
+	{
+		if ( text[i] == PrintColorIdentifier )
+		{
+			i++; // skip the $-colour sequence
+			continue;
+		}
+
+		textBuffer += text[i];
+	}
+
+	// The arguments point into textBuffer until the record is written
+	recordBuffer.clear();
+	BinaryLog::ExtractTemplate( textBuffer, formatBuffer, argumentBuffer );
+
+	// Formats are written out the first time they're seen in a file, in the same
+	// write as the message, and only remembered if that write went through,
+	// otherwise later messages would refer to a format that isn't in the file
+	const auto formatIterator = formatIds.find( formatBuffer );
+	const bool newFormat = formatIterator == formatIds.end();
+	const uint32_t formatId = newFormat ? uint32_t( formatIds.size() ) : formatIterator->second;
+	if ( newFormat )
+	{
+		recordBuffer += char( BinaryLog::RecordFormat );
+		BinaryLog::WriteVarint( recordBuffer, formatId );
+		BinaryLog::WriteString( recordBuffer, formatBuffer );
+	}
+
+	// Core::Time is in seconds, but deltas in microseconds pack into 1-3 bytes
+	const uint64_t time = std::max( 0.0f, message.timeSubmitted ) * 1'000'000.0;
+	const uint64_t timeDelta = time > previousTime ? time - previousTime : 0U;
+
+	recordBuffer += char( BinaryLog::RecordMessage );
+	BinaryLog::WriteVarint( recordBuffer, timeDelta );
+	BinaryLog::WriteVarint( recordBuffer, formatId );
+	BinaryLog::WriteVarint( recordBuffer, argumentBuffer.size() );
+	for ( const StringView& argument : argumentBuffer )
+	{
+		BinaryLog::WriteString( recordBuffer, argument );
+	}
+
+	// Dropped messages don't exist as far as the decoder is concerned
+	if ( !writer.Write( recordBuffer ) )
+	{
+		return;
+	}
+
+	previousTime = std::max( time, previousTime );
+	if ( newFormat )
+	{
+		formatIds.emplace( formatBuffer, formatId );
+	}
+}
+
+// ============================
+// ConsoleListenerBinary::OnUpdate
+// ============================
+void ConsoleListenerBinary::OnUpdate()
+{
+	if ( !writer.IsRunning() )
+	{
+		return;
+	}
+
+	timeToUpdate -= core->DeltaTime();
+	if ( timeToUpdate > 0.0f )
+	{
+		return;
+	}
+
+	timeToUpdate = 1.0f;
+	writer.UpdateDesc( LogFileWriter::GetDescFromCVars() );
+
+	const uint64_t numDroppedBytes = writer.GetNumDroppedBytes();
+	if ( numDroppedBytes > numReportedDroppedBytes )
+	{
+		console->Warning( adm::format( "ConsoleListenerBinary: the disk can't keep up, dropped %llu bytes of log data so far",
+			static_cast<unsigned long long>( numDroppedBytes ) ) );
+		numReportedDroppedBytes = numDroppedBytes;
+	}
+}
+
+// ============================
+// ConsoleListenerBinary::StartNewFile
+// ============================
+void ConsoleListenerBinary::StartNewFile()
+{
+	formatIds.clear();
+	previousTime = 0U;
+
+	recordBuffer.clear();
+	BinaryLog::WriteHeader( recordBuffer );
+
+	// Without the header, the decoder rejects the whole file
+	writer.Write( recordBuffer, true );
+}
+
+// ============================
+// Console::CreateListenerBinary
+// ============================
+IConsoleListener* Console::CreateListenerBinary()
+{
+	return new ConsoleListenerBinary();
+}
@@ -3,9 +3,153 @@
 
 #include "common/Precompiled.hpp"
 #include "Console.hpp"
+#include "LogFileWriter.hpp"
 
-// The file logger is currently not implemented
+// ============================
+// ConsoleListenerFileOut
+// ============================
+class ConsoleListenerFileOut final : public ConsoleListenerBase
+{
+public:
+	void Init( ICore* core, IConsole* console ) override;
+	void Shutdown() override;
+
+	void OnLog( const ConsoleMessage& message ) override;
+	void OnUpdate() override;
+
+	const char* GetName() override
+	{
+		return "File output";
+	}
+
+private:
+	const char* GenerateTimeString( float time );
+
+private:
+	LogFileWriter writer;
+	// Reused for every line, to avoid allocating
+	String lineBuffer;
+	// CVars are re-read periodically, not every frame
+	float timeToUpdate{ 1.0f };
+	uint64_t numReportedDroppedBytes{ 0U };
+};
+
+// ============================
+// ConsoleListenerFileOut::Init
+// ============================
+void ConsoleListenerFileOut::Init( ICore* core, IConsole* console )
+{
+	ConsoleListenerBase::Init( core, console );
+
+	lineBuffer.reserve( 1024U );
+
+	const LogFileWriterDesc desc = LogFileWriter::GetDescFromCVars();
+
+	if ( !writer.Start( desc ) )
+	{
+		console->Warning( adm::format( "ConsoleListenerFileOut: cannot create a log file in '%s'", desc.directory.string().c_str() ) );
+		return;
+	}
+
+	console->Print( adm::format( "ConsoleListenerFileOut: logging to '%s'", writer.GetCurrentFilePath().string().c_str() ) );
+}
+
+// ============================
+// ConsoleListenerFileOut::Shutdown
+// ============================
+void ConsoleListenerFileOut::Shutdown()
+{
+	writer.Stop();
+}
+
+// ============================
+// ConsoleListenerFileOut::OnLog
+// ============================
+void ConsoleListenerFileOut::OnLog( const ConsoleMessage& message )
+{
+	if ( !writer.IsRunning() )
+	{
+		return;
+	}
+
+	const StringView text = message.text;
+
+	lineBuffer.clear();
+	lineBuffer += GenerateTimeString( message.timeSubmitted );
+	lineBuffer += " | ";
+
+	// Colour codes mean nothing in a text file
+	for ( size_t i = 0U; i < text.size(); i++ )
+	{
+		if ( text[i] == PrintColorIdentifier )
+		{
+			i++; // skip the $-colour sequence
+			continue;
+		}
+
+		lineBuffer += text[i];
+	}
+
+	lineBuffer += '\n';
+
+	if ( writer.ShouldRotate() )
+	{
+		writer.Rotate();
+	}
+
+	writer.Write( lineBuffer );
+}
+
+// ============================
+// ConsoleListenerFileOut::OnUpdate
+// ============================
+void ConsoleListenerFileOut::OnUpdate()
+{
+	if ( !writer.IsRunning() )
+	{
+		return;
+	}
+
+	timeToUpdate -= core->DeltaTime();
+	if ( timeToUpdate > 0.0f )
+	{
+		return;
+	}
+
+	timeToUpdate = 1.0f;
+	writer.UpdateDesc( LogFileWriter::GetDescFromCVars() );
+
+	const uint64_t numDroppedBytes = writer.GetNumDroppedBytes();
+	if ( numDroppedBytes > numReportedDroppedBytes )
+	{
+		console->Warning( adm::format( "ConsoleListenerFileOut: the disk can't keep up, dropped %llu bytes of log data so far",
+			static_cast<unsigned long long>( numDroppedBytes ) ) );
+		numReportedDroppedBytes = numDroppedBytes;
+	}
+}
+
+// ============================
+// ConsoleListenerFileOut::GenerateTimeString
+// ============================
+const char* ConsoleListenerFileOut::GenerateTimeString( float time )
+{
+	// mmm:ss.sss
+	static char buffer[16];
+
+	const int iTime = time;
+	const int seconds = int( time ) % 60;
+	const int minutes = iTime / 60;
+
+	const float flSeconds = seconds + (time - iTime);
+
+	sprintf( buffer, "%03i:%06.3f", minutes, flSeconds );
+	return buffer;
+}
+
+// ============================
+// Console::CreateListenerFileOut
+// ============================
 IConsoleListener* Console::CreateListenerFileOut()
 {
-	return nullptr;
+	return new ConsoleListenerFileOut();
 }
@@ -42,16 +42,18 @@ private:
 	static Element ConsoleMessageToFtxElement( const ConsoleMessage& message );
 
 private:
-	bool stopListening{ false };
+	std::atomic<bool> stopListening{ false };
+	// OnLog appends on the main thread while the listener thread renders
+	std::mutex messagesMutex;
 	Vector<ConsoleMessage> messages{};
 
 	// TODO: replace std::thread stuff with a job system later on
 	std::thread listenerThread;
-	float timeToUpdate{ 0.1f };
+	std::atomic<float> timeToUpdate{ 0.1f };
 	// The user has entered a new command, jump to bottom to see the output
-	bool jumpToBottom{ false };
+	std::atomic<bool> jumpToBottom{ false };
 	// The user has entered a new command, execute it on the main thread
-	bool executeCommand{ false };
+	std::atomic<bool> executeCommand{ false };
 
 	// User input string
 	String userInput{ "" };
@@ -120,6 +122,8 @@ void ConsoleListenerInteractive::Init( ICore* core, IConsole* console )
 
 	messageFrameComponent = Renderer( [&]
 		{
+			std::lock_guard<std::mutex> lock( messagesMutex );
+
 			Elements consoleMessageElements{};
 			for ( const auto& message : messages )
 			{
@@ -207,8 +211,12 @@ void ConsoleListenerInteractive::Shutdown()
 // ============================
 void ConsoleListenerInteractive::OnLog( const ConsoleMessage& message )
 {
-	messages.push_back( message );
-	timeToUpdate = -1.0f; // update and scroll all the way down
+	{
+		std::lock_guard<std::mutex> lock( messagesMutex );
+		messages.push_back( message );
+	}
+
+	timeToUpdate.store( -1.0f, std::memory_order_relaxed ); // update and scroll all the way down
 	jumpToBottom = true;
 }
 
@@ -223,14 +231,15 @@ void ConsoleListenerInteractive::OnUpdate()
 		executeCommand = false;
 	}
 
-	timeToUpdate -= core->DeltaTime();
-	if ( timeToUpdate > 0.0f || stopListening )
+	const float timeLeft = timeToUpdate.load( std::memory_order_relaxed ) - core->DeltaTime();
+	timeToUpdate.store( timeLeft, std::memory_order_relaxed );
+	if ( timeLeft > 0.0f || stopListening )
 	{
 		return;
 	}
 
 	screen.PostEvent( Event::Custom );
-	timeToUpdate = 0.1f;
+	timeToUpdate.store( 0.1f, std::memory_order_relaxed );
 }
 
 // ============================
@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "ConsoleMessageQueue.hpp"
+
+// ============================
+// ConsoleMessageQueue::ctor
+// ============================
+ConsoleMessageQueue::ConsoleMessageQueue( size_t capacity )
+{
+	size_t powerOfTwo = 2U;
+	while ( powerOfTwo < capacity )
+	{
+		powerOfTwo <<= 1U;
+	}
+
+	cells = std::make_unique<Cell[]>( powerOfTwo );
+	mask = powerOfTwo - 1U;
+
+	for ( size_t i = 0U; i < powerOfTwo; i++ )
+	{
+		cells[i].sequence.store( i, std::memory_order_relaxed );
+	}
+}
+
+// ============================
+// ConsoleMessageQueue::Push
+// ============================
+bool ConsoleMessageQueue::Push( ConsoleMessage&& message )
+{
+	Cell* cell = nullptr;
+	size_t position = enqueuePosition.load( std::memory_order_relaxed );
+
+	while ( true )
+	{
+		cell = &cells[position & mask];
+		const size_t sequence = cell->sequence.load( std::memory_order_acquire );
+		const intptr_t difference = intptr_t( sequence ) - intptr_t( position );
+
+		// The cell is free, try claiming it
+		if ( difference == 0 )
+		{
+			if ( enqueuePosition.compare_exchange_weak( position, position + 1U, std::memory_order_relaxed ) )
+			{
+				break;
+			}
+		}
+		// The consumer hasn't caught up with this cell yet
+		else if ( difference < 0 )
+		{
+			return false;
+		}
+		// Another producer claimed it first
+		else
+		{
+			position = enqueuePosition.load( std::memory_order_relaxed );
+		}
+	}
+
+	cell->message = std::move( message );
+	cell->sequence.store( position + 1U, std::memory_order_release );
+	return true;
+}
+
+// ============================
+// ConsoleMessageQueue::Pop
+// ============================
+bool ConsoleMessageQueue::Pop( ConsoleMessage& outMessage )
+{
+	Cell& cell = cells[dequeuePosition & mask];
+	const size_t sequence = cell.sequence.load( std::memory_order_acquire );
+
+	// Either empty, or a producer is still writing into this cell
+	if ( sequence != dequeuePosition + 1U )
+	{
+		return false;
+	}
+
+	outMessage = std::move( cell.message );
+	// Hand the cell back to producers for the next lap
+	cell.sequence.store( dequeuePosition + mask + 1U, std::memory_order_release );
+	dequeuePosition++;
+	return true;
+}
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// ConsoleMessageQueue
+// 
+// Bounded multi-producer, single-consumer ring buffer
+// Any thread may push messages, only the main thread pops them
+// 
+// Every cell carries a sequence number, so producers only ever
+// contend on the enqueue position, and never on each other's cells
+// (Dmitry Vyukov's bounded queue, reduced to a single consumer)
+// ============================
+class ConsoleMessageQueue final
+{
+public:
+	// Capacity gets rounded up to a power of two
+	ConsoleMessageQueue( size_t capacity = 4096U );
+
+	// Returns false if the queue is full
+	bool		Push( ConsoleMessage&& message );
+	// Returns false if the queue is empty
+	// Must only be called from one thread
+	bool		Pop( ConsoleMessage& outMessage );
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence{ 0U };
+		ConsoleMessage message;
+	};
+
+	UniquePtr<Cell[]> cells;
+	size_t		mask{ 0U };
+
+	// Kept on separate cache lines so producers don't thrash the consumer
+	alignas( 64 ) std::atomic<size_t> enqueuePosition{ 0U };
+	alignas( 64 ) size_t dequeuePosition{ 0U };
+};
@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// DeferredRequest
+//
+// Work that's asked for now, but done later by whoever owns it, e.g.
+// a benchmark asked for by a console command that runs during the
+// subsystem's next Update, where nothing else is in the middle of
+// using its state. Asking again before then replaces the request
+// Both methods are thread-safe
+// ============================
+template<typename T>
+class DeferredRequest final
+{
+public:
+	void				Request( T value )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		request = std::move( value );
+	}
+
+	// Returns the request if there is one, and forgets it
+	Optional<T>			Take()
+	{
+		Optional<T> taken;
+		std::lock_guard<std::mutex> lock( mutex );
+		taken.swap( request );
+		return taken;
+	}
+
+private:
+	std::mutex			mutex;
+	Optional<T>			request;
+};
@@ -0,0 +1,327 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "Console.hpp"
+#include "LogFileWriter.hpp"
+
+#include <ctime>
+
+namespace fs = std::filesystem;
+
+CVar log_directory( "log_directory", "logs", 0, "Directory for log files, only read when the file logger starts" );
+CVar log_maxFileSize( "log_maxFileSize", "16", 0, "Size of a log file in megabytes, after which a new one is started. 0 disables this" );
+CVar log_rotateInterval( "log_rotateInterval", "0", 0, "Minutes after which a new log file is started. 0 disables this" );
+CVar log_flushInterval( "log_flushInterval", "1", 0, "Seconds between log file writes, if there isn't a lot to write" );
+CVar log_maxBufferSize( "log_maxBufferSize", "4096", 0, "Kilobytes of log data that may wait to be written" );
+CVar log_overflowPolicy( "log_overflowPolicy", "drop", 0, "What to do when the log buffer is full: 'drop' or 'block'" );
+
+// ============================
+// LogFileWriter::dtor
+// ============================
+LogFileWriter::~LogFileWriter()
+{
+	Stop();
+}
+
+// ============================
+// LogFileWriter::Start
+// ============================
+bool LogFileWriter::Start( const LogFileWriterDesc& writerDesc )
+{
+	if ( running )
+	{
+		return true;
+	}
+
+	desc = writerDesc;
+
+	std::error_code error;
+	fs::create_directories( desc.directory, error );
+
+	if ( !OpenNewFile() )
+	{
+		return false;
+	}
+
+	pendingData.reserve( CoalesceSize * 2U );
+	writingData.reserve( CoalesceSize * 2U );
+	bytesSinceRotation = 0U;
+	rotationTime = chrono::steady_clock::now();
+	stopRequested = false;
+	running = true;
+
+	writerThread = std::thread( [this]
+		{
+			WriterThread();
+		} );
+
+	return true;
+}
+
+// ============================
+// LogFileWriter::Stop
+// ============================
+void LogFileWriter::Stop()
+{
+	if ( !running )
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		stopRequested = true;
+	}
+	wakeWriter.notify_one();
+	spaceAvailable.notify_all();
+	writerThread.join();
+
+	if ( nullptr != file )
+	{
+		std::fclose( file );
+		file = nullptr;
+	}
+
+	running = false;
+}
+
+// ============================
+// LogFileWriter::GetDescFromCVars
+// ============================
+LogFileWriterDesc LogFileWriter::GetDescFromCVars()
+{
+	LogFileWriterDesc desc;
+	desc.directory = String( log_directory.GetString() );
+	desc.maxFileSize = std::max( 0.0f, log_maxFileSize.GetFloat() ) * 1024.0f * 1024.0f;
+	desc.rotationInterval = std::max( 0.0f, log_rotateInterval.GetFloat() ) * 60.0f;
+	desc.flushInterval = log_flushInterval.GetFloat();
+	desc.maxBufferSize = std::max( 64, log_maxBufferSize.GetInt() ) * 1024U;
+	desc.overflowPolicy = log_overflowPolicy.GetString() == StringView( "block" ) ? LogOverflowPolicy::Block : LogOverflowPolicy::Drop;
+	return desc;
+}
+
+// ============================
+// LogFileWriter::UpdateDesc
+// ============================
+void LogFileWriter::UpdateDesc( const LogFileWriterDesc& writerDesc )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	desc.maxFileSize = writerDesc.maxFileSize;
+	desc.rotationInterval = writerDesc.rotationInterval;
+	desc.flushInterval = writerDesc.flushInterval;
+	desc.maxBufferSize = writerDesc.maxBufferSize;
+	desc.overflowPolicy = writerDesc.overflowPolicy;
+}
+
+// ============================
+// LogFileWriter::Write
+// ============================
+bool LogFileWriter::Write( StringView data, bool neverDrop )
+{
+	std::unique_lock<std::mutex> lock( mutex );
+	if ( !running || stopRequested )
+	{
+		return false;
+	}
+
+	const auto fits = [&]()
+	{
+		// Oversized data is still accepted once everything else is out
+		return pendingData.empty() || pendingData.size() + data.size() <= desc.maxBufferSize;
+	};
+
+	if ( !fits() )
+	{
+		if ( desc.overflowPolicy == LogOverflowPolicy::Drop && !neverDrop )
+		{
+			numDroppedBytes += data.size();
+			return false;
+		}
+
+		flushRequested = true;
+		wakeWriter.notify_one();
+		spaceAvailable.wait( lock, [&]()
+			{
+				return fits() || stopRequested;
+			} );
+
+		if ( stopRequested )
+		{
+			return false;
+		}
+	}
+
+	pendingData.append( data.data(), data.size() );
+	bytesSinceRotation += data.size();
+
+	if ( pendingData.size() >= CoalesceSize )
+	{
+		lock.unlock();
+		wakeWriter.notify_one();
+	}
+
+	return true;
+}
+
+// ============================
+// LogFileWriter::Rotate
+// ============================
+void LogFileWriter::Rotate()
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	pendingRotations.push_back( pendingData.size() );
+	bytesSinceRotation = 0U;
+	rotationTime = chrono::steady_clock::now();
+}
+
+// ============================
+// LogFileWriter::ShouldRotate
+// ============================
+bool LogFileWriter::ShouldRotate() const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+
+	if ( desc.maxFileSize > 0U && bytesSinceRotation >= desc.maxFileSize )
+	{
+		return true;
+	}
+
+	if ( desc.rotationInterval > 0.0f )
+	{
+		const chrono::duration<float> age = chrono::steady_clock::now() - rotationTime;
+		return age.count() >= desc.rotationInterval;
+	}
+
+	return false;
+}
+
+// ============================
+// LogFileWriter::IsRunning
+// ============================
+bool LogFileWriter::IsRunning() const
+{
+	return running;
+}
+
+// ============================
+// LogFileWriter::GetNumDroppedBytes
+// ============================
+uint64_t LogFileWriter::GetNumDroppedBytes() const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	return numDroppedBytes;
+}
+
+// ============================
+// LogFileWriter::GetCurrentFilePath
+// ============================
+Path LogFileWriter::GetCurrentFilePath() const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	return currentFilePath;
+}
+
+// ============================
+// LogFileWriter::WriterThread
+// ============================
+void LogFileWriter::WriterThread()
+{
+	std::unique_lock<std::mutex> lock( mutex );
+
+	while ( true )
+	{
+		const auto flushInterval = chrono::duration<float>( std::max( desc.flushInterval, 0.01f ) );
+		wakeWriter.wait_for( lock, flushInterval, [&]()
+			{
+				return stopRequested || flushRequested || pendingData.size() >= CoalesceSize;
+			} );
+
+		flushRequested = false;
+
+		if ( pendingData.empty() && pendingRotations.empty() )
+		{
+			if ( stopRequested )
+			{
+				break;
+			}
+			continue;
+		}
+
+		// Take everything that's pending in one go, producers
+		// can keep appending to the other buffer meanwhile
+		std::swap( pendingData, writingData );
+		std::swap( pendingRotations, writingRotations );
+		lock.unlock();
+		spaceAvailable.notify_all();
+
+		size_t offset = 0U;
+		for ( const size_t rotationOffset : writingRotations )
+		{
+			WriteToFile( writingData.data() + offset, rotationOffset - offset );
+			offset = rotationOffset;
+
+			lock.lock();
+			OpenNewFile();
+			lock.unlock();
+		}
+
+		WriteToFile( writingData.data() + offset, writingData.size() - offset );
+		if ( nullptr != file )
+		{
+			std::fflush( file );
+		}
+
+		writingData.clear();
+		writingRotations.clear();
+
+		lock.lock();
+	}
+}
+
+// ============================
+// LogFileWriter::OpenNewFile
+// ============================
+bool LogFileWriter::OpenNewFile()
+{
+	if ( nullptr != file )
+	{
+		std::fclose( file );
+		file = nullptr;
+	}
+
+	const std::time_t now = std::time( nullptr );
+	char timeString[32];
+	std::strftime( timeString, sizeof( timeString ), "%Y-%m-%d_%H-%M-%S", std::localtime( &now ) );
+
+	// Rotating more than once per second would produce the same name
+	Path filePath = desc.directory / (desc.baseName + "_" + timeString + desc.extension);
+	for ( int i = 1; fs::exists( filePath ); i++ )
+	{
+		filePath = desc.directory / (desc.baseName + "_" + timeString + "_" + std::to_string( i ) + desc.extension);
+	}
+
+	file = std::fopen( filePath.string().c_str(), "wb" );
+	if ( nullptr == file )
+	{
+		return false;
+	}
+
+	// Writes are already coalesced, stdio's buffer would only add a copy
+	std::setvbuf( file, nullptr, _IONBF, 0 );
+	currentFilePath = filePath;
+	return true;
+}
+
+// ============================
+// LogFileWriter::WriteToFile
+// ============================
+void LogFileWriter::WriteToFile( const char* data, size_t size )
+{
+	if ( nullptr == file || 0U == size )
+	{
+		return;
+	}
+
+	std::fwrite( data, 1U, size, file );
+}
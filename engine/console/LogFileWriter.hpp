@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+
+// What to do when the disk can't keep up and the buffer is full
+enum class LogOverflowPolicy : uint8_t
+{
+	// Throw away the incoming data and count it
+	Drop,
+	// Wait for the writer thread to make space
+	Block
+};
+
+struct LogFileWriterDesc
+{
+	// Where log files go, relative to the working directory
+	Path				directory{ "logs" };
+	// Log files are named <baseName>_<date>_<time><extension>
+	String				baseName{ "console" };
+	String				extension{ ".log" };
+	// Size of the current file after which a new one is started, 0 disables this
+	size_t				maxFileSize{ 16U * 1024U * 1024U };
+	// Seconds after which a new file is started, 0 disables this
+	float				rotationInterval{ 0.0f };
+	// The writer thread wakes up at least this often
+	float				flushInterval{ 1.0f };
+	// Upper bound of data waiting to be written
+	size_t				maxBufferSize{ 4U * 1024U * 1024U };
+	LogOverflowPolicy	overflowPolicy{ LogOverflowPolicy::Drop };
+};
+
+// ============================
+// LogFileWriter
+// 
+// Appends to a log file from a background thread
+// Producers append to a buffer, the writer thread swaps it out
+// and writes it in one go, so the disk sees few, large writes
+// 
+// Rotation is requested by the producer side, which lets the caller
+// emit per-file headers at the exact point where a new file begins
+// ============================
+class LogFileWriter final
+{
+public:
+	~LogFileWriter();
+
+	// Opens the first file and starts the writer thread
+	bool				Start( const LogFileWriterDesc& desc );
+	// Writes out everything that's pending and joins the writer thread
+	void				Stop();
+
+	// Fills in the directory, limits and policies from the log_* CVars
+	static LogFileWriterDesc GetDescFromCVars();
+
+	// Limits and policies may change at runtime, the directory and names may not
+	void				UpdateDesc( const LogFileWriterDesc& desc );
+
+	// Returns false if the data was dropped due to the overflow policy
+	// neverDrop waits for space regardless of the policy, for data
+	// that the rest of the file can't do without, like headers
+	bool				Write( StringView data, bool neverDrop = false );
+	// Everything written after this goes into a new file
+	void				Rotate();
+	// True when the current file has exceeded its size or age
+	bool				ShouldRotate() const;
+
+	bool				IsRunning() const;
+	uint64_t			GetNumDroppedBytes() const;
+	Path				GetCurrentFilePath() const;
+
+private:
+	void				WriterThread();
+	// Only called on the writer thread, or before it starts
+	bool				OpenNewFile();
+	void				WriteToFile( const char* data, size_t size );
+
+private:
+	// The writer thread gets woken up early if this much is waiting
+	static constexpr size_t CoalesceSize = 64U * 1024U;
+
+	LogFileWriterDesc	desc;
+
+	mutable std::mutex	mutex;
+	std::condition_variable wakeWriter;
+	std::condition_variable spaceAvailable;
+	std::thread			writerThread;
+	bool				running{ false };
+	bool				stopRequested{ false };
+	// A blocked producer is waiting for the buffer to be emptied
+	bool				flushRequested{ false };
+
+	// Filled by producers
+	String				pendingData;
+	// Offsets into pendingData at which a new file begins
+	Vector<size_t>		pendingRotations;
+	// Owned by the writer thread while it's writing
+	String				writingData;
+	Vector<size_t>		writingRotations;
+
+	// Producer-side bookkeeping of the current file
+	size_t				bytesSinceRotation{ 0U };
+	chrono::steady_clock::time_point rotationTime;
+	uint64_t			numDroppedBytes{ 0U };
+
+	std::FILE*			file{ nullptr };
+	Path				currentFilePath;
+};
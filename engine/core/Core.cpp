@@ -90,6 +90,22 @@ void Core::SetDeltaTime( const float& newDeltaTime )
 	deltaTime = newDeltaTime;
 }
 
+// ============================
+// Core::InterpolationAlpha
+// ============================
+float Core::InterpolationAlpha() const
+{
+	return interpolationAlpha;
+}
+
+// ============================
+// Core::SetInterpolationAlpha
+// ============================
+void Core::SetInterpolationAlpha( const float& newInterpolationAlpha )
+{
+	interpolationAlpha = newInterpolationAlpha;
+}
+
 // ============================
 // Core::IsHeadless
 // ============================
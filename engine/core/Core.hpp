@@ -19,6 +19,13 @@ public:
 	float		DeltaTime() const override;
 	// For the engine to set delta time
 	void		SetDeltaTime( const float& newDeltaTime );
+
+	// With a fixed timestep, how far the current frame is between
+	// the previous and the next simulation step, from 0 to 1
+	// Always 1 without a fixed timestep
+	float		InterpolationAlpha() const;
+	// For the engine to set interpolation alpha
+	void		SetInterpolationAlpha( const float& newInterpolationAlpha );
 	
 	bool		IsHeadless() const override;
 	// For the engine to set headless state
@@ -36,4 +43,5 @@ private:
 	Vector<IWindow*> windows{};
 	adm::Timer	systemTimer;
 	float		deltaTime{ 0.0f };
+	float		interpolationAlpha{ 1.0f };
 };
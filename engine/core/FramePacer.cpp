@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "FramePacer.hpp"
+#include "../profiler/Profiler.hpp"
+
+#include <cmath>
+
+// ============================
+// FramePacer::WaitForNextFrame
+// ============================
+double FramePacer::WaitForNextFrame( double frameTime, FramePacingMode mode )
+{
+	BTX_PROFILE_FUNCTION();
+
+	const auto frameDuration = chrono::duration_cast<Clock::duration>( chrono::duration<double>( frameTime ) );
+
+	if ( !started )
+	{
+		started = true;
+		previousFrameStart = Clock::now();
+		nextFrameStart = previousFrameStart + frameDuration;
+		return frameTime;
+	}
+
+	switch ( mode )
+	{
+	case FramePacingMode::Sleep:	std::this_thread::sleep_until( nextFrameStart ); break;
+	case FramePacingMode::Hybrid:	SleepUntil( nextFrameStart, true ); break;
+	case FramePacingMode::Spin:		SleepUntil( nextFrameStart, false ); break;
+	}
+
+	const Clock::time_point frameStart = Clock::now();
+	const double error = chrono::duration<double, std::micro>( frameStart - nextFrameStart ).count();
+	RecordError( error, frameTime * 1'000'000.0 );
+
+	// If we're more than a frame late, there's no point in
+	// rushing the next frames to catch up, start over from now
+	if ( frameStart - nextFrameStart > frameDuration )
+	{
+		nextFrameStart = frameStart + frameDuration;
+	}
+	else
+	{
+		nextFrameStart += frameDuration;
+	}
+
+	const double deltaTime = chrono::duration<double>( frameStart - previousFrameStart ).count();
+	previousFrameStart = frameStart;
+	return deltaTime;
+}
+
+// ============================
+// FramePacer::Reset
+// ============================
+void FramePacer::Reset()
+{
+	started = false;
+}
+
+// ============================
+// FramePacer::GetStatistics
+// ============================
+const FramePacerStatistics& FramePacer::GetStatistics() const
+{
+	return statistics;
+}
+
+// ============================
+// FramePacer::ResetStatistics
+// ============================
+void FramePacer::ResetStatistics()
+{
+	statistics = {};
+	errorSum = 0.0;
+	errorSquaredSum = 0.0;
+}
+
+// ============================
+// FramePacer::SleepUntil
+// ============================
+void FramePacer::SleepUntil( Clock::time_point deadline, bool spinAtEnd )
+{
+	if ( spinAtEnd )
+	{
+		// Sleep in steps, each one learning how much the OS oversleeps,
+		// until the remaining time is within the expected oversleep
+		while ( true )
+		{
+			const double remaining = chrono::duration<double, std::micro>( deadline - Clock::now() ).count();
+			if ( remaining <= sleepOvershoot )
+			{
+				break;
+			}
+
+			const double requested = std::min( remaining - sleepOvershoot, 1000.0 );
+			const Clock::time_point sleepStart = Clock::now();
+			std::this_thread::sleep_for( chrono::duration<double, std::micro>( requested ) );
+			const double slept = chrono::duration<double, std::micro>( Clock::now() - sleepStart ).count();
+
+			// Go up quickly, come down slowly, oversleeping is worse than spinning a bit longer
+			const double overshoot = std::max( slept - requested, 0.0 );
+			sleepOvershoot = overshoot > sleepOvershoot
+				? overshoot
+				: sleepOvershoot * 0.95 + overshoot * 0.05;
+		}
+	}
+
+	while ( Clock::now() < deadline )
+	{
+		std::this_thread::yield();
+	}
+}
+
+// ============================
+// FramePacer::RecordError
+// ============================
+void FramePacer::RecordError( double errorMicroseconds, double frameTimeMicroseconds )
+{
+	statistics.numFrames++;
+	if ( errorMicroseconds > frameTimeMicroseconds )
+	{
+		statistics.numMissedFrames++;
+	}
+
+	errorSum += errorMicroseconds;
+	errorSquaredSum += errorMicroseconds * errorMicroseconds;
+
+	const double numFrames = statistics.numFrames;
+	statistics.meanError = errorSum / numFrames;
+	statistics.maxError = std::max( statistics.maxError, errorMicroseconds );
+	statistics.standardDeviation = std::sqrt( std::max( 0.0, errorSquaredSum / numFrames - statistics.meanError * statistics.meanError ) );
+}
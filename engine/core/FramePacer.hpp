@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+enum class FramePacingMode : uint8_t
+{
+	// Sleep until the deadline, cheapest, least precise
+	Sleep = 0,
+	// Sleep most of the way, then spin for the last stretch
+	Hybrid = 1,
+	// Spin (and yield) the whole way, burns a core
+	Spin = 2
+};
+
+// Deviation of actual frame starts from their deadlines
+struct FramePacerStatistics
+{
+	uint32_t			numFrames{ 0U };
+	// Frames that started more than a whole frame late
+	uint32_t			numMissedFrames{ 0U };
+	// In microseconds, late wakeups are positive
+	double				meanError{ 0.0 };
+	double				maxError{ 0.0 };
+	double				standardDeviation{ 0.0 };
+};
+
+// ============================
+// FramePacer
+// 
+// Caps the frame rate with absolute deadlines: every deadline
+// is the previous one plus the frame time, so wakeup errors
+// don't accumulate into drift like relative sleeps do
+// 
+// The OS usually oversleeps, so in hybrid mode the pacer
+// learns by how much, wakes up that much earlier, and spins
+// ============================
+class FramePacer final
+{
+public:
+	// Returns the time between the previous and the current frame start, in seconds
+	double				WaitForNextFrame( double frameTime, FramePacingMode mode );
+	// Forget the deadline, e.g. after a long hitch or a loading screen
+	void				Reset();
+
+	const FramePacerStatistics& GetStatistics() const;
+	void				ResetStatistics();
+
+private:
+	using Clock = chrono::steady_clock;
+
+	void				SleepUntil( Clock::time_point deadline, bool spinAtEnd );
+	void				RecordError( double errorMicroseconds, double frameTimeMicroseconds );
+
+private:
+	bool				started{ false };
+	Clock::time_point	nextFrameStart;
+	Clock::time_point	previousFrameStart;
+
+	// Running estimate of how far sleep_for oversleeps, in microseconds
+	double				sleepOvershoot{ 1000.0 };
+
+	FramePacerStatistics statistics;
+	double				errorSum{ 0.0 };
+	double				errorSquaredSum{ 0.0 };
+};
@@ -0,0 +1,514 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "AsyncFileQueue.hpp"
+#include "IoUring.hpp"
+
+#include <cerrno>
+
+#if ADM_PLATFORM == PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ============================
+// AsyncFileQueue::ctor
+// ============================
+AsyncFileQueue::AsyncFileQueue() = default;
+
+// ============================
+// AsyncFileQueue::dtor
+// ============================
+AsyncFileQueue::~AsyncFileQueue()
+{
+	Shutdown();
+}
+
+// ============================
+// AsyncFileQueue::Init
+// ============================
+bool AsyncFileQueue::Init( IConsole* console, std::shared_ptr<FileBufferPool> bufferPool, std::function<FileView( const Path& )> readFunction, bool allowIoUring )
+{
+	this->console = console;
+	this->bufferPool = std::move( bufferPool );
+	this->readFunction = std::move( readFunction );
+	stopRequested = false;
+
+	if ( allowIoUring )
+	{
+		ioUring = std::make_unique<IoUring>();
+		if ( !ioUring->Init( IoUringDepth ) )
+		{
+			ioUring.reset();
+		}
+	}
+
+	if ( nullptr != ioUring )
+	{
+		threads.emplace_back( [this]
+			{
+				IoUringThread();
+			} );
+
+		console->Print( "AsyncFileQueue: Using io_uring" );
+		return true;
+	}
+
+	for ( uint32_t i = 0U; i < NumPoolThreads; i++ )
+	{
+		threads.emplace_back( [this]
+			{
+				PoolThread();
+			} );
+	}
+
+	console->Print( adm::format( "AsyncFileQueue: Using %u reader threads", NumPoolThreads ) );
+	return true;
+}
+
+// ============================
+// AsyncFileQueue::Shutdown
+// ============================
+void AsyncFileQueue::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		stopRequested = true;
+
+		for ( auto& requests : pendingRequests )
+		{
+			requests.clear();
+		}
+		activeRequests.clear();
+	}
+	wakeThreads.notify_all();
+
+	for ( auto& thread : threads )
+	{
+		thread.join();
+	}
+	threads.clear();
+	ioUring.reset();
+	abandonedBuffers.clear();
+
+	// Whoever submitted these may be gone by now
+	std::lock_guard<std::mutex> lock( completionMutex );
+	completedRequests.clear();
+}
+
+// ============================
+// AsyncFileQueue::Submit
+// ============================
+FileRequestId AsyncFileQueue::Submit( Path path, FileRequestPriority priority, FileRequestCallback callback, FileRequestFilter filter )
+{
+	auto request = std::make_shared<Request>();
+	request->path = std::move( path );
+	request->priority = priority;
+	request->callback = std::move( callback );
+	request->filter = std::move( filter );
+
+	return AddRequest( std::move( request ) );
+}
+
+// ============================
+// AsyncFileQueue::SubmitFinished
+// ============================
+FileRequestId AsyncFileQueue::SubmitFinished( FileView view, FileRequestCallback callback )
+{
+	auto request = std::make_shared<Request>();
+	request->callback = std::move( callback );
+	request->view = std::move( view );
+
+	FileRequestId id;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		id = nextRequestId++;
+		request->id = id;
+		activeRequests.emplace( id, request );
+	}
+
+	Complete( request, request->view ? FileRequestStatus::Completed : FileRequestStatus::Failed );
+	return id;
+}
+
+// ============================
+// AsyncFileQueue::SubmitExternal
+// ============================
+FileRequestId AsyncFileQueue::SubmitExternal( FileRequestCallback callback )
+{
+	auto request = std::make_shared<Request>();
+	request->callback = std::move( callback );
+
+	std::lock_guard<std::mutex> lock( mutex );
+	const FileRequestId id = nextRequestId++;
+	request->id = id;
+	activeRequests.emplace( id, std::move( request ) );
+	return id;
+}
+
+// ============================
+// AsyncFileQueue::FinishExternal
+// ============================
+void AsyncFileQueue::FinishExternal( FileRequestId id, FileView view )
+{
+	RequestHandle request;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		const auto iterator = activeRequests.find( id );
+		if ( iterator == activeRequests.end() )
+		{
+			return;
+		}
+
+		request = iterator->second;
+	}
+
+	request->view = std::move( view );
+	Complete( request, request->view ? FileRequestStatus::Completed : FileRequestStatus::Failed );
+}
+
+// ============================
+// AsyncFileQueue::Cancel
+// ============================
+bool AsyncFileQueue::Cancel( FileRequestId id )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+
+	const auto iterator = activeRequests.find( id );
+	if ( iterator == activeRequests.end() )
+	{
+		return false;
+	}
+
+	// Pending requests are skipped when they come up, in-flight
+	// ones finish reading, and dispatching reports them as cancelled
+	iterator->second->cancelled.store( true, std::memory_order_relaxed );
+	return true;
+}
+
+// ============================
+// AsyncFileQueue::DispatchCompletions
+// ============================
+void AsyncFileQueue::DispatchCompletions()
+{
+	{
+		std::lock_guard<std::mutex> lock( completionMutex );
+		dispatchedRequests.swap( completedRequests );
+	}
+
+	if ( dispatchedRequests.empty() )
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		for ( const RequestHandle& request : dispatchedRequests )
+		{
+			activeRequests.erase( request->id );
+		}
+	}
+
+	for ( const RequestHandle& request : dispatchedRequests )
+	{
+		if ( request->cancelled.load( std::memory_order_relaxed ) )
+		{
+			request->status = FileRequestStatus::Cancelled;
+			request->view = {};
+		}
+
+		if ( request->callback )
+		{
+			request->callback( request->status, request->view );
+		}
+	}
+
+	dispatchedRequests.clear();
+}
+
+// ============================
+// AsyncFileQueue::AddRequest
+// ============================
+FileRequestId AsyncFileQueue::AddRequest( RequestHandle request )
+{
+	FileRequestId id;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		id = nextRequestId++;
+		request->id = id;
+		activeRequests.emplace( id, request );
+
+		if ( !stopRequested && !threads.empty() )
+		{
+			pendingRequests[size_t( request->priority )].push_back( request );
+			wakeThreads.notify_one();
+			return id;
+		}
+	}
+
+	// Nothing is going to read it
+	Complete( request, FileRequestStatus::Failed );
+	return id;
+}
+
+// ============================
+// AsyncFileQueue::WaitForRequest
+// ============================
+AsyncFileQueue::RequestHandle AsyncFileQueue::WaitForRequest( bool block )
+{
+	std::unique_lock<std::mutex> lock( mutex );
+
+	while ( true )
+	{
+		for ( size_t priority = NumPriorities; priority-- > 0U; )
+		{
+			auto& requests = pendingRequests[priority];
+			while ( !requests.empty() )
+			{
+				RequestHandle request = std::move( requests.front() );
+				requests.pop_front();
+
+				if ( request->cancelled.load( std::memory_order_relaxed ) )
+				{
+					Complete( request, FileRequestStatus::Cancelled );
+					continue;
+				}
+
+				return request;
+			}
+		}
+
+		if ( !block || stopRequested )
+		{
+			return nullptr;
+		}
+
+		wakeThreads.wait( lock );
+	}
+}
+
+// ============================
+// AsyncFileQueue::Complete
+// ============================
+void AsyncFileQueue::Complete( const RequestHandle& request, FileRequestStatus status )
+{
+	request->status = status;
+	request->buffer.reset();
+	if ( status != FileRequestStatus::Completed )
+	{
+		request->view = {};
+	}
+	else if ( request->filter && !request->cancelled.load( std::memory_order_relaxed ) )
+	{
+		request->view = request->filter( std::move( request->view ) );
+	}
+
+	std::lock_guard<std::mutex> lock( completionMutex );
+	completedRequests.push_back( request );
+}
+
+// ============================
+// AsyncFileQueue::PoolThread
+// ============================
+void AsyncFileQueue::PoolThread()
+{
+	while ( RequestHandle request = WaitForRequest( true ) )
+	{
+		request->view = readFunction( request->path );
+		Complete( request, request->view ? FileRequestStatus::Completed : FileRequestStatus::Failed );
+	}
+}
+
+// ============================
+// AsyncFileQueue::IoUringThread
+// ============================
+void AsyncFileQueue::IoUringThread()
+{
+	std::unordered_map<uint64_t, RequestHandle> inFlight;
+
+	while ( true )
+	{
+		// Only sleep when there's nothing in flight, otherwise
+		// the completions are what this thread is waiting for
+		const bool idle = inFlight.empty();
+		RequestHandle request = WaitForRequest( idle );
+		if ( idle && nullptr == request )
+		{
+			return;
+		}
+
+		while ( nullptr != request )
+		{
+			if ( StartIoUringRead( request ) )
+			{
+				inFlight.emplace( request->id, std::move( request ) );
+			}
+
+			if ( inFlight.size() >= IoUringDepth )
+			{
+				break;
+			}
+
+			request = WaitForRequest( false );
+		}
+
+		if ( inFlight.empty() )
+		{
+			continue;
+		}
+
+		if ( !ioUring->SubmitAndWait() )
+		{
+			console->Warning( "AsyncFileQueue: io_uring_enter failed, failing all reads in flight" );
+
+			// Reads the kernel already picked up may still write into their
+			// buffers, so they have to complete before the buffers are let go
+			ioUring->DiscardPrepared();
+			bool drained = true;
+			while ( ioUring->GetNumInFlight() > 0U )
+			{
+				if ( !ioUring->WaitForCompletions() )
+				{
+					drained = false;
+					break;
+				}
+
+				uint64_t id;
+				int result;
+				while ( ioUring->PopCompletion( id, result ) )
+				{
+				}
+			}
+
+			for ( auto& [id, failedRequest] : inFlight )
+			{
+				// Can't know when the kernel is done with these, so they
+				// stay around until the ring is gone, see Shutdown
+				if ( !drained )
+				{
+					abandonedBuffers.push_back( failedRequest->buffer );
+				}
+
+				ContinueIoUringRead( failedRequest, -EIO );
+			}
+			inFlight.clear();
+			continue;
+		}
+
+		uint64_t id;
+		int result;
+		while ( ioUring->PopCompletion( id, result ) )
+		{
+			const auto iterator = inFlight.find( id );
+			if ( iterator != inFlight.end() && ContinueIoUringRead( iterator->second, result ) )
+			{
+				inFlight.erase( iterator );
+			}
+		}
+	}
+}
+
+#if ADM_PLATFORM == PLATFORM_LINUX
+// ============================
+// AsyncFileQueue::StartIoUringRead
+// ============================
+bool AsyncFileQueue::StartIoUringRead( const RequestHandle& request )
+{
+	request->fileDescriptor = open( request->path.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( request->fileDescriptor < 0 )
+	{
+		Complete( request, FileRequestStatus::Failed );
+		return false;
+	}
+
+	struct stat fileStat;
+	if ( fstat( request->fileDescriptor, &fileStat ) != 0 )
+	{
+		close( request->fileDescriptor );
+		Complete( request, FileRequestStatus::Failed );
+		return false;
+	}
+
+	request->size = static_cast<size_t>( fileStat.st_size );
+	request->bytesRead = 0U;
+	request->buffer = bufferPool->Acquire( request->size );
+	if ( nullptr == request->buffer )
+	{
+		request->buffer = std::shared_ptr<uint8_t>( new uint8_t[request->size], std::default_delete<uint8_t[]>() );
+	}
+
+	// Nothing to read, but it's still a file
+	if ( 0U == request->size )
+	{
+		close( request->fileDescriptor );
+		request->view = FileView( request->buffer, request->buffer.get(), 0U );
+		Complete( request, FileRequestStatus::Completed );
+		return false;
+	}
+
+	// Not an error, just queues the first read
+	return !ContinueIoUringRead( request, -EAGAIN );
+}
+
+// ============================
+// AsyncFileQueue::ContinueIoUringRead
+// ============================
+bool AsyncFileQueue::ContinueIoUringRead( const RequestHandle& request, int result )
+{
+	// Reading 0 bytes before the end means the file got shorter
+	const bool retry = result == -EINTR || result == -EAGAIN;
+	if ( !retry && result <= 0 )
+	{
+		close( request->fileDescriptor );
+		Complete( request, FileRequestStatus::Failed );
+		return true;
+	}
+
+	if ( !retry )
+	{
+		request->bytesRead += result;
+	}
+
+	if ( request->bytesRead == request->size )
+	{
+		close( request->fileDescriptor );
+		request->view = FileView( request->buffer, request->buffer.get(), request->size );
+		Complete( request, FileRequestStatus::Completed );
+		return true;
+	}
+
+	// Cancelled halfway through, no point in reading the rest
+	if ( request->cancelled.load( std::memory_order_relaxed ) )
+	{
+		close( request->fileDescriptor );
+		Complete( request, FileRequestStatus::Cancelled );
+		return true;
+	}
+
+	// Large files are read in chunks, reads are also allowed to come up short
+	constexpr size_t MaxReadSize = 1U << 30U;
+	const size_t remaining = std::min( request->size - request->bytesRead, MaxReadSize );
+	if ( !ioUring->PrepareRead( request->fileDescriptor, request->buffer.get() + request->bytesRead, static_cast<uint32_t>( remaining ), request->bytesRead, request->id ) )
+	{
+		close( request->fileDescriptor );
+		Complete( request, FileRequestStatus::Failed );
+		return true;
+	}
+
+	return false;
+}
+#else
+bool AsyncFileQueue::StartIoUringRead( const RequestHandle& request )
+{
+	Complete( request, FileRequestStatus::Failed );
+	return false;
+}
+
+bool AsyncFileQueue::ContinueIoUringRead( const RequestHandle& request, int result )
+{
+	Complete( request, FileRequestStatus::Failed );
+	return true;
+}
+#endif
@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+
+#include "FileView.hpp"
+
+class IoUring;
+
+enum class FileRequestPriority : uint8_t
+{
+	Low,
+	Normal,
+	High
+};
+
+enum class FileRequestStatus : uint8_t
+{
+	Completed,
+	Failed,
+	Cancelled
+};
+
+using FileRequestId = uint64_t;
+// The view is only valid if the status is Completed
+using FileRequestCallback = std::function<void( FileRequestStatus status, const FileView& view )>;
+// Runs on the reading thread once a file has been read, the callback gets what it returns
+// For work that shouldn't stall the main thread, e.g. hashing, it must be thread-safe
+using FileRequestFilter = std::function<FileView( FileView view )>;
+
+// ============================
+// AsyncFileQueue
+//
+// Reads whole files in the background, highest priority first, FIFO
+// within the same priority. Callbacks are delivered by DispatchCompletions,
+// which the engine calls on the main thread every frame
+//
+// On Linux, reads go through a single io_uring thread that keeps many
+// reads in flight. Elsewhere, or if io_uring isn't available (old
+// kernels, seccomp), a few threads do blocking reads instead
+// ============================
+class AsyncFileQueue final
+{
+public:
+	// Both defined where IoUring is a complete type
+	AsyncFileQueue();
+	~AsyncFileQueue();
+
+	// readFunction is used by the thread pool, it must be thread-safe
+	bool				Init( IConsole* console, std::shared_ptr<FileBufferPool> bufferPool, std::function<FileView( const Path& )> readFunction, bool allowIoUring );
+	// Pending requests are cancelled, in-flight ones are finished,
+	// and callbacks that haven't been dispatched yet are dropped
+	void				Shutdown();
+
+	// path must already be resolved
+	FileRequestId		Submit( Path path, FileRequestPriority priority, FileRequestCallback callback, FileRequestFilter filter = {} );
+	// Finishes a request right away, e.g. for files that are already in memory
+	// An invalid view means the request failed
+	FileRequestId		SubmitFinished( FileView view, FileRequestCallback callback );
+	// For files that are read by someone else, e.g. a job, which hands the result
+	// to FinishExternal from any thread. An invalid view means the request failed
+	FileRequestId		SubmitExternal( FileRequestCallback callback );
+	void				FinishExternal( FileRequestId id, FileView view );
+	// The callback will still be called, with FileRequestStatus::Cancelled
+	// Returns false if the request has already finished
+	bool				Cancel( FileRequestId id );
+
+	// Calls the callbacks of finished requests, exactly once per request
+	void				DispatchCompletions();
+
+	bool				IsUsingIoUring() const
+	{
+		return nullptr != ioUring;
+	}
+
+private:
+	struct Request
+	{
+		FileRequestId	id{ 0U };
+		Path			path;
+		FileRequestPriority priority{ FileRequestPriority::Normal };
+		FileRequestCallback callback;
+		FileRequestFilter filter;
+		std::atomic<bool> cancelled{ false };
+
+		FileRequestStatus status{ FileRequestStatus::Failed };
+		FileView		view;
+
+		// Only used by the io_uring thread
+		int				fileDescriptor{ -1 };
+		std::shared_ptr<uint8_t> buffer;
+		size_t			size{ 0U };
+		size_t			bytesRead{ 0U };
+	};
+
+	using RequestHandle = std::shared_ptr<Request>;
+
+	FileRequestId		AddRequest( RequestHandle request );
+	// Highest priority first. If block is true, waits until there's
+	// a request and returns nullptr only when shutting down
+	RequestHandle		WaitForRequest( bool block );
+	void				Complete( const RequestHandle& request, FileRequestStatus status );
+
+	void				PoolThread();
+	void				IoUringThread();
+	// Opens the file and queues the first read, completes the request on failure
+	bool				StartIoUringRead( const RequestHandle& request );
+	// Queues the next read if the file isn't fully read yet, returns true when the request is finished
+	bool				ContinueIoUringRead( const RequestHandle& request, int result );
+
+private:
+	static constexpr uint32_t NumPoolThreads = 2U;
+	static constexpr uint32_t IoUringDepth = 64U;
+	static constexpr size_t NumPriorities = 3U;
+
+	std::mutex			mutex;
+	std::condition_variable wakeThreads;
+	std::deque<RequestHandle> pendingRequests[NumPriorities];
+	// Everything that hasn't been dispatched yet, for Cancel
+	std::unordered_map<FileRequestId, RequestHandle> activeRequests;
+	FileRequestId		nextRequestId{ 1U };
+	bool				stopRequested{ false };
+
+	std::mutex			completionMutex;
+	Vector<RequestHandle> completedRequests;
+	// Swapped with completedRequests, so callbacks run without the lock
+	Vector<RequestHandle> dispatchedRequests;
+
+	Vector<std::thread>	threads;
+	UniquePtr<IoUring>	ioUring;
+	// Buffers of reads that may never have finished, only freed after the ring
+	Vector<std::shared_ptr<uint8_t>> abandonedBuffers;
+	std::shared_ptr<FileBufferPool> bufferPool;
+	std::function<FileView( const Path& )> readFunction;
+
+	IConsole*			console{ nullptr };
+};
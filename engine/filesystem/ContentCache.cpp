@@ -0,0 +1,279 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "ContentCache.hpp"
+#include "ContentHash.hpp"
+
+// On-disk hash index:
+// [magic, version, number of entries] [size, modified time, hash, path length, path]...
+// Host byte order, it's a cache, so it's simply rebuilt if anything's off
+namespace HashIndex
+{
+	constexpr char Magic[6] = { 'B', 'T', 'X', 'H', 'S', 'H' };
+	constexpr uint16_t Version = 1U;
+	constexpr uint32_t MaxPathLength = 4096U;
+}
+
+// ============================
+// ContentCache::Load
+// ============================
+bool ContentCache::Load( const Path& indexPath )
+{
+	std::FILE* file = std::fopen( indexPath.string().c_str(), "rb" );
+	if ( nullptr == file )
+	{
+		return false;
+	}
+
+	char magic[sizeof( HashIndex::Magic )];
+	uint16_t version = 0U;
+	uint32_t numEntries = 0U;
+	bool valid = std::fread( magic, sizeof( magic ), 1U, file ) == 1U
+		&& std::fread( &version, sizeof( version ), 1U, file ) == 1U
+		&& std::fread( &numEntries, sizeof( numEntries ), 1U, file ) == 1U
+		&& std::memcmp( magic, HashIndex::Magic, sizeof( magic ) ) == 0
+		&& version == HashIndex::Version;
+
+	std::unordered_map<String, HashEntry> loadedHashes;
+	String path;
+	for ( uint32_t i = 0U; valid && i < numEntries; i++ )
+	{
+		HashEntry entry;
+		uint32_t pathLength = 0U;
+		valid = std::fread( &entry.stamp.size, sizeof( entry.stamp.size ), 1U, file ) == 1U
+			&& std::fread( &entry.stamp.modifiedTime, sizeof( entry.stamp.modifiedTime ), 1U, file ) == 1U
+			&& std::fread( &entry.hash, sizeof( entry.hash ), 1U, file ) == 1U
+			&& std::fread( &pathLength, sizeof( pathLength ), 1U, file ) == 1U
+			&& pathLength <= HashIndex::MaxPathLength;
+
+		if ( valid )
+		{
+			path.resize( pathLength );
+			valid = std::fread( path.data(), 1U, pathLength, file ) == pathLength;
+		}
+
+		if ( valid )
+		{
+			loadedHashes[path] = entry;
+		}
+	}
+
+	std::fclose( file );
+	if ( !valid )
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( mutex );
+	hashes = std::move( loadedHashes );
+	dirty = false;
+	return true;
+}
+
+// ============================
+// ContentCache::Save
+// ============================
+bool ContentCache::Save( const Path& indexPath )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	if ( !dirty )
+	{
+		return true;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories( indexPath.parent_path(), error );
+
+	std::FILE* file = std::fopen( indexPath.string().c_str(), "wb" );
+	if ( nullptr == file )
+	{
+		return false;
+	}
+
+	const uint16_t version = HashIndex::Version;
+	const uint32_t numEntries = static_cast<uint32_t>( hashes.size() );
+	std::fwrite( HashIndex::Magic, sizeof( HashIndex::Magic ), 1U, file );
+	std::fwrite( &version, sizeof( version ), 1U, file );
+	std::fwrite( &numEntries, sizeof( numEntries ), 1U, file );
+
+	for ( const auto& [path, entry] : hashes )
+	{
+		const uint32_t pathLength = static_cast<uint32_t>( std::min<size_t>( path.size(), HashIndex::MaxPathLength ) );
+		std::fwrite( &entry.stamp.size, sizeof( entry.stamp.size ), 1U, file );
+		std::fwrite( &entry.stamp.modifiedTime, sizeof( entry.stamp.modifiedTime ), 1U, file );
+		std::fwrite( &entry.hash, sizeof( entry.hash ), 1U, file );
+		std::fwrite( &pathLength, sizeof( pathLength ), 1U, file );
+		std::fwrite( path.data(), 1U, pathLength, file );
+	}
+
+	const bool written = std::ferror( file ) == 0;
+	std::fclose( file );
+
+	dirty = !written;
+	return written;
+}
+
+// ============================
+// ContentCache::Clear
+// ============================
+void ContentCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	hashes.clear();
+	loadedFiles.clear();
+	dirty = false;
+}
+
+// ============================
+// ContentCache::FindHash
+// ============================
+Optional<uint64_t> ContentCache::FindHash( const String& path, const FileStamp& stamp ) const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+
+	const auto iterator = hashes.find( path );
+	if ( iterator == hashes.end() || iterator->second.stamp.size != stamp.size || iterator->second.stamp.modifiedTime != stamp.modifiedTime )
+	{
+		return {};
+	}
+
+	return iterator->second.hash;
+}
+
+// ============================
+// ContentCache::FindLoaded
+// ============================
+FileView ContentCache::FindLoaded( const String& path, const FileStamp& stamp )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+
+	const auto iterator = hashes.find( path );
+	if ( iterator == hashes.end() || iterator->second.stamp.size != stamp.size || iterator->second.stamp.modifiedTime != stamp.modifiedTime )
+	{
+		return {};
+	}
+
+	FileView loaded = Lock( iterator->second.loaded );
+	if ( loaded )
+	{
+		numSharedFiles++;
+		numSharedBytes += loaded.GetSize();
+	}
+
+	return loaded;
+}
+
+// ============================
+// ContentCache::Share
+// ============================
+FileView ContentCache::Share( const String& path, const FileStamp& stamp, FileView view )
+{
+	if ( !view )
+	{
+		return view;
+	}
+
+	// Hashing is the expensive part, so it's done outside of the lock
+	Optional<uint64_t> hash = FindHash( path, stamp );
+	if ( !hash )
+	{
+		hash = ContentHash::Hash( view.GetData(), view.GetSize() );
+	}
+
+	FileView loaded;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		HashEntry& entry = hashes[path];
+		if ( entry.hash != *hash || entry.stamp.size != stamp.size || entry.stamp.modifiedTime != stamp.modifiedTime )
+		{
+			entry.stamp = stamp;
+			entry.hash = *hash;
+			dirty = true;
+		}
+
+		loaded = FindLoadedInternal( *hash, view.GetSize() );
+		if ( !loaded )
+		{
+			if ( loadedFiles.size() >= sweepThreshold )
+			{
+				for ( auto iterator = loadedFiles.begin(); iterator != loadedFiles.end(); )
+				{
+					iterator = iterator->second.owner.expired() ? loadedFiles.erase( iterator ) : std::next( iterator );
+				}
+
+				sweepThreshold = std::max<size_t>( 64U, loadedFiles.size() * 2U );
+			}
+
+			loadedFiles[*hash] = { view.GetOwner(), view.GetData(), view.GetSize() };
+			entry.loaded = loadedFiles[*hash];
+			return view;
+		}
+	}
+
+	// Also outside of the lock. A collision, or a stale hash from the index (the file
+	// changed within the timestamp's resolution), keeps its own copy
+	const bool identical = loaded.GetData() == view.GetData()
+		|| std::memcmp( loaded.GetData(), view.GetData(), view.GetSize() ) == 0;
+
+	std::lock_guard<std::mutex> lock( mutex );
+	const auto iterator = hashes.find( path );
+	if ( !identical )
+	{
+		if ( iterator != hashes.end() )
+		{
+			iterator->second.loaded = { view.GetOwner(), view.GetData(), view.GetSize() };
+		}
+
+		return view;
+	}
+
+	// Not the same copy, e.g. the same file from another mount
+	if ( loaded.GetData() != view.GetData() )
+	{
+		numSharedFiles++;
+		numSharedBytes += view.GetSize();
+	}
+
+	if ( iterator != hashes.end() )
+	{
+		iterator->second.loaded = { loaded.GetOwner(), loaded.GetData(), loaded.GetSize() };
+	}
+
+	return loaded;
+}
+
+// ============================
+// ContentCache::FindLoadedInternal
+// ============================
+FileView ContentCache::FindLoadedInternal( uint64_t hash, size_t size )
+{
+	const auto iterator = loadedFiles.find( hash );
+	if ( iterator == loadedFiles.end() || iterator->second.size != size )
+	{
+		return {};
+	}
+
+	FileView loaded = Lock( iterator->second );
+	if ( !loaded )
+	{
+		loadedFiles.erase( iterator );
+	}
+
+	return loaded;
+}
+
+// ============================
+// ContentCache::Lock
+// ============================
+FileView ContentCache::Lock( const LoadedFile& file )
+{
+	std::shared_ptr<const void> owner = file.owner.lock();
+	if ( nullptr == owner )
+	{
+		return {};
+	}
+
+	return FileView( std::move( owner ), file.data, file.size );
+}
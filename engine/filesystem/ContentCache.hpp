@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "FileView.hpp"
+
+// Identifies one version of a file, if either changes, it has to be hashed again
+struct FileStamp
+{
+	uint64_t			size{ 0U };
+	int64_t				modifiedTime{ 0 };
+};
+
+// ============================
+// ContentCache
+//
+// Content-addressed cache of loaded files, so identical files from
+// different mounts (e.g. an addon shipping a copy of base content)
+// share one copy in memory for as long as anyone holds a view of it
+//
+// Files are found by a hash of their contents, see ContentHash.hpp, and
+// only shared if their bytes are actually identical, since hashes can collide
+// Hashes are remembered per path, and saved to disk, so a file that was
+// seen before doesn't have to be hashed again
+// All methods are thread-safe
+// ============================
+class ContentCache final
+{
+public:
+	// Loads hashes from a previous run, returns false if there's no usable index
+	bool				Load( const Path& indexPath );
+	// Does nothing if no hashes changed since loading
+	bool				Save( const Path& indexPath );
+	void				Clear();
+
+	// Returns the hash of path's contents, if it's known for this version of the file
+	Optional<uint64_t>	FindHash( const String& path, const FileStamp& stamp ) const;
+	// Returns what Share last returned for this version of path, if someone is still
+	// holding it, so the same file doesn't have to be read again while it's loaded
+	FileView			FindLoaded( const String& path, const FileStamp& stamp );
+	// Hashes view if needed, then returns the already loaded copy if
+	// there is one with the same contents, otherwise view becomes the loaded copy
+	// Hashing and comparing take about as long as a memcpy of the file
+	FileView			Share( const String& path, const FileStamp& stamp, FileView view );
+
+	size_t				GetNumSharedFiles() const
+	{
+		return numSharedFiles;
+	}
+
+	// Memory that would've been taken up by duplicates, or by reading a file again
+	size_t				GetNumSharedBytes() const
+	{
+		return numSharedBytes;
+	}
+
+private:
+	struct LoadedFile
+	{
+		std::weak_ptr<const void> owner;
+		const uint8_t*	data{ nullptr };
+		size_t			size{ 0U };
+	};
+
+	struct HashEntry
+	{
+		FileStamp		stamp;
+		uint64_t		hash{ 0U };
+		// Not saved, see FindLoaded
+		LoadedFile		loaded;
+	};
+
+	// Expects the mutex to be locked
+	static FileView		Lock( const LoadedFile& file );
+	FileView			FindLoadedInternal( uint64_t hash, size_t size );
+
+private:
+	mutable std::mutex	mutex;
+	std::unordered_map<String, HashEntry> hashes;
+	std::unordered_map<uint64_t, LoadedFile> loadedFiles;
+	// Expired files are only swept once the map doubles in size
+	size_t				sweepThreshold{ 64U };
+	bool				dirty{ false };
+
+	std::atomic<size_t>	numSharedFiles{ 0U };
+	std::atomic<size_t>	numSharedBytes{ 0U };
+};
@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// ============================
+// ContentHash
+//
+// XXH64, same results as the reference implementation
+// Used to tell whether two files have identical contents,
+// it runs at about the speed of memory, so hashing a file
+// costs little more than reading it
+// ============================
+namespace ContentHash
+{
+	constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+	constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+	constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+	inline uint64_t RotateLeft( uint64_t value, uint32_t bits )
+	{
+		return (value << bits) | (value >> (64U - bits));
+	}
+
+	inline uint64_t Read64( const uint8_t* data )
+	{
+		uint64_t value;
+		std::memcpy( &value, data, sizeof( value ) );
+		return value;
+	}
+
+	inline uint32_t Read32( const uint8_t* data )
+	{
+		uint32_t value;
+		std::memcpy( &value, data, sizeof( value ) );
+		return value;
+	}
+
+	inline uint64_t Round( uint64_t accumulator, uint64_t input )
+	{
+		accumulator += input * Prime2;
+		accumulator = RotateLeft( accumulator, 31U );
+		return accumulator * Prime1;
+	}
+
+	inline uint64_t MergeRound( uint64_t accumulator, uint64_t value )
+	{
+		accumulator ^= Round( 0U, value );
+		return accumulator * Prime1 + Prime4;
+	}
+
+	// Assumes a little-endian machine, like the rest of the engine's file formats
+	inline uint64_t Hash( const void* input, size_t size, uint64_t seed = 0U )
+	{
+		const uint8_t* data = static_cast<const uint8_t*>( input );
+		const uint8_t* const end = data + size;
+		uint64_t hash;
+
+		if ( size >= 32U )
+		{
+			uint64_t v1 = seed + Prime1 + Prime2;
+			uint64_t v2 = seed + Prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - Prime1;
+
+			const uint8_t* const limit = end - 32U;
+			do
+			{
+				v1 = Round( v1, Read64( data ) );
+				v2 = Round( v2, Read64( data + 8U ) );
+				v3 = Round( v3, Read64( data + 16U ) );
+				v4 = Round( v4, Read64( data + 24U ) );
+				data += 32U;
+			} while ( data <= limit );
+
+			hash = RotateLeft( v1, 1U ) + RotateLeft( v2, 7U ) + RotateLeft( v3, 12U ) + RotateLeft( v4, 18U );
+			hash = MergeRound( hash, v1 );
+			hash = MergeRound( hash, v2 );
+			hash = MergeRound( hash, v3 );
+			hash = MergeRound( hash, v4 );
+		}
+		else
+		{
+			hash = seed + Prime5;
+		}
+
+		hash += size;
+
+		while ( end - data >= 8 )
+		{
+			hash ^= Round( 0U, Read64( data ) );
+			hash = RotateLeft( hash, 27U ) * Prime1 + Prime4;
+			data += 8U;
+		}
+
+		if ( end - data >= 4 )
+		{
+			hash ^= uint64_t( Read32( data ) ) * Prime1;
+			hash = RotateLeft( hash, 23U ) * Prime2 + Prime3;
+			data += 4U;
+		}
+
+		while ( data < end )
+		{
+			hash ^= *data * Prime5;
+			hash = RotateLeft( hash, 11U ) * Prime1;
+			data++;
+		}
+
+		hash ^= hash >> 33U;
+		hash *= Prime2;
+		hash ^= hash >> 29U;
+		hash *= Prime3;
+		hash ^= hash >> 32U;
+		return hash;
+	}
+}
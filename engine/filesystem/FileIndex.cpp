@@ -0,0 +1,369 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "FileIndex.hpp"
+#include "PackFile.hpp"
+#include "../jobsystem/JobSystem.hpp"
+
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// ============================
+// FileIndex::Build
+// ============================
+void FileIndex::Build( const Vector<Mount>& mounts, bool caseInsensitive, JobSystem* jobSystem )
+{
+	entries.clear();
+	foldedEntries.clear();
+	this->caseInsensitive = caseInsensitive;
+
+	// Each scan only touches its own Scan, so they can all run at once
+	Vector<const Mount*> unscannedMounts;
+	Vector<Scan*> newScans;
+	for ( const Mount& mount : mounts )
+	{
+		const bool scheduled = std::any_of( unscannedMounts.begin(), unscannedMounts.end(), [&mount]( const Mount* unscannedMount )
+			{
+				return unscannedMount->path == mount.path;
+			} );
+
+		if ( nullptr == FindScan( mount ) && !scheduled )
+		{
+			auto* scan = new Scan();
+			scan->mountPath = mount.path;
+			scans.emplace_back( scan );
+			unscannedMounts.push_back( &mount );
+			newScans.push_back( scan );
+		}
+	}
+
+	const auto scanMounts = [&unscannedMounts, &newScans]( size_t begin, size_t end )
+	{
+		for ( size_t i = begin; i < end; i++ )
+		{
+			if ( nullptr != unscannedMounts[i]->pack )
+			{
+				ScanPack( *unscannedMounts[i]->pack, *newScans[i] );
+			}
+			else
+			{
+				ScanDirectory( unscannedMounts[i]->path, *newScans[i] );
+			}
+		}
+	};
+
+	if ( nullptr != jobSystem )
+	{
+		jobSystem->ParallelFor( unscannedMounts.size(), 1U, scanMounts );
+	}
+	else
+	{
+		scanMounts( 0U, unscannedMounts.size() );
+	}
+
+	// Merged in priority order, however long each scan took
+	size_t numEntries = 0U;
+	Vector<const Scan*> mountScans;
+	mountScans.reserve( mounts.size() );
+	for ( const Mount& mount : mounts )
+	{
+		mountScans.push_back( FindScan( mount ) );
+		numEntries += mountScans.back()->paths.size();
+	}
+	entries.reserve( numEntries );
+
+	for ( size_t mountIndex = 0U; mountIndex < mountScans.size(); mountIndex++ )
+	{
+		for ( const ScannedPath& scannedPath : mountScans[mountIndex]->paths )
+		{
+			// Higher priority mounts were inserted first, so only fill the gaps
+			Entry& entry = entries[scannedPath.path];
+			if ( scannedPath.flags & Path_Directory )
+			{
+				if ( entry.directoryMount == NoMount )
+				{
+					entry.directoryMount = static_cast<uint16_t>( mountIndex );
+				}
+			}
+			else if ( entry.fileMount == NoMount )
+			{
+				entry.fileMount = static_cast<uint16_t>( mountIndex );
+				entry.packEntry = scannedPath.packEntry;
+			}
+		}
+	}
+
+	if ( caseInsensitive )
+	{
+		BuildFoldedEntries();
+	}
+}
+
+// ============================
+// FileIndex::Clear
+// ============================
+void FileIndex::Clear()
+{
+	entries.clear();
+	foldedEntries.clear();
+	scans.clear();
+}
+
+// ============================
+// FileIndex::Invalidate
+// ============================
+void FileIndex::Invalidate( const Path& mountPath )
+{
+	scans.erase( std::remove_if( scans.begin(), scans.end(), [&mountPath]( const UniquePtr<Scan>& scan )
+		{
+			return scan->mountPath == mountPath;
+		} ), scans.end() );
+}
+
+// ============================
+// FileIndex::Find
+// ============================
+Optional<FileIndex::Location> FileIndex::Find( const Path& relativePath, const uint8_t& filterFlags ) const
+{
+	String path = Normalise( relativePath );
+
+	const Entry* entry = nullptr;
+	StringView filePath;
+	StringView directoryPath;
+	if ( caseInsensitive )
+	{
+		FoldCase( path );
+		const auto iterator = foldedEntries.find( path );
+		if ( iterator == foldedEntries.end() )
+		{
+			return {};
+		}
+
+		entry = &iterator->second.entry;
+		filePath = iterator->second.filePath;
+		directoryPath = iterator->second.directoryPath;
+	}
+	else
+	{
+		const auto iterator = entries.find( path );
+		if ( iterator == entries.end() )
+		{
+			return {};
+		}
+
+		entry = &iterator->second;
+		filePath = iterator->first;
+		directoryPath = iterator->first;
+	}
+
+	const uint16_t fileMount = (filterFlags & Path_File) ? entry->fileMount : NoMount;
+	const uint16_t directoryMount = (filterFlags & Path_Directory) ? entry->directoryMount : NoMount;
+
+	if ( fileMount == NoMount && directoryMount == NoMount )
+	{
+		return {};
+	}
+
+	if ( fileMount < directoryMount )
+	{
+		return Location{ fileMount, entry->packEntry, filePath };
+	}
+
+	return Location{ directoryMount, NoPackEntry, directoryPath };
+}
+
+// ============================
+// FileIndex::GetNumEntries
+// ============================
+size_t FileIndex::GetNumEntries() const
+{
+	return entries.size();
+}
+
+// ============================
+// FileIndex::ForEachPath
+// ============================
+void FileIndex::ForEachPath( const std::function<void( StringView path )>& function ) const
+{
+	for ( const auto& [path, entry] : entries )
+	{
+		function( path );
+	}
+}
+
+// ============================
+// FileIndex::Normalise
+// ============================
+String FileIndex::Normalise( const Path& relativePath )
+{
+	String result = relativePath.lexically_normal().generic_string();
+	while ( !result.empty() && result.back() == '/' )
+	{
+		result.pop_back();
+	}
+
+	if ( result == "." )
+	{
+		result.clear();
+	}
+
+	return result;
+}
+
+// ============================
+// FileIndex::FoldCase
+// ============================
+void FileIndex::FoldCase( String& path )
+{
+	for ( char& character : path )
+	{
+		if ( character >= 'A' && character <= 'Z' )
+		{
+			character = character - 'A' + 'a';
+		}
+	}
+}
+
+// ============================
+// FileIndex::BuildFoldedEntries
+// ============================
+void FileIndex::BuildFoldedEntries()
+{
+	foldedEntries.reserve( entries.size() );
+
+	String foldedPath;
+	for ( const auto& [path, entry] : entries )
+	{
+		foldedPath = path;
+		FoldCase( foldedPath );
+		FoldedEntry& foldedEntry = foldedEntries[foldedPath];
+
+		// Paths that only differ in case compete like the same path would
+		// Within the same mount, which one wins mustn't depend on hash order
+		const auto wins = []( uint16_t mount, StringView path, uint16_t otherMount, StringView otherPath )
+		{
+			return mount < otherMount || (mount == otherMount && mount != NoMount && path < otherPath);
+		};
+
+		if ( wins( entry.fileMount, path, foldedEntry.entry.fileMount, foldedEntry.filePath ) )
+		{
+			foldedEntry.entry.fileMount = entry.fileMount;
+			foldedEntry.entry.packEntry = entry.packEntry;
+			foldedEntry.filePath = path;
+		}
+
+		if ( wins( entry.directoryMount, path, foldedEntry.entry.directoryMount, foldedEntry.directoryPath ) )
+		{
+			foldedEntry.entry.directoryMount = entry.directoryMount;
+			foldedEntry.directoryPath = path;
+		}
+	}
+}
+
+// ============================
+// FileIndex::FindScan
+// ============================
+const FileIndex::Scan* FileIndex::FindScan( const Mount& mount ) const
+{
+	for ( const auto& scan : scans )
+	{
+		if ( scan->mountPath == mount.path )
+		{
+			return scan.get();
+		}
+	}
+
+	return nullptr;
+}
+
+// ============================
+// FileIndex::ScanDirectory
+// ============================
+void FileIndex::ScanDirectory( const Path& directory, Scan& scan )
+{
+	// Symlinked directories are followed, like resolving a path through them would,
+	// but each real directory is entered at most once from a link, so cycles end
+	std::error_code error;
+	std::unordered_set<String> linkedDirectories;
+	linkedDirectories.insert( fs::canonical( directory, error ).generic_string() );
+
+	// Unreadable directories are skipped, not worth failing the whole mount over
+	const auto options = fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink;
+	const fs::recursive_directory_iterator end;
+	auto iterator = fs::recursive_directory_iterator( directory, options, error );
+	while ( !error && iterator != end )
+	{
+		const fs::directory_entry& directoryEntry = *iterator;
+		uint8_t flags = 0U;
+		if ( directoryEntry.is_directory( error ) )
+		{
+			flags = Path_Directory;
+		}
+		else if ( directoryEntry.is_regular_file( error ) )
+		{
+			flags = Path_File;
+		}
+
+		if ( Path_Directory == flags && directoryEntry.is_symlink( error ) )
+		{
+			// A link to where we already are, or to somewhere already entered
+			// through a link, is indexed as a directory, but not entered again
+			const String target = fs::canonical( directoryEntry.path(), error ).generic_string();
+			const String parent = fs::canonical( directoryEntry.path().parent_path(), error ).generic_string();
+			const bool isAncestor = parent.compare( 0U, target.size(), target ) == 0
+				&& (parent.size() == target.size() || parent[target.size()] == '/');
+			if ( error || isAncestor || !linkedDirectories.insert( target ).second )
+			{
+				iterator.disable_recursion_pending();
+			}
+		}
+
+		if ( 0U != flags )
+		{
+			scan.paths.push_back( { directoryEntry.path().lexically_relative( directory ).generic_string(), flags } );
+		}
+
+		// One bad entry or directory only costs itself, the rest of the mount is still scanned
+		error.clear();
+		iterator.increment( error );
+		if ( error && iterator != end )
+		{
+			error.clear();
+			iterator.disable_recursion_pending();
+			iterator.increment( error );
+		}
+
+		if ( error && iterator != end )
+		{
+			error.clear();
+			iterator.pop( error );
+		}
+	}
+}
+
+// ============================
+// FileIndex::ScanPack
+// ============================
+void FileIndex::ScanPack( const PackFile& pack, Scan& scan )
+{
+	// Packs don't store directories, every parent of a file is one
+	std::unordered_set<StringView> directories;
+
+	scan.paths.reserve( pack.GetNumEntries() );
+	for ( uint32_t i = 0U; i < pack.GetNumEntries(); i++ )
+	{
+		const StringView entryPath = pack.GetEntryPath( i );
+		scan.paths.push_back( { String( entryPath ), Path_File, i } );
+
+		for ( size_t slash = entryPath.find( '/' ); slash != StringView::npos; slash = entryPath.find( '/', slash + 1U ) )
+		{
+			const StringView directory = entryPath.substr( 0U, slash );
+			if ( directories.insert( directory ).second )
+			{
+				scan.paths.push_back( { String( directory ), Path_Directory } );
+			}
+		}
+	}
+}
@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+class JobSystem;
+class PackFile;
+
+// ============================
+// FileIndex
+//
+// Merged view of every mount: relative path -> the highest
+// priority mount that has a file or directory there
+//
+// Mounts are scanned once when they're mounted, after which
+// resolving a path is a single hash probe instead of a few stat
+// calls per mount point
+//
+// Optionally case-insensitive, for content authored on Windows:
+// a second map is keyed by case-folded paths, so lookups stay
+// a single probe, and still return the path as it is on disk
+// ============================
+class FileIndex final
+{
+public:
+	static constexpr uint16_t NoMount = 0xFFFFU;
+	static constexpr uint32_t NoPackEntry = 0xFFFFFFFFU;
+
+	// A loose directory, or a pack if pack isn't null
+	struct Mount
+	{
+		Path			path;
+		const PackFile*	pack{ nullptr };
+	};
+
+	struct Location
+	{
+		// Index into the mount list passed to Build
+		uint16_t		mount{ NoMount };
+		// Index into the pack's entries, if the mount is a pack
+		uint32_t		packEntry{ NoPackEntry };
+		// Relative to the mount, normalised, with the casing it has in the mount
+		// Valid until the next Build
+		StringView		path;
+	};
+
+	// Mounts are in priority order, the first one wins
+	// Mounts that were scanned before are not scanned again,
+	// new ones are scanned in parallel if there's a job system
+	void				Build( const Vector<Mount>& mounts, bool caseInsensitive, JobSystem* jobSystem = nullptr );
+	void				Clear();
+	// The mount will be scanned again by the next Build, e.g. when its contents changed
+	void				Invalidate( const Path& mountPath );
+
+	// Returns the highest priority mount with something at relativePath that passes filterFlags
+	Optional<Location>	Find( const Path& relativePath, const uint8_t& filterFlags ) const;
+
+	size_t				GetNumEntries() const;
+	// Every indexed path, in no particular order
+	void				ForEachPath( const std::function<void( StringView path )>& function ) const;
+
+	// Forward slashes, no "." or ".." and no trailing slash
+	static String		Normalise( const Path& relativePath );
+	// ASCII only, non-ASCII names have to match exactly
+	static void			FoldCase( String& path );
+
+private:
+	struct Entry
+	{
+		// Lower is higher priority
+		uint16_t		fileMount{ NoMount };
+		uint16_t		directoryMount{ NoMount };
+		uint32_t		packEntry{ NoPackEntry };
+	};
+
+	// Same as Entry, but for all paths that only differ in case
+	struct FoldedEntry
+	{
+		Entry			entry;
+		// Casing of the file and the directory that won
+		StringView		filePath;
+		StringView		directoryPath;
+	};
+
+	struct ScannedPath
+	{
+		String			path;
+		uint8_t			flags{ 0U };
+		uint32_t		packEntry{ NoPackEntry };
+	};
+
+	struct Scan
+	{
+		Path			mountPath;
+		Vector<ScannedPath> paths;
+	};
+
+	// Nullptr if the mount wasn't scanned yet
+	const Scan*			FindScan( const Mount& mount ) const;
+	static void			ScanDirectory( const Path& directory, Scan& scan );
+	static void			ScanPack( const PackFile& pack, Scan& scan );
+	void				BuildFoldedEntries();
+
+private:
+	std::unordered_map<String, Entry> entries;
+	// Case-folded path -> entry, empty unless case-insensitive
+	// Points to the keys in entries
+	std::unordered_map<String, FoldedEntry> foldedEntries;
+	bool				caseInsensitive{ false };
+	// Kept so that mounting another directory doesn't rescan the others
+	Vector<UniquePtr<Scan>> scans;
+};
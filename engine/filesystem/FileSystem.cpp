@@ -3,9 +3,22 @@
 
 #include "common/Precompiled.hpp"
 #include "FileSystem.hpp"
+#include "../jobsystem/JobSystem.hpp"
+
+#include <random>
 
 namespace fs = std::filesystem;
 
+CVar fs_ioUring( "fs_ioUring", "1", 0, "Use io_uring for async reads where it's available, only read at startup" );
+CVar fs_hotReload( "fs_hotReload", "0", 0, "Watch mounted games for changed files and reload them, only read at startup" );
+CVar fs_hotReloadDelay( "fs_hotReloadDelay", "250", 0, "Milliseconds a file has to stay unchanged before it's reloaded" );
+CVar fs_caseInsensitive( "fs_caseInsensitive", "0", 0, "Resolve paths regardless of their case, for content authored on Windows, only read at startup" );
+CVar fs_contentCache( "fs_contentCache", "1", 0, "Identical files from different mounts share one copy in memory" );
+CVar fs_cacheDirectory( "fs_cacheDirectory", "", 0, "Where the content hash index is kept, empty means the user's cache directory, only read at startup and shutdown" );
+CVar fs_negativeCacheSize( "fs_negativeCacheSize", "4096", 0, "How many failed path lookups are remembered, 0 disables it" );
+CVar fs_negativeCacheLifetime( "fs_negativeCacheLifetime", "1000", 0, "Milliseconds a failed path lookup is remembered for, files created in the meantime won't be found until then" );
+CVar fs_mmapThreshold( "fs_mmapThreshold", "64", 0, "Files of at least this many kilobytes are memory-mapped by ReadFile, smaller ones are read into pooled buffers. Loose files are never mapped with fs_hotReload" );
+
 // ============================
 // FileSystem::Init
 // ============================
@@ -27,9 +40,12 @@ bool FileSystem::Init( Path gameDirectory, Path engineDirectory )
 		return false;
 	}
 
+	const auto mountStartTime = chrono::steady_clock::now();
+
 	enginePath = engineDirectory;
 	basePath = fs::current_path();
 	currentGamePath = gameDirectory;
+	caseInsensitive = fs_caseInsensitive.GetBool();
 
 	// The base path contains base engine
 	if ( !MountInternal( enginePath, false, false, true ) )
@@ -45,6 +61,35 @@ bool FileSystem::Init( Path gameDirectory, Path engineDirectory )
 		return false;
 	}
 
+	RebuildIndex();
+
+	const chrono::duration<double, std::milli> mountTime = chrono::steady_clock::now() - mountStartTime;
+	console->Print( adm::format( "FileSystem::Init: Mounted %zu games and %zu packs in %.1f ms",
+		otherPaths.size() + 1U, packs.size(), mountTime.count() ) );
+
+	// Missing on the first run, or if it was deleted, hashes are simply computed again
+	contentCache.Load( GetContentCachePath() );
+
+	if ( fs_hotReload.GetBool() )
+	{
+		fileWatcher = std::make_unique<FileWatcher>();
+		if ( fileWatcher->Init() )
+		{
+			WatchMountedDirectories();
+			console->Print( "FileSystem::Init: Hot reloading is enabled" );
+		}
+		else
+		{
+			console->Warning( "FileSystem::Init: Hot reloading isn't supported here" );
+			fileWatcher.reset();
+		}
+	}
+
+	asyncQueue.Init( console, bufferPool, [this]( const Path& path )
+		{
+			return ReadLooseFile( path );
+		}, fs_ioUring.GetBool() );
+
 	return true;
 }
 
@@ -54,7 +99,29 @@ bool FileSystem::Init( Path gameDirectory, Path engineDirectory )
 void FileSystem::Shutdown()
 {
 	console->Print( "FileSystem::Shutdown" );
+	asyncQueue.Shutdown();
+	fileWatcher.reset();
+	numWatchedDirectories = 0U;
+	pendingChanges.clear();
+	watchSubscriptions.clear();
+
+	if ( contentCache.GetNumSharedFiles() > 0U )
+	{
+		console->Print( adm::format( "FileSystem: Content cache shared %zu files, saving %.1f KiB",
+			contentCache.GetNumSharedFiles(), contentCache.GetNumSharedBytes() / 1024.0 ) );
+	}
+
+	if ( !contentCache.Save( GetContentCachePath() ) )
+	{
+		console->Warning( "FileSystem::Shutdown: Couldn't save the content hash index" );
+	}
+	contentCache.Clear();
+
 	otherPaths.clear();
+	mounts.clear();
+	fileIndex.Clear();
+	negativeLookups.Clear();
+	packs.clear();
 }
 
 // ============================
@@ -62,7 +129,18 @@ void FileSystem::Shutdown()
 // ============================
 bool FileSystem::Mount( Path otherGameDirectory, bool mountOthers )
 {
-	return MountInternal( otherGameDirectory, mountOthers, false, false );
+	const bool mounted = MountInternal( otherGameDirectory, mountOthers, false, false );
+	if ( mounted )
+	{
+		RebuildIndex();
+
+		if ( nullptr != fileWatcher )
+		{
+			WatchMountedDirectories();
+		}
+	}
+
+	return mounted;
 }
 
 // ============================
@@ -110,7 +188,7 @@ const Path& FileSystem::GetCurrentGameDirectory() const
 // ============================
 bool FileSystem::Exists( Path path, const uint8_t& filterFlags, bool noMountedDirectories ) const
 {
-	return GetPathTo( path, filterFlags, noMountedDirectories ).has_value();
+	return GetPathTo( path, filterFlags, noMountedDirectories, true ).has_value();
 }
 
 // ============================
@@ -118,40 +196,295 @@ bool FileSystem::Exists( Path path, const uint8_t& filterFlags, bool noMountedDi
 // ============================
 adm::Optional<Path> FileSystem::GetPathTo( Path destination, const uint8_t& filterFlags, bool noMountedDirectories ) const
 {
-	// If it's absolute or similar, try finding that first
+	return GetPathTo( destination, filterFlags, noMountedDirectories, false );
+}
+
+// ============================
+// FileSystem::GetPathTo
+// ============================
+adm::Optional<Path> FileSystem::GetPathTo( Path destination, const uint8_t& filterFlags, bool noMountedDirectories, bool includePacks ) const
+{
+	// Absolute paths don't belong to any mount
+	if ( destination.is_absolute() )
+	{
+		if ( ExistsInternal( destination, filterFlags ) )
+		{
+			return destination;
+		}
+
+		return {};
+	}
+
+	// Mounts are in priority order: current game, dependent games, engine
+	if ( const auto location = fileIndex.Find( destination, filterFlags ) )
+	{
+		// The current game always comes first, so if it isn't
+		// the one that has it, it doesn't have it at all
+		// Packed files aren't on disk, so unless they're asked
+		// for, whatever loose file comes next is looked for instead
+		const bool packed = nullptr != mounts[location->mount].pack;
+		if ( (!noMountedDirectories || location->mount < numCurrentGameMounts) && (includePacks || !packed) )
+		{
+			// With fs_caseInsensitive, the path on disk may be cased differently
+			Path path = mounts[location->mount].path/location->path;
+
+			// Packs don't change, and hot reloading keeps the index up to date,
+			// otherwise nothing tells the index that a loose file was deleted
+			if ( packed || nullptr != fileWatcher || ExistsInternal( path, filterFlags ) )
+			{
+				return path;
+			}
+		}
+	}
+
+	// Optional files that don't exist are usually probed for over and over
+	String negativeKey = NegativeLookupCache::MakeKey( FileIndex::Normalise( destination ), filterFlags, noMountedDirectories );
+	if ( negativeLookups.Contains( negativeKey, chrono::milliseconds( std::max( 0, fs_negativeCacheLifetime.GetInt() ) ) ) )
+	{
+		return {};
+	}
+
+	// The index only knows what was there when it was built
+	if ( auto path = FindLooseFile( destination, filterFlags, noMountedDirectories ) )
+	{
+		return path;
+	}
+
+	// Relative to the working directory, e.g. 'games/base/gameConfig.json'
 	if ( ExistsInternal( destination, filterFlags ) )
 	{
 		return destination;
 	}
 
-	// Find it in the current game dir
-	if ( ExistsInternal( basePath/currentGamePath/destination, filterFlags ) )
+	// We didn't find it
+	negativeLookups.Add( std::move( negativeKey ), std::max( 0, fs_negativeCacheSize.GetInt() ) );
+	return {};
+}
+
+// ============================
+// FileSystem::GetPackedFile
+// ============================
+bool FileSystem::GetPackedFile( Path destination, const uint8_t*& outData, size_t& outSize ) const
+{
+	if ( destination.is_absolute() )
+	{
+		return false;
+	}
+
+	const auto location = fileIndex.Find( destination, Path_File );
+	if ( !location || location->packEntry == FileIndex::NoPackEntry )
 	{
-		return basePath/currentGamePath/destination;
+		return false;
 	}
 
-	if ( noMountedDirectories )
+	const PackFile* pack = mounts[location->mount].pack;
+	if ( pack->IsEntryCompressed( location->packEntry ) )
+	{
+		return false;
+	}
+
+	outData = pack->GetEntryData( location->packEntry );
+	outSize = pack->GetEntrySize( location->packEntry );
+	return true;
+}
+
+// ============================
+// FileSystem::ReadFile
+// ============================
+FileView FileSystem::ReadFile( Path path, bool noMountedDirectories ) const
+{
+	const auto file = ResolveFile( path, noMountedDirectories );
+	if ( !file )
 	{
 		return {};
 	}
 
-	// Check every dependent game dir
-	for ( const auto& otherGamePath : otherPaths )
+	return ReadSharedFile( *file );
+}
+
+// ============================
+// FileSystem::ReadSharedFile
+// ============================
+FileView FileSystem::ReadSharedFile( const ResolvedFile& file ) const
+{
+	if ( !fs_contentCache.GetBool() )
+	{
+		return ReadResolvedFile( file );
+	}
+
+	// If this file is still loaded and hasn't changed, nothing has to be read
+	const FileStamp stamp = GetFileStamp( file );
+	const String key = file.path.string();
+	if ( FileView loadedFile = contentCache.FindLoaded( key, stamp ) )
 	{
-		if ( ExistsInternal( basePath/otherGamePath/destination, filterFlags ) )
+		return loadedFile;
+	}
+
+	return contentCache.Share( key, stamp, ReadResolvedFile( file ) );
+}
+
+// ============================
+// FileSystem::ReadFilePart
+// ============================
+FileView FileSystem::ReadFilePart( Path path, size_t offset, size_t size, bool noMountedDirectories ) const
+{
+	const auto file = ResolveFile( path, noMountedDirectories );
+	if ( !file )
+	{
+		return {};
+	}
+
+	if ( nullptr != file->pack )
+	{
+		const PackFile* pack = file->pack;
+		const uint32_t entry = file->packEntry;
+		const uint64_t fileSize = pack->GetEntrySize( entry );
+		if ( offset > fileSize || size > fileSize - offset )
 		{
-			return basePath/otherGamePath/destination;
+			return {};
 		}
+
+		if ( !pack->IsEntryCompressed( entry ) )
+		{
+			return FileView( pack->shared_from_this(), pack->GetEntryData( entry ) + offset, size );
+		}
+
+		std::shared_ptr<uint8_t> buffer = AllocateBuffer( size );
+		if ( !pack->ReadEntry( entry, offset, size, buffer.get(), jobSystem ) )
+		{
+			return {};
+		}
+
+		const uint8_t* data = buffer.get();
+		return FileView( std::move( buffer ), data, size );
 	}
 
-	// Find it in the engine
-	if ( ExistsInternal( basePath/enginePath/ destination, filterFlags ) )
+	std::FILE* looseFile = std::fopen( file->path.string().c_str(), "rb" );
+	if ( nullptr == looseFile )
 	{
-		return basePath/enginePath/destination;
+		return {};
 	}
 
-	// We didn't find it
-	return {};
+	std::shared_ptr<uint8_t> buffer = AllocateBuffer( size );
+	// long is 32-bit on Windows, which wouldn't get past 2 GiB
+#if ADM_PLATFORM == PLATFORM_WINDOWS
+	const bool seeked = _fseeki64( looseFile, static_cast<int64_t>( offset ), SEEK_SET ) == 0;
+#else
+	const bool seeked = fseeko( looseFile, static_cast<off_t>( offset ), SEEK_SET ) == 0;
+#endif
+	const size_t bytesRead = seeked ? std::fread( buffer.get(), 1U, size, looseFile ) : 0U;
+	std::fclose( looseFile );
+
+	if ( bytesRead != size )
+	{
+		return {};
+	}
+
+	const uint8_t* data = buffer.get();
+	return FileView( std::move( buffer ), data, size );
+}
+
+// ============================
+// FileSystem::ReadFileAsync
+// ============================
+FileRequestId FileSystem::ReadFileAsync( Path path, FileRequestCallback callback, FileRequestPriority priority, bool noMountedDirectories )
+{
+	const auto file = ResolveFile( path, noMountedDirectories );
+	if ( !file )
+	{
+		return asyncQueue.SubmitFinished( {}, std::move( callback ) );
+	}
+
+	// Uncompressed packed files are already mapped, so there's nothing to wait for
+	if ( nullptr != file->pack && (!file->pack->IsEntryCompressed( file->packEntry ) || nullptr == jobSystem) )
+	{
+		return asyncQueue.SubmitFinished( ReadSharedFile( *file ), std::move( callback ) );
+	}
+
+	// Compressed ones are decompressed by a job, the pack is kept alive in case the filesystem shuts down first
+	if ( nullptr != file->pack )
+	{
+		const FileRequestId id = asyncQueue.SubmitExternal( std::move( callback ) );
+		jobSystem->Schedule( [this, id, file = *file, pack = file->pack->shared_from_this()]
+			{
+				asyncQueue.FinishExternal( id, ReadSharedFile( file ) );
+			} );
+		return id;
+	}
+
+	if ( !fs_contentCache.GetBool() )
+	{
+		return asyncQueue.Submit( file->path, priority, std::move( callback ) );
+	}
+
+	const FileStamp stamp = GetFileStamp( *file );
+	String key = file->path.string();
+	if ( FileView loadedFile = contentCache.FindLoaded( key, stamp ) )
+	{
+		return asyncQueue.SubmitFinished( std::move( loadedFile ), std::move( callback ) );
+	}
+
+	// Hashed and compared on the reading thread, so the main thread doesn't pay for it
+	return asyncQueue.Submit( file->path, priority, std::move( callback ),
+		[this, key = std::move( key ), stamp]( FileView view )
+		{
+			return contentCache.Share( key, stamp, std::move( view ) );
+		} );
+}
+
+// ============================
+// FileSystem::CancelRead
+// ============================
+bool FileSystem::CancelRead( FileRequestId id )
+{
+	return asyncQueue.Cancel( id );
+}
+
+// ============================
+// FileSystem::Update
+// ============================
+void FileSystem::Update()
+{
+	asyncQueue.DispatchCompletions();
+
+	if ( nullptr != fileWatcher )
+	{
+		UpdateHotReload();
+	}
+
+	if ( const auto numLookups = indexBenchmarkRequest.Take() )
+	{
+		RunIndexBenchmark( *numLookups );
+	}
+}
+
+// ============================
+// FileSystem::RequestIndexBenchmark
+// ============================
+void FileSystem::RequestIndexBenchmark( uint32_t numLookups )
+{
+	indexBenchmarkRequest.Request( numLookups );
+}
+
+// ============================
+// FileSystem::WatchPath
+// ============================
+FileWatchId FileSystem::WatchPath( Path path, FileChangeCallback callback )
+{
+	const FileWatchId id = nextWatchId++;
+	watchSubscriptions.push_back( { id, FileIndex::Normalise( path ), std::move( callback ) } );
+	return id;
+}
+
+// ============================
+// FileSystem::UnwatchPath
+// ============================
+void FileSystem::UnwatchPath( FileWatchId id )
+{
+	watchSubscriptions.erase( std::remove_if( watchSubscriptions.begin(), watchSubscriptions.end(), [id]( const WatchSubscription& subscription )
+		{
+			return subscription.id == id;
+		} ), watchSubscriptions.end() );
 }
 
 // ============================
@@ -159,67 +492,651 @@ adm::Optional<Path> FileSystem::GetPathTo( Path destination, const uint8_t& filt
 // ============================
 bool FileSystem::MountInternal( Path otherGameDirectory, bool mountOthers, bool mountingMainGame, bool mountingEngine )
 {
-	String otherGameDirectoryStr =
-		otherGameDirectory.is_absolute() ? // Paths that are already relative can be passed directly
-		otherGameDirectory.lexically_relative( basePath ).string() :
-		otherGameDirectory.string();
-
-	console->Print( adm::format( "FileSystem::Mount: Mounting '%s'...", otherGameDirectoryStr.c_str() ) );
+	// Make sure it's unique before proceeding
+	if ( IsMounted( otherGameDirectory ) )
+	{
+		return true;
+	}
 
-	if ( !fs::exists( otherGameDirectory ) )
+	DiscoveredGame game = DiscoverGame( otherGameDirectory, mountingEngine );
+	if ( !CommitGame( game, mountingMainGame, mountingEngine ) )
 	{
-		console->Warning( adm::format( "FileSystem::Mount: Game directory '%s' doesn't exist", otherGameDirectoryStr.c_str() ) );
 		return false;
 	}
 
-	// Make sure it's unique before proceeding
-	for ( const auto& path : otherPaths )
+	// Mount other games that this one depends on
+	if ( mountOthers && !mountingEngine )
 	{
-		if ( otherGameDirectory == path )
+		MountDependencies( game.metadata );
+	}
+
+	return true;
+}
+
+// ============================
+// FileSystem::MountDependencies
+// ============================
+void FileSystem::MountDependencies( const GameMetadata& metadata )
+{
+	Vector<StringView> names;
+	Vector<Path> directories;
+	for ( StringView mountedGame : metadata.GetMountedGames() )
+	{
+		Path directory = basePath/mountedGame;
+		if ( std::find( directories.begin(), directories.end(), directory ) == directories.end() )
 		{
-			return true;
+			names.push_back( mountedGame );
+			directories.push_back( std::move( directory ) );
 		}
 	}
 
+	// Parsing configs and opening packs doesn't touch the filesystem's state,
+	// so it's done for all dependencies at once, it's most of the time spent here
+	Vector<Optional<DiscoveredGame>> games( directories.size() );
+	const auto discover = [&]( size_t begin, size_t end )
+	{
+		for ( size_t i = begin; i < end; i++ )
+		{
+			if ( !IsMounted( directories[i] ) )
+			{
+				games[i] = DiscoverGame( directories[i], false );
+			}
+		}
+	};
+
+	if ( nullptr != jobSystem )
+	{
+		jobSystem->ParallelFor( directories.size(), 1U, discover );
+	}
+	else
+	{
+		discover( 0U, directories.size() );
+	}
+
+	// Committed in the order gameConfig.json lists them, not the order
+	// they were discovered in, so priority is the same on every run
+	for ( size_t i = 0U; i < games.size(); i++ )
+	{
+		if ( games[i] && !CommitGame( *games[i], false, false ) )
+		{
+			console->Warning( adm::format( "FileSystem::Mount: Can't mount dependency '%s', you may have missing content!", names[i].data() ) );
+		}
+	}
+}
+
+// ============================
+// FileSystem::DiscoverGame
+// ============================
+FileSystem::DiscoveredGame FileSystem::DiscoverGame( const Path& directory, bool mountingEngine ) const
+{
+	DiscoveredGame game;
+	game.directory = directory;
+	game.exists = fs::exists( directory );
+	if ( !game.exists )
+	{
+		return game;
+	}
+
 	// The engine does not require a game config
 	if ( !mountingEngine )
 	{
-		GameMetadata gameMeta( otherGameDirectory/"gameConfig.json" );
-		if ( !gameMeta )
+		game.metadata = GameMetadata( directory/"gameConfig.json" );
+		if ( !game.metadata )
+		{
+			return game;
+		}
+	}
+
+	DiscoverPacks( basePath/directory, game );
+	return game;
+}
+
+// ============================
+// FileSystem::CommitGame
+// ============================
+bool FileSystem::CommitGame( DiscoveredGame& game, bool mountingMainGame, bool mountingEngine )
+{
+	String directoryStr =
+		game.directory.is_absolute() ? // Paths that are already relative can be passed directly
+		game.directory.lexically_relative( basePath ).string() :
+		game.directory.string();
+
+	console->Print( adm::format( "FileSystem::Mount: Mounting '%s'...", directoryStr.c_str() ) );
+
+	if ( !game.exists )
+	{
+		console->Warning( adm::format( "FileSystem::Mount: Game directory '%s' doesn't exist", directoryStr.c_str() ) );
+		return false;
+	}
+
+	// The game may have been mounted while this one was being discovered,
+	// e.g. when two dependencies are the same directory spelt differently
+	if ( IsMounted( game.directory ) )
+	{
+		return true;
+	}
+
+	if ( !mountingEngine )
+	{
+		if ( !game.metadata )
 		{
-			console->Warning( adm::format( "FileSystem::Mount: Game directory '%s' doesn't have a gameConfig.json", otherGameDirectoryStr.c_str() ) );
+			console->Warning( adm::format( "FileSystem::Mount: Game directory '%s' doesn't have a gameConfig.json", directoryStr.c_str() ) );
 			return false;
 		}
 
-		console->Print( adm::format( "FileSystem::Mount: Mounted game '%s'", gameMeta.GetName().data() ) );
-		console->Print( adm::format( "                   Developer:   %s", gameMeta.GetDeveloper().data() ) );
-		console->Print( adm::format( "                   Publisher:   %s", gameMeta.GetPublisher().data() ) );
-		console->Print( adm::format( "                   Version:     %s", gameMeta.GetVersion().data() ) );
+		console->Print( adm::format( "FileSystem::Mount: Mounted game '%s'", game.metadata.GetName().data() ) );
+		console->Print( adm::format( "                   Developer:   %s", game.metadata.GetDeveloper().data() ) );
+		console->Print( adm::format( "                   Publisher:   %s", game.metadata.GetPublisher().data() ) );
+		console->Print( adm::format( "                   Version:     %s", game.metadata.GetVersion().data() ) );
 
 		if ( mountingMainGame )
 		{
-			gameMetadata = gameMeta;
+			gameMetadata = game.metadata;
 		}
 		else
 		{
-			otherMetadatas.push_back( gameMeta );
-			otherPaths.push_back( otherGameDirectory );
+			otherMetadatas.push_back( game.metadata );
+			otherPaths.push_back( game.directory );
 		}
+	}
 
-		// Mount other games that this one depends on
-		if ( mountOthers )
+	const Path packDirectory = basePath/game.directory;
+	for ( const Path& invalidPack : game.invalidPacks )
+	{
+		console->Warning( adm::format( "FileSystem::Mount: '%s' is not a valid pack, skipping", invalidPack.filename().string().c_str() ) );
+	}
+
+	for ( auto& pack : game.packs )
+	{
+		const bool alreadyMounted = std::any_of( packs.begin(), packs.end(), [&pack]( const MountedPack& mountedPack )
+			{
+				return mountedPack.pack->GetPath() == pack->GetPath();
+			} );
+
+		if ( alreadyMounted )
 		{
-			for ( StringView mountedGame : gameMeta.GetMountedGames() )
+			continue;
+		}
+
+		console->Print( adm::format( "FileSystem::Mount: Mounted pack '%s' (%u files)", pack->GetPath().filename().string().c_str(), pack->GetNumEntries() ) );
+		packs.push_back( { packDirectory, std::move( pack ) } );
+	}
+
+	return true;
+}
+
+// ============================
+// FileSystem::IsMounted
+// ============================
+bool FileSystem::IsMounted( const Path& gameDirectory ) const
+{
+	return std::find( otherPaths.begin(), otherPaths.end(), gameDirectory ) != otherPaths.end();
+}
+
+// ============================
+// FileSystem::RebuildIndex
+// ============================
+void FileSystem::RebuildIndex()
+{
+	mounts.clear();
+	mounts.reserve( otherPaths.size() + packs.size() + 2U );
+
+	const auto addMount = [this]( const Path& directory )
+	{
+		mounts.push_back( { directory, nullptr } );
+		for ( const MountedPack& mountedPack : packs )
+		{
+			if ( mountedPack.directory == directory )
 			{
-				if ( !MountInternal( basePath/mountedGame, false, false, false ) )
-				{
-					console->Warning( adm::format( "FileSystem::Mount: Can't mount dependency '%s', you may have missing content!", mountedGame.data() ) );
-				}
+				mounts.push_back( { mountedPack.pack->GetPath(), mountedPack.pack.get() } );
 			}
 		}
+	};
+
+	addMount( basePath/currentGamePath );
+	numCurrentGameMounts = static_cast<uint16_t>( mounts.size() );
+	for ( const auto& otherGamePath : otherPaths )
+	{
+		addMount( basePath/otherGamePath );
 	}
+	addMount( basePath/enginePath );
 
-	return true;
+	fileIndex.Build( mounts, caseInsensitive, jobSystem );
+	// Whatever's new may be what failed to resolve before
+	negativeLookups.Clear();
+
+	console->Print( adm::format( "FileSystem: Indexed %zu paths in %zu mounts", fileIndex.GetNumEntries(), mounts.size() ) );
+}
+
+// ============================
+// FileSystem::WatchMountedDirectories
+// ============================
+void FileSystem::WatchMountedDirectories()
+{
+	// The current game, then other games in the order they were mounted
+	// The engine directory isn't watched, only game content is iterated on
+	for ( ; numWatchedDirectories < otherPaths.size() + 1U; numWatchedDirectories++ )
+	{
+		const Path& directory = 0U == numWatchedDirectories ? currentGamePath : otherPaths[numWatchedDirectories - 1U];
+		fileWatcher->WatchDirectory( basePath/directory );
+	}
+}
+
+// ============================
+// FileSystem::RunIndexBenchmark
+// ============================
+void FileSystem::RunIndexBenchmark( uint32_t numLookups )
+{
+	using Clock = chrono::steady_clock;
+
+	// A fresh index scans every mount again, the real one is left alone
+	FileIndex scratchIndex;
+	const Clock::time_point scanStartTime = Clock::now();
+	scratchIndex.Build( mounts, caseInsensitive, jobSystem );
+	const Clock::time_point scanEndTime = Clock::now();
+
+	Vector<String> indexedPaths;
+	indexedPaths.reserve( scratchIndex.GetNumEntries() );
+	scratchIndex.ForEachPath( [&]( StringView path )
+		{
+			indexedPaths.emplace_back( path );
+		} );
+
+	if ( indexedPaths.empty() )
+	{
+		console->Warning( "fs_indexBenchmark: nothing is mounted" );
+		return;
+	}
+
+	// Random paths, so consecutive lookups don't share cache lines
+	std::mt19937 random( 1U );
+	Vector<Path> existingPaths;
+	Vector<Path> missingPaths;
+	existingPaths.reserve( numLookups );
+	missingPaths.reserve( numLookups );
+	for ( uint32_t i = 0U; i < numLookups; i++ )
+	{
+		const String& path = indexedPaths[random() % indexedPaths.size()];
+		existingPaths.emplace_back( path );
+		missingPaths.emplace_back( path + ".missing" );
+	}
+
+	const uint8_t filterFlags = Path_File | Path_Directory;
+	size_t numFound = 0U;
+
+	const Clock::time_point hitStartTime = Clock::now();
+	for ( const Path& path : existingPaths )
+	{
+		numFound += scratchIndex.Find( path, filterFlags ) ? 1U : 0U;
+	}
+
+	const Clock::time_point missStartTime = Clock::now();
+	for ( const Path& path : missingPaths )
+	{
+		numFound += scratchIndex.Find( path, filterFlags ) ? 1U : 0U;
+	}
+
+	// What resolving cost before the index: checking every loose mount in
+	// priority order until one has it. Far slower, so it gets fewer lookups
+	const size_t numDiskLookups = std::min<size_t>( numLookups, 10000U );
+	const Clock::time_point diskStartTime = Clock::now();
+	for ( size_t i = 0U; i < numDiskLookups; i++ )
+	{
+		for ( const FileIndex::Mount& mount : mounts )
+		{
+			std::error_code error;
+			if ( nullptr == mount.pack && fs::exists( mount.path/existingPaths[i], error ) )
+			{
+				numFound++;
+				break;
+			}
+		}
+	}
+
+	const Clock::time_point endTime = Clock::now();
+	const auto nanoseconds = []( Clock::duration duration )
+	{
+		return chrono::duration<double, std::nano>( duration ).count();
+	};
+
+	console->Print( adm::format( "FileSystem: Index benchmark with %zu mounts, %u lookups:", mounts.size(), numLookups ) );
+	console->Print( adm::format( "   * scan:               %.1f ms for %zu paths", nanoseconds( scanEndTime - scanStartTime ) / 1e6, indexedPaths.size() ) );
+	console->Print( adm::format( "   * indexed hit:        %.1f ns per lookup", nanoseconds( missStartTime - hitStartTime ) / std::max( numLookups, 1U ) ) );
+	console->Print( adm::format( "   * indexed miss:       %.1f ns per lookup", nanoseconds( diskStartTime - missStartTime ) / std::max( numLookups, 1U ) ) );
+	console->Print( adm::format( "   * stat per mount:     %.1f ns per lookup (%zu)", nanoseconds( endTime - diskStartTime ) / std::max<size_t>( numDiskLookups, 1U ), numFound ) );
+}
+
+// ============================
+// FileSystem::UpdateHotReload
+// ============================
+void FileSystem::UpdateHotReload()
+{
+	using Clock = chrono::steady_clock;
+
+	polledChanges.clear();
+	fileWatcher->Poll( polledChanges );
+
+	const Clock::time_point now = Clock::now();
+	for ( const Path& changedPath : polledChanges )
+	{
+		pendingChanges[changedPath.string()] = now;
+	}
+
+	if ( pendingChanges.empty() )
+	{
+		return;
+	}
+
+	const auto delay = chrono::milliseconds( std::max( 0, fs_hotReloadDelay.GetInt() ) );
+	Vector<Path> changedPaths;
+	for ( auto iterator = pendingChanges.begin(); iterator != pendingChanges.end(); )
+	{
+		if ( now - iterator->second < delay )
+		{
+			iterator++;
+			continue;
+		}
+
+		changedPaths.push_back( iterator->first );
+		iterator = pendingChanges.erase( iterator );
+	}
+
+	if ( changedPaths.empty() )
+	{
+		return;
+	}
+
+	Vector<Path> watchedDirectories{ basePath/currentGamePath };
+	for ( const Path& otherPath : otherPaths )
+	{
+		watchedDirectories.push_back( basePath/otherPath );
+	}
+
+	// Files are reported relative to the mounts, so the same file
+	// changing in two games is only reported once
+	Vector<String> relativePaths;
+	for ( const Path& changedPath : changedPaths )
+	{
+		for ( const Path& directory : watchedDirectories )
+		{
+			const Path relativePath = changedPath.lexically_relative( directory );
+			if ( relativePath.empty() || *relativePath.begin() == ".." )
+			{
+				continue;
+			}
+
+			if ( relativePath.extension() == BtxPack::Extension )
+			{
+				console->Warning( adm::format( "FileSystem: Pack '%s' changed, packs are only reloaded on restart", changedPath.string().c_str() ) );
+				break;
+			}
+
+			fileIndex.Invalidate( directory );
+			relativePaths.push_back( FileIndex::Normalise( relativePath ) );
+			break;
+		}
+	}
+
+	if ( relativePaths.empty() )
+	{
+		return;
+	}
+
+	// Subscribers will want to read the new files, so the index goes first
+	RebuildIndex();
+
+	std::sort( relativePaths.begin(), relativePaths.end() );
+	relativePaths.erase( std::unique( relativePaths.begin(), relativePaths.end() ), relativePaths.end() );
+
+	// Either one may be a directory, e.g. if a whole directory got moved in
+	const auto isSameOrInside = []( StringView path, StringView directory )
+	{
+		return directory.empty() || path == directory
+			|| (path.size() > directory.size() && path[directory.size()] == '/' && path.substr( 0U, directory.size() ) == directory);
+	};
+
+	Vector<FileChangeCallback> callbacks;
+	for ( const String& relativePath : relativePaths )
+	{
+		console->Print( adm::format( "FileSystem: '%s' changed", relativePath.c_str() ) );
+
+		// Copied, since callbacks may watch or unwatch paths themselves
+		callbacks.clear();
+		for ( const WatchSubscription& subscription : watchSubscriptions )
+		{
+			if ( isSameOrInside( relativePath, subscription.path ) || isSameOrInside( subscription.path, relativePath ) )
+			{
+				callbacks.push_back( subscription.callback );
+			}
+		}
+
+		for ( const FileChangeCallback& callback : callbacks )
+		{
+			callback( relativePath );
+		}
+	}
+}
+
+// ============================
+// FileSystem::DiscoverPacks
+// ============================
+void FileSystem::DiscoverPacks( const Path& directory, DiscoveredGame& game )
+{
+	Vector<Path> packPaths;
+	std::error_code error;
+	for ( const auto& directoryEntry : fs::directory_iterator( directory, error ) )
+	{
+		if ( directoryEntry.path().extension() == BtxPack::Extension && directoryEntry.is_regular_file( error ) )
+		{
+			packPaths.push_back( directoryEntry.path() );
+		}
+	}
+
+	// Directory iteration order is up to the OS, priority shouldn't be
+	std::sort( packPaths.begin(), packPaths.end() );
+
+	for ( Path& packPath : packPaths )
+	{
+		auto pack = std::make_shared<PackFile>();
+		if ( !pack->Open( packPath ) )
+		{
+			game.invalidPacks.push_back( std::move( packPath ) );
+			continue;
+		}
+
+		game.packs.push_back( std::move( pack ) );
+	}
+}
+
+// ============================
+// FileSystem::ResolveFile
+// ============================
+Optional<FileSystem::ResolvedFile> FileSystem::ResolveFile( const Path& path, bool noMountedDirectories ) const
+{
+	if ( !path.is_absolute() )
+	{
+		const auto location = fileIndex.Find( path, Path_File );
+		if ( location && location->packEntry != FileIndex::NoPackEntry
+			&& (!noMountedDirectories || location->mount < numCurrentGameMounts) )
+		{
+			return ResolvedFile{ mounts[location->mount].path/location->path, mounts[location->mount].pack, location->packEntry };
+		}
+	}
+
+	const auto resolvedPath = GetPathTo( path, Path_File, noMountedDirectories );
+	if ( !resolvedPath )
+	{
+		return {};
+	}
+
+	return ResolvedFile{ *resolvedPath };
+}
+
+// ============================
+// FileSystem::ReadResolvedFile
+// ============================
+FileView FileSystem::ReadResolvedFile( const ResolvedFile& file ) const
+{
+	if ( nullptr == file.pack )
+	{
+		return ReadLooseFile( file.path );
+	}
+
+	// Packed files are already mapped, so there's nothing to read, unless they're compressed
+	const PackFile* pack = file.pack;
+	const uint32_t entry = file.packEntry;
+	const size_t size = pack->GetEntrySize( entry );
+	if ( !pack->IsEntryCompressed( entry ) )
+	{
+		return FileView( pack->shared_from_this(), pack->GetEntryData( entry ), size );
+	}
+
+	std::shared_ptr<uint8_t> buffer = AllocateBuffer( size );
+	if ( !pack->ReadEntry( entry, 0U, size, buffer.get(), jobSystem ) )
+	{
+		console->Warning( adm::format( "FileSystem::ReadFile: '%s' is damaged", file.path.string().c_str() ) );
+		return {};
+	}
+
+	const uint8_t* data = buffer.get();
+	return FileView( std::move( buffer ), data, size );
+}
+
+// ============================
+// FileSystem::ReadLooseFile
+// ============================
+FileView FileSystem::ReadLooseFile( const Path& path ) const
+{
+	std::error_code error;
+	const size_t size = fs::file_size( path, error );
+	if ( error )
+	{
+		return {};
+	}
+
+	// Mapping costs a few syscalls and page faults, which
+	// only pays off once there's enough data to not copy
+	// Files that are being edited may get truncated while they're still mapped, and touching
+	// the missing pages is a SIGBUS, so with hot reloading they're always copied. Packs are
+	// baked content, they stay mapped either way
+	const size_t mmapThreshold = std::max( 0, fs_mmapThreshold.GetInt() ) * 1024U;
+	if ( size >= mmapThreshold && !fs_hotReload.GetBool() )
+	{
+		auto mappedFile = std::make_shared<MappedFile>();
+		if ( mappedFile->Open( path ) )
+		{
+			const uint8_t* data = mappedFile->GetData();
+			return FileView( std::move( mappedFile ), data, size );
+		}
+	}
+
+	std::shared_ptr<uint8_t> buffer = AllocateBuffer( size );
+	std::FILE* file = std::fopen( path.string().c_str(), "rb" );
+	if ( nullptr == file )
+	{
+		return {};
+	}
+
+	const size_t bytesRead = std::fread( buffer.get(), 1U, size, file );
+	std::fclose( file );
+
+	if ( bytesRead != size )
+	{
+		return {};
+	}
+
+	const uint8_t* data = buffer.get();
+	return FileView( std::move( buffer ), data, size );
+}
+
+// ============================
+// FileSystem::GetContentCachePath
+// ============================
+Path FileSystem::GetContentCachePath() const
+{
+	Path directory = String( fs_cacheDirectory.GetString() );
+	if ( directory.empty() )
+	{
+		// Game directories may well be read-only, and aren't the place for per-machine state
+#if ADM_PLATFORM == PLATFORM_WINDOWS
+		const char* userCache = std::getenv( "LOCALAPPDATA" );
+#else
+		const char* userCache = std::getenv( "XDG_CACHE_HOME" );
+		const char* home = std::getenv( "HOME" );
+		if ( nullptr == userCache && nullptr != home )
+		{
+			directory = Path( home )/".cache";
+		}
+#endif
+		if ( nullptr != userCache )
+		{
+			directory = userCache;
+		}
+
+		if ( directory.empty() )
+		{
+			std::error_code error;
+			directory = fs::temp_directory_path( error );
+		}
+
+		directory /= "btx";
+	}
+
+	return directory/currentGamePath.filename()/ContentCacheFileName;
+}
+
+// ============================
+// FileSystem::GetFileStamp
+// ============================
+FileStamp FileSystem::GetFileStamp( const ResolvedFile& file ) const
+{
+	if ( nullptr != file.pack )
+	{
+		return { file.pack->GetEntrySize( file.packEntry ), file.pack->GetModifiedTime() };
+	}
+
+	std::error_code error;
+	FileStamp stamp;
+	stamp.size = fs::file_size( file.path, error );
+	stamp.modifiedTime = fs::last_write_time( file.path, error ).time_since_epoch().count();
+	return stamp;
+}
+
+// ============================
+// FileSystem::AllocateBuffer
+// ============================
+std::shared_ptr<uint8_t> FileSystem::AllocateBuffer( size_t size ) const
+{
+	std::shared_ptr<uint8_t> buffer = bufferPool->Acquire( size );
+	if ( nullptr == buffer )
+	{
+		buffer = std::shared_ptr<uint8_t>( new uint8_t[size], std::default_delete<uint8_t[]>() );
+	}
+
+	return buffer;
+}
+
+// ============================
+// FileSystem::FindLooseFile
+// ============================
+Optional<Path> FileSystem::FindLooseFile( const Path& destination, const uint8_t& filterFlags, bool noMountedDirectories ) const
+{
+	const size_t numMounts = noMountedDirectories ? numCurrentGameMounts : mounts.size();
+	for ( size_t i = 0U; i < numMounts; i++ )
+	{
+		if ( nullptr != mounts[i].pack )
+		{
+			continue;
+		}
+
+		Path path = mounts[i].path/destination;
+		if ( ExistsInternal( path, filterFlags ) )
+		{
+			return path;
+		}
+	}
+
+	return {};
 }
 
 // ============================
@@ -3,6 +3,19 @@
 
 #pragma once
 
+#include "AsyncFileQueue.hpp"
+#include "../console/DeferredRequest.hpp"
+#include "ContentCache.hpp"
+#include "FileIndex.hpp"
+#include "FileView.hpp"
+#include "FileWatcher.hpp"
+#include "NegativeLookupCache.hpp"
+#include "PackFile.hpp"
+
+using FileWatchId = uint32_t;
+// Called on the main thread with the path relative to the mounts, e.g. 'models/crate.obj'
+using FileChangeCallback = std::function<void( const Path& path )>;
+
 class FileSystem final : public IFileSystem
 {
 public:
@@ -20,17 +33,130 @@ public:
 
 	bool				Exists( Path path, const uint8_t& filterFlags, bool noMountedDirectories ) const override;
 
+	// Resolves through the file index, falling back to looking in each mounted directory
+	// on disk if it isn't indexed, as files may have been added since. Without fs_hotReload,
+	// indexed loose files are checked to still be there
+	// Paths that failed to resolve are remembered for fs_negativeCacheLifetime, or until the
+	// next mount or hot reload, so a file that's created right after failing to resolve
+	// may take that long to be found
+	// Only returns paths that can be opened, files inside packs are skipped, use ReadFile for those
 	Optional<Path>		GetPathTo( Path destination, const uint8_t& filterFlags, bool noMountedDirectories ) const override;
+	// Same, but files inside packs resolve to '<pack path>/<destination>' if includePacks is true,
+	// which is only good for comparing where files come from, see GetPackedFile
+	Optional<Path>		GetPathTo( Path destination, const uint8_t& filterFlags, bool noMountedDirectories, bool includePacks ) const;
+
+	// Contents of a file if it resolves into a pack, straight from the pack's memory mapping
+	// Valid until the filesystem shuts down. Compressed files can't be accessed this way
+	bool				GetPackedFile( Path destination, const uint8_t*& outData, size_t& outSize ) const;
+
+	// Reads a whole file, resolved like GetPathTo, without copying it where possible:
+	// packed files point into the pack, large files are memory-mapped (except with
+	// fs_hotReload, as they may get truncated) and small ones are read into pooled
+	// buffers. Returns an invalid view if the file can't be read
+	// Files identical to one that's still loaded share its memory, see ContentCache
+	// Thread-safe as long as nothing is being mounted at the same time
+	FileView			ReadFile( Path path, bool noMountedDirectories = false ) const;
+	// Reads size bytes starting at offset, resolved like ReadFile. Compressed
+	// packed files only decompress the blocks that overlap the range
+	// Returns an invalid view if the range goes past the end of the file
+	FileView			ReadFilePart( Path path, size_t offset, size_t size, bool noMountedDirectories = false ) const;
+
+	// Reads a whole file in the background, the callback is called on the main thread
+	// It's called exactly once, unless the filesystem shuts down before that
+	// Compressed packed files are decompressed by the job system
+	FileRequestId		ReadFileAsync( Path path, FileRequestCallback callback,
+		FileRequestPriority priority = FileRequestPriority::Normal, bool noMountedDirectories = false );
+	// The callback will be called with FileRequestStatus::Cancelled
+	bool				CancelRead( FileRequestId id );
+
+	// Delivers finished async reads and file changes, called by the engine once per frame
+	void				Update();
+
+	// Calls callback whenever a file at or under path changes, in any of
+	// the mounted games. An empty path watches everything. Only works if
+	// fs_hotReload was enabled at startup, otherwise nothing is ever reported
+	FileWatchId			WatchPath( Path path, FileChangeCallback callback );
+	void				UnwatchPath( FileWatchId id );
+
+	bool				IsHotReloadEnabled() const
+	{
+		return nullptr != fileWatcher;
+	}
+
+	// Times scanning every mount, and resolving paths with and without
+	// the file index, during the next Update. Thread-safe
+	void				RequestIndexBenchmark( uint32_t numLookups );
+
+	// Paths that failed to resolve, see GetPathTo
+	const NegativeLookupCache& GetNegativeLookupCache() const
+	{
+		return negativeLookups;
+	}
 
-	void				Setup( ICore* core, IConsole* console )
+	// The job system is used to decompress packed files, it must be initialised first
+	void				Setup( ICore* core, IConsole* console, JobSystem* jobSystem )
 	{
 		this->core = core;
 		this->console = console;
+		this->jobSystem = jobSystem;
 	}
 
 private:
+	// Where a file resolved to: a loose file, or an entry in a pack
+	struct ResolvedFile
+	{
+		// Packed files are '<pack path>/<destination>'
+		Path			path;
+		const PackFile*	pack{ nullptr };
+		uint32_t		packEntry{ FileIndex::NoPackEntry };
+	};
+
+	// A game that's about to be mounted, everything that can be
+	// done without touching the filesystem's state is done up front
+	struct DiscoveredGame
+	{
+		Path			directory;
+		bool			exists{ false };
+		// Empty for the engine
+		GameMetadata	metadata;
+		// Opened, sorted by path, not yet mounted
+		Vector<std::shared_ptr<PackFile>> packs;
+		Vector<Path>	invalidPacks;
+	};
+
 	bool				MountInternal( Path otherGameDirectory, bool mountOthers, bool mountingMainGame, bool mountingEngine );
+	// Discovers all dependencies in parallel, then mounts them in the order they're listed
+	void				MountDependencies( const GameMetadata& metadata );
+	// Thread-safe, doesn't modify anything or print anything
+	DiscoveredGame		DiscoverGame( const Path& directory, bool mountingEngine ) const;
+	// Prints what was discovered and adds it to the mounted games and packs
+	bool				CommitGame( DiscoveredGame& game, bool mountingMainGame, bool mountingEngine );
+	bool				IsMounted( const Path& gameDirectory ) const;
 	bool				ExistsInternal( Path path, const uint8_t& filterFlags ) const;
+	// Looks in each mounted directory on disk, in priority order, ignoring the index and packs
+	// Case-sensitive regardless of fs_caseInsensitive
+	Optional<Path>		FindLooseFile( const Path& destination, const uint8_t& filterFlags, bool noMountedDirectories ) const;
+	// Opens the .btxpack files at the root of a mounted directory
+	static void			DiscoverPacks( const Path& directory, DiscoveredGame& game );
+	// Resolves like GetPathTo, but also finds out which pack entry it is
+	Optional<ResolvedFile> ResolveFile( const Path& path, bool noMountedDirectories ) const;
+	FileView			ReadResolvedFile( const ResolvedFile& file ) const;
+	// ReadResolvedFile through the content cache, see fs_contentCache
+	FileView			ReadSharedFile( const ResolvedFile& file ) const;
+	// Reads a file outside of any pack
+	FileView			ReadLooseFile( const Path& path ) const;
+	FileStamp			GetFileStamp( const ResolvedFile& file ) const;
+	// The content hash index is kept per game, in fs_cacheDirectory
+	Path				GetContentCachePath() const;
+	// Pooled if it's small enough
+	std::shared_ptr<uint8_t> AllocateBuffer( size_t size ) const;
+	// Called whenever the set of mounted directories changes
+	void				RebuildIndex();
+	// Watches mounted games that aren't watched yet
+	void				WatchMountedDirectories();
+	// Dispatches changes once files have stopped changing for fs_hotReloadDelay
+	void				UpdateHotReload();
+	void				RunIndexBenchmark( uint32_t numLookups );
 
 private:
 	Path				enginePath;
@@ -41,6 +167,56 @@ private:
 	GameMetadata		gameMetadata;
 	Vector<GameMetadata> otherMetadatas;
 
+	struct MountedPack
+	{
+		// The mounted directory this pack was found in
+		Path			directory;
+		std::shared_ptr<PackFile> pack;
+	};
+
+	// Sorted by name within each directory
+	Vector<MountedPack>	packs;
+
+	// Current game, other paths, then the engine, all prefixed with basePath
+	// Each directory is followed by its packs, so loose files override packed ones
+	Vector<FileIndex::Mount> mounts;
+	// The current game's directory and its packs come first
+	uint16_t			numCurrentGameMounts{ 0U };
+	FileIndex			fileIndex;
+	// fs_caseInsensitive, fixed at startup since the index depends on it
+	bool				caseInsensitive{ false };
+	// Cleared whenever the index is rebuilt: on mount and on hot reload
+	// Entries also expire after fs_negativeCacheLifetime
+	mutable NegativeLookupCache negativeLookups;
+
+	// Shared with FileViews, which may outlive the filesystem
+	std::shared_ptr<FileBufferPool> bufferPool{ std::make_shared<FileBufferPool>() };
+	AsyncFileQueue		asyncQueue;
+	struct WatchSubscription
+	{
+		FileWatchId		id{ 0U };
+		// Normalised, see FileIndex::Normalise
+		String			path;
+		FileChangeCallback callback;
+	};
+
+	// Only exists with fs_hotReload
+	UniquePtr<FileWatcher> fileWatcher;
+	size_t				numWatchedDirectories{ 0U };
+	// Absolute path -> when it last changed, editors tend to
+	// write a file in several steps, so changes are coalesced
+	std::unordered_map<String, chrono::steady_clock::time_point> pendingChanges;
+	Vector<Path>		polledChanges;
+	Vector<WatchSubscription> watchSubscriptions;
+	FileWatchId			nextWatchId{ 1U };
+
+	// Internally synchronised, ReadFile is const and thread-safe
+	mutable ContentCache contentCache;
+	static constexpr const char* ContentCacheFileName = "contentHashes.bin";
+
+	DeferredRequest<uint32_t> indexBenchmarkRequest;
+
 	ICore*				core{ nullptr };
 	IConsole*			console{ nullptr };
+	JobSystem*			jobSystem{ nullptr };
 };
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "FileView.hpp"
+
+// ============================
+// FileBufferPool::Acquire
+// ============================
+std::shared_ptr<uint8_t> FileBufferPool::Acquire( size_t size )
+{
+	if ( size > MaxBufferSize )
+	{
+		return nullptr;
+	}
+
+	const size_t sizeClass = GetSizeClass( size );
+	UniquePtr<uint8_t[]> buffer;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if ( !freeBuffers[sizeClass].empty() )
+		{
+			buffer = std::move( freeBuffers[sizeClass].back() );
+			freeBuffers[sizeClass].pop_back();
+		}
+	}
+
+	if ( nullptr == buffer )
+	{
+		buffer.reset( new uint8_t[MinBufferSize << sizeClass] );
+	}
+
+	// Views may outlive the filesystem, so they keep the pool alive too
+	return std::shared_ptr<uint8_t>( buffer.release(), [pool = shared_from_this(), sizeClass]( uint8_t* released )
+		{
+			pool->Release( released, sizeClass );
+		} );
+}
+
+// ============================
+// FileBufferPool::GetSizeClass
+// ============================
+size_t FileBufferPool::GetSizeClass( size_t size )
+{
+	size_t sizeClass = 0U;
+	while ( (MinBufferSize << sizeClass) < size )
+	{
+		sizeClass++;
+	}
+
+	return sizeClass;
+}
+
+// ============================
+// FileBufferPool::Release
+// ============================
+void FileBufferPool::Release( uint8_t* buffer, size_t sizeClass )
+{
+	UniquePtr<uint8_t[]> ownedBuffer( buffer );
+
+	std::lock_guard<std::mutex> lock( mutex );
+	if ( freeBuffers[sizeClass].size() < MaxFreeBuffers )
+	{
+		freeBuffers[sizeClass].push_back( std::move( ownedBuffer ) );
+	}
+}
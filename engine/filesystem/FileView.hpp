@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// FileView
+//
+// Read-only contents of a whole file, see FileSystem::ReadFile
+// Copies share the same memory, which stays valid until the last
+// copy is gone, even if the filesystem is shut down in the meantime
+// ============================
+class FileView final
+{
+public:
+	FileView() = default;
+	FileView( std::shared_ptr<const void> owner, const uint8_t* data, size_t size )
+		: owner( std::move( owner ) ), data( data ), size( size )
+	{
+	}
+
+	const uint8_t*		GetData() const
+	{
+		return data;
+	}
+
+	size_t				GetSize() const
+	{
+		return size;
+	}
+
+	// For text formats, no null terminator is guaranteed
+	StringView			GetString() const
+	{
+		return StringView( reinterpret_cast<const char*>( data ), size );
+	}
+
+	const std::shared_ptr<const void>& GetOwner() const
+	{
+		return owner;
+	}
+
+	bool				IsValid() const
+	{
+		return nullptr != owner;
+	}
+
+	explicit operator bool() const
+	{
+		return IsValid();
+	}
+
+private:
+	// Keeps the mapping or buffer alive
+	std::shared_ptr<const void> owner;
+	const uint8_t*		data{ nullptr };
+	size_t				size{ 0U };
+};
+
+// ============================
+// FileBufferPool
+//
+// Recycles buffers for small file reads, so reading lots of small
+// files doesn't hit the allocator for every one of them
+// Buffers come in power-of-two size classes, and go back into
+// the pool once the last FileView using them is gone
+// ============================
+class FileBufferPool final : public std::enable_shared_from_this<FileBufferPool>
+{
+public:
+	static constexpr size_t MinBufferSize = 4U * 1024U;
+	static constexpr size_t MaxBufferSize = 1024U * 1024U;
+	// Per size class, anything above that is freed
+	static constexpr size_t MaxFreeBuffers = 32U;
+
+	// Returns nullptr if size is above MaxBufferSize
+	std::shared_ptr<uint8_t> Acquire( size_t size );
+
+private:
+	static size_t		GetSizeClass( size_t size );
+	void				Release( uint8_t* buffer, size_t sizeClass );
+
+private:
+	static constexpr size_t NumSizeClasses = 9U; // 4K .. 1M
+
+	std::mutex			mutex;
+	Vector<UniquePtr<uint8_t[]>> freeBuffers[NumSizeClasses];
+};
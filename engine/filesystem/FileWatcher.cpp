@@ -0,0 +1,177 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "FileWatcher.hpp"
+
+#if ADM_PLATFORM == PLATFORM_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Metadata-only changes (IN_ATTRIB) and reads are of no interest
+constexpr uint32_t WatchedEvents = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+// ============================
+// FileWatcher::dtor
+// ============================
+FileWatcher::~FileWatcher()
+{
+	if ( fileDescriptor >= 0 )
+	{
+		close( fileDescriptor );
+	}
+}
+
+// ============================
+// FileWatcher::Init
+// ============================
+bool FileWatcher::Init()
+{
+	fileDescriptor = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	return fileDescriptor >= 0;
+}
+
+// ============================
+// FileWatcher::WatchDirectory
+// ============================
+bool FileWatcher::WatchDirectory( const Path& directory )
+{
+	std::error_code error;
+	if ( fileDescriptor < 0 || !fs::is_directory( directory, error ) )
+	{
+		return false;
+	}
+
+	AddWatch( directory );
+	return true;
+}
+
+// ============================
+// FileWatcher::Poll
+// ============================
+void FileWatcher::Poll( Vector<Path>& outChangedPaths )
+{
+	if ( fileDescriptor < 0 )
+	{
+		return;
+	}
+
+	alignas( inotify_event ) char buffer[16U * 1024U];
+	while ( true )
+	{
+		const ssize_t bytesRead = read( fileDescriptor, buffer, sizeof( buffer ) );
+		if ( bytesRead <= 0 )
+		{
+			// EAGAIN, nothing left
+			return;
+		}
+
+		for ( ssize_t offset = 0; offset < bytesRead; )
+		{
+			const auto* event = reinterpret_cast<const inotify_event*>( buffer + offset );
+			offset += sizeof( inotify_event ) + event->len;
+
+			// The kernel dropped events, so anything could've changed
+			if ( event->mask & IN_Q_OVERFLOW )
+			{
+				for ( const auto& [watchDescriptor, directory] : watches )
+				{
+					outChangedPaths.push_back( directory );
+				}
+				continue;
+			}
+
+			// The directory is gone, or was unwatched
+			if ( event->mask & IN_IGNORED )
+			{
+				RemoveWatch( event->wd );
+				continue;
+			}
+
+			const auto iterator = watches.find( event->wd );
+			if ( iterator == watches.end() )
+			{
+				continue;
+			}
+
+			Path changedPath = event->len > 0U ? iterator->second/event->name : iterator->second;
+			if ( (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)) )
+			{
+				AddWatch( changedPath );
+			}
+
+			outChangedPaths.push_back( std::move( changedPath ) );
+		}
+	}
+}
+
+// ============================
+// FileWatcher::AddWatch
+// ============================
+void FileWatcher::AddWatch( const Path& directory )
+{
+	// inotify isn't recursive, every subdirectory needs its own watch
+	const auto addSingleWatch = [this]( const Path& path )
+	{
+		const int watchDescriptor = inotify_add_watch( fileDescriptor, path.c_str(), WatchedEvents );
+		if ( watchDescriptor >= 0 )
+		{
+			watches[watchDescriptor] = path;
+		}
+	};
+
+	addSingleWatch( directory );
+
+	std::error_code error;
+	const auto options = fs::directory_options::skip_permission_denied;
+	for ( auto iterator = fs::recursive_directory_iterator( directory, options, error ); iterator != fs::recursive_directory_iterator(); iterator.increment( error ) )
+	{
+		if ( error )
+		{
+			break;
+		}
+
+		if ( iterator->is_directory( error ) && !iterator->is_symlink( error ) )
+		{
+			addSingleWatch( iterator->path() );
+		}
+	}
+}
+
+// ============================
+// FileWatcher::RemoveWatch
+// ============================
+void FileWatcher::RemoveWatch( int watchDescriptor )
+{
+	watches.erase( watchDescriptor );
+}
+
+#else
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::Init()
+{
+	return false;
+}
+
+bool FileWatcher::WatchDirectory( const Path& directory )
+{
+	return false;
+}
+
+void FileWatcher::Poll( Vector<Path>& outChangedPaths )
+{
+}
+
+void FileWatcher::AddWatch( const Path& directory )
+{
+}
+
+void FileWatcher::RemoveWatch( int watchDescriptor )
+{
+}
+
+#endif
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// FileWatcher
+//
+// Notices files being written, created, deleted and renamed
+// under a set of directories, including their subdirectories
+// Polled, so it never blocks and needs no thread of its own
+//
+// Uses inotify, Init fails on other platforms
+// ============================
+class FileWatcher final
+{
+public:
+	FileWatcher() = default;
+	~FileWatcher();
+
+	FileWatcher( const FileWatcher& ) = delete;
+	FileWatcher& operator=( const FileWatcher& ) = delete;
+
+	bool				Init();
+
+	// Subdirectories created later are watched too
+	bool				WatchDirectory( const Path& directory );
+
+	// Appends the paths that changed since the last poll, may contain duplicates
+	void				Poll( Vector<Path>& outChangedPaths );
+
+private:
+	void				AddWatch( const Path& directory );
+	void				RemoveWatch( int watchDescriptor );
+
+private:
+	int					fileDescriptor{ -1 };
+	// Watch descriptor -> watched directory
+	std::unordered_map<int, Path> watches;
+};
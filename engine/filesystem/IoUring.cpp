@@ -0,0 +1,258 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "IoUring.hpp"
+
+#if ADM_PLATFORM == PLATFORM_LINUX
+#include <cerrno>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ============================
+// IoUring::dtor
+// ============================
+IoUring::~IoUring()
+{
+	if ( nullptr != submissionEntries )
+	{
+		munmap( submissionEntries, submissionEntriesSize );
+	}
+
+	if ( nullptr != completionRing && completionRing != submissionRing )
+	{
+		munmap( completionRing, completionRingSize );
+	}
+
+	if ( nullptr != submissionRing )
+	{
+		munmap( submissionRing, submissionRingSize );
+	}
+
+	if ( ringFileDescriptor >= 0 )
+	{
+		close( ringFileDescriptor );
+	}
+}
+
+// ============================
+// IoUring::Init
+// ============================
+bool IoUring::Init( uint32_t depth )
+{
+	io_uring_params params{};
+	ringFileDescriptor = static_cast<int>( syscall( __NR_io_uring_setup, depth, &params ) );
+	if ( ringFileDescriptor < 0 )
+	{
+		return false;
+	}
+
+	submissionRingSize = params.sq_off.array + params.sq_entries * sizeof( uint32_t );
+	completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+
+	// Newer kernels put both rings into one mapping
+	const bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+	if ( singleMapping )
+	{
+		submissionRingSize = std::max( submissionRingSize, completionRingSize );
+		completionRingSize = submissionRingSize;
+	}
+
+	submissionRing = mmap( nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFileDescriptor, IORING_OFF_SQ_RING );
+	if ( submissionRing == MAP_FAILED )
+	{
+		submissionRing = nullptr;
+		return false;
+	}
+
+	if ( singleMapping )
+	{
+		completionRing = submissionRing;
+	}
+	else
+	{
+		completionRing = mmap( nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFileDescriptor, IORING_OFF_CQ_RING );
+		if ( completionRing == MAP_FAILED )
+		{
+			completionRing = nullptr;
+			return false;
+		}
+	}
+
+	submissionEntriesSize = params.sq_entries * sizeof( io_uring_sqe );
+	submissionEntries = mmap( nullptr, submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFileDescriptor, IORING_OFF_SQES );
+	if ( submissionEntries == MAP_FAILED )
+	{
+		submissionEntries = nullptr;
+		return false;
+	}
+
+	uint8_t* submissionBase = static_cast<uint8_t*>( submissionRing );
+	submissionHead = reinterpret_cast<uint32_t*>( submissionBase + params.sq_off.head );
+	submissionTail = reinterpret_cast<uint32_t*>( submissionBase + params.sq_off.tail );
+	submissionArray = reinterpret_cast<uint32_t*>( submissionBase + params.sq_off.array );
+	submissionMask = *reinterpret_cast<uint32_t*>( submissionBase + params.sq_off.ring_mask );
+	numSubmissionEntries = params.sq_entries;
+
+	uint8_t* completionBase = static_cast<uint8_t*>( completionRing );
+	completionHead = reinterpret_cast<uint32_t*>( completionBase + params.cq_off.head );
+	completionTail = reinterpret_cast<uint32_t*>( completionBase + params.cq_off.tail );
+	completionMask = *reinterpret_cast<uint32_t*>( completionBase + params.cq_off.ring_mask );
+	completionEntries = completionBase + params.cq_off.cqes;
+
+	// IORING_OP_READ came in 5.6, older kernels fail the probe itself
+	// Same thing if it's been disabled, e.g. by a seccomp or LSM policy
+	constexpr uint32_t NumProbedOps = 256U;
+	Vector<uint8_t> probeMemory( sizeof( io_uring_probe ) + NumProbedOps * sizeof( io_uring_probe_op ) );
+	io_uring_probe* probe = reinterpret_cast<io_uring_probe*>( probeMemory.data() );
+	if ( syscall( __NR_io_uring_register, ringFileDescriptor, IORING_REGISTER_PROBE, probe, NumProbedOps ) < 0
+		|| probe->last_op < IORING_OP_READ
+		|| !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// ============================
+// IoUring::PrepareRead
+// ============================
+bool IoUring::PrepareRead( int fileDescriptor, void* buffer, uint32_t size, uint64_t offset, uint64_t userData )
+{
+	// This thread is the only producer, the kernel only moves the head
+	const uint32_t tail = *submissionTail;
+	const uint32_t head = __atomic_load_n( submissionHead, __ATOMIC_ACQUIRE );
+	if ( tail - head >= numSubmissionEntries )
+	{
+		return false;
+	}
+
+	const uint32_t index = tail & submissionMask;
+	io_uring_sqe& entry = static_cast<io_uring_sqe*>( submissionEntries )[index];
+	std::memset( &entry, 0, sizeof( entry ) );
+	entry.opcode = IORING_OP_READ;
+	entry.fd = fileDescriptor;
+	entry.addr = reinterpret_cast<uint64_t>( buffer );
+	entry.len = size;
+	entry.off = offset;
+	entry.user_data = userData;
+
+	submissionArray[index] = index;
+	__atomic_store_n( submissionTail, tail + 1U, __ATOMIC_RELEASE );
+	numPendingSubmissions++;
+	return true;
+}
+
+// ============================
+// IoUring::SubmitAndWait
+// ============================
+bool IoUring::SubmitAndWait()
+{
+	while ( true )
+	{
+		const int result = static_cast<int>( syscall( __NR_io_uring_enter, ringFileDescriptor, numPendingSubmissions, 1U, IORING_ENTER_GETEVENTS, nullptr, 0 ) );
+		if ( result >= 0 )
+		{
+			const uint32_t numSubmitted = std::min<uint32_t>( result, numPendingSubmissions );
+			numPendingSubmissions -= numSubmitted;
+			numInFlight += numSubmitted;
+			return true;
+		}
+
+		if ( errno != EINTR )
+		{
+			return false;
+		}
+	}
+}
+
+// ============================
+// IoUring::PopCompletion
+// ============================
+bool IoUring::PopCompletion( uint64_t& outUserData, int& outResult )
+{
+	// This thread is the only consumer, the kernel only moves the tail
+	const uint32_t head = *completionHead;
+	if ( head == __atomic_load_n( completionTail, __ATOMIC_ACQUIRE ) )
+	{
+		return false;
+	}
+
+	const io_uring_cqe& entry = static_cast<io_uring_cqe*>( completionEntries )[head & completionMask];
+	outUserData = entry.user_data;
+	outResult = entry.res;
+
+	__atomic_store_n( completionHead, head + 1U, __ATOMIC_RELEASE );
+	numInFlight -= std::min( numInFlight, 1U );
+	return true;
+}
+
+// ============================
+// IoUring::DiscardPrepared
+// ============================
+void IoUring::DiscardPrepared()
+{
+	// Without SQPOLL, the kernel only looks at the ring during io_uring_enter, so
+	// whatever it hasn't consumed yet can be taken back by moving the tail back
+	const uint32_t head = __atomic_load_n( submissionHead, __ATOMIC_ACQUIRE );
+	__atomic_store_n( submissionTail, head, __ATOMIC_RELEASE );
+	numPendingSubmissions = 0U;
+}
+
+// ============================
+// IoUring::WaitForCompletions
+// ============================
+bool IoUring::WaitForCompletions()
+{
+	while ( true )
+	{
+		const int result = static_cast<int>( syscall( __NR_io_uring_enter, ringFileDescriptor, 0U, 1U, IORING_ENTER_GETEVENTS, nullptr, 0 ) );
+		if ( result >= 0 )
+		{
+			return true;
+		}
+
+		if ( errno != EINTR )
+		{
+			return false;
+		}
+	}
+}
+
+#else
+
+IoUring::~IoUring() = default;
+
+bool IoUring::Init( uint32_t depth )
+{
+	return false;
+}
+
+bool IoUring::PrepareRead( int fileDescriptor, void* buffer, uint32_t size, uint64_t offset, uint64_t userData )
+{
+	return false;
+}
+
+bool IoUring::SubmitAndWait()
+{
+	return false;
+}
+
+bool IoUring::PopCompletion( uint64_t& outUserData, int& outResult )
+{
+	return false;
+}
+
+void IoUring::DiscardPrepared()
+{
+}
+
+bool IoUring::WaitForCompletions()
+{
+	return false;
+}
+
+#endif
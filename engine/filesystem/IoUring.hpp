@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// IoUring
+//
+// Bare-bones io_uring, straight on top of the syscalls so there's
+// no liburing dependency. Only does what AsyncFileQueue needs:
+// reads from file descriptors, from a single thread
+//
+// Needs Linux 5.6 or newer, Init fails everywhere else,
+// or if IORING_OP_READ isn't allowed
+// ============================
+class IoUring final
+{
+public:
+	~IoUring();
+
+	bool				Init( uint32_t depth );
+
+	// Returns false if the submission queue is full
+	bool				PrepareRead( int fileDescriptor, void* buffer, uint32_t size, uint64_t offset, uint64_t userData );
+	// Submits everything that was prepared and waits for at least one completion
+	bool				SubmitAndWait();
+	// Returns false once there are no completions left
+	// result is the number of bytes read, or a negated errno
+	bool				PopCompletion( uint64_t& outUserData, int& outResult );
+
+	// After a failed SubmitAndWait: takes back the reads the kernel hasn't picked up
+	void				DiscardPrepared();
+	// Waits for at least one completion without submitting anything
+	bool				WaitForCompletions();
+	// Submitted reads whose completions haven't been popped yet
+	// Their buffers must stay alive until this drops to 0
+	uint32_t			GetNumInFlight() const
+	{
+		return numInFlight;
+	}
+
+private:
+	int					ringFileDescriptor{ -1 };
+	uint32_t			numPendingSubmissions{ 0U };
+	uint32_t			numInFlight{ 0U };
+
+	// Shared with the kernel
+	void*				submissionRing{ nullptr };
+	size_t				submissionRingSize{ 0U };
+	void*				completionRing{ nullptr };
+	size_t				completionRingSize{ 0U };
+	void*				submissionEntries{ nullptr };
+	size_t				submissionEntriesSize{ 0U };
+
+	uint32_t*			submissionHead{ nullptr };
+	uint32_t*			submissionTail{ nullptr };
+	uint32_t*			submissionArray{ nullptr };
+	uint32_t			submissionMask{ 0U };
+	uint32_t			numSubmissionEntries{ 0U };
+
+	uint32_t*			completionHead{ nullptr };
+	uint32_t*			completionTail{ nullptr };
+	uint32_t			completionMask{ 0U };
+	void*				completionEntries{ nullptr };
+};
@@ -0,0 +1,231 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// This header is shared with tools/PackBuilder, which doesn't
+// link against anything, so it sticks to the standard library
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// ============================
+// LZ4 block format
+//
+// Compatible with the reference implementation's raw blocks
+// (no frame format), which is all the pack format needs
+// The compressor is a plain greedy one: it's only used offline,
+// and the output decompresses just as fast as the reference's
+// ============================
+namespace Lz4
+{
+	constexpr size_t MinMatch = 4U;
+	// The format requires the last 5 bytes to be literals, and
+	// the last match to start at least 12 bytes before the end
+	constexpr size_t LastLiterals = 5U;
+	constexpr size_t MatchFindLimit = 12U;
+	constexpr size_t MaxOffset = 65535U;
+	constexpr uint32_t HashBits = 12U;
+
+	inline size_t CompressBound( size_t size )
+	{
+		return size + size / 255U + 16U;
+	}
+
+	inline uint32_t Read32( const uint8_t* data )
+	{
+		uint32_t value;
+		std::memcpy( &value, data, sizeof( value ) );
+		return value;
+	}
+
+	inline uint32_t Hash( uint32_t sequence )
+	{
+		return (sequence * 2654435761U) >> (32U - HashBits);
+	}
+
+	inline void WriteLength( uint8_t*& output, size_t length )
+	{
+		while ( length >= 255U )
+		{
+			*output++ = 255U;
+			length -= 255U;
+		}
+		*output++ = static_cast<uint8_t>( length );
+	}
+
+	inline void WriteLiterals( uint8_t*& output, uint8_t*& token, const uint8_t* literals, size_t length )
+	{
+		token = output++;
+		*token = static_cast<uint8_t>( std::min<size_t>( length, 15U ) << 4U );
+		if ( length >= 15U )
+		{
+			WriteLength( output, length - 15U );
+		}
+
+		if ( length > 0U )
+		{
+			std::memcpy( output, literals, length );
+			output += length;
+		}
+	}
+
+	// Returns the compressed size, or 0 if outputCapacity is below CompressBound
+	inline size_t Compress( const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity )
+	{
+		if ( outputCapacity < CompressBound( inputSize ) )
+		{
+			return 0U;
+		}
+
+		uint32_t table[1U << HashBits] = {};
+		const uint8_t* const end = input + inputSize;
+		const uint8_t* current = input;
+		const uint8_t* anchor = input;
+		uint8_t* out = output;
+		uint8_t* token = nullptr;
+
+		if ( inputSize > MatchFindLimit )
+		{
+			const uint8_t* const matchStartLimit = end - MatchFindLimit;
+			const uint8_t* const matchEndLimit = end - LastLiterals;
+
+			while ( current < matchStartLimit )
+			{
+				const uint32_t sequence = Read32( current );
+				const uint32_t hash = Hash( sequence );
+				const uint8_t* reference = input + table[hash];
+				table[hash] = static_cast<uint32_t>( current - input );
+
+				if ( reference >= current || size_t( current - reference ) > MaxOffset || Read32( reference ) != sequence )
+				{
+					current++;
+					continue;
+				}
+
+				const uint8_t* matchEnd = current + MinMatch;
+				const uint8_t* referenceEnd = reference + MinMatch;
+				while ( matchEnd < matchEndLimit && *matchEnd == *referenceEnd )
+				{
+					matchEnd++;
+					referenceEnd++;
+				}
+
+				WriteLiterals( out, token, anchor, current - anchor );
+
+				const size_t offset = current - reference;
+				*out++ = static_cast<uint8_t>( offset & 0xFFU );
+				*out++ = static_cast<uint8_t>( offset >> 8U );
+
+				const size_t matchLength = (matchEnd - current) - MinMatch;
+				*token |= static_cast<uint8_t>( std::min<size_t>( matchLength, 15U ) );
+				if ( matchLength >= 15U )
+				{
+					WriteLength( out, matchLength - 15U );
+				}
+
+				current = matchEnd;
+				anchor = current;
+			}
+		}
+
+		// The last sequence is literals only
+		WriteLiterals( out, token, anchor, end - anchor );
+		return out - output;
+	}
+
+	// Returns false if the input is damaged, or doesn't decompress to exactly outputSize bytes
+	inline bool Decompress( const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize )
+	{
+		const uint8_t* in = input;
+		const uint8_t* const inputEnd = input + inputSize;
+		uint8_t* out = output;
+		uint8_t* const outputEnd = output + outputSize;
+
+		const auto readLength = [&]( size_t& length )
+		{
+			if ( length != 15U )
+			{
+				return true;
+			}
+
+			uint8_t byte;
+			do
+			{
+				if ( in >= inputEnd )
+				{
+					return false;
+				}
+				byte = *in++;
+				length += byte;
+			} while ( byte == 255U );
+
+			return true;
+		};
+
+		while ( in < inputEnd )
+		{
+			const uint8_t token = *in++;
+
+			size_t literalLength = token >> 4U;
+			if ( !readLength( literalLength ) || literalLength > size_t( inputEnd - in ) || literalLength > size_t( outputEnd - out ) )
+			{
+				return false;
+			}
+
+			if ( literalLength > 0U )
+			{
+				std::memcpy( out, in, literalLength );
+				out += literalLength;
+				in += literalLength;
+			}
+
+			// The last sequence has no match
+			if ( in == inputEnd )
+			{
+				break;
+			}
+
+			if ( inputEnd - in < 2 )
+			{
+				return false;
+			}
+
+			const size_t offset = size_t( in[0] ) | (size_t( in[1] ) << 8U);
+			in += 2;
+			if ( offset == 0U || offset > size_t( out - output ) )
+			{
+				return false;
+			}
+
+			size_t matchLength = token & 15U;
+			if ( !readLength( matchLength ) )
+			{
+				return false;
+			}
+
+			matchLength += MinMatch;
+			if ( matchLength > size_t( outputEnd - out ) )
+			{
+				return false;
+			}
+
+			// Overlapping matches repeat the last few bytes, so they go byte by byte
+			const uint8_t* match = out - offset;
+			if ( offset >= matchLength )
+			{
+				std::memcpy( out, match, matchLength );
+			}
+			else
+			{
+				for ( size_t i = 0U; i < matchLength; i++ )
+				{
+					out[i] = match[i];
+				}
+			}
+			out += matchLength;
+		}
+
+		return out == outputEnd;
+	}
+}
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "MappedFile.hpp"
+
+#if ADM_PLATFORM == PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ============================
+// MappedFile::dtor
+// ============================
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+// ============================
+// MappedFile::Open
+// ============================
+bool MappedFile::Open( const Path& path )
+{
+	Close();
+
+#if ADM_PLATFORM == PLATFORM_WINDOWS
+	HANDLE file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( file == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( nullptr == mapping )
+	{
+		CloseHandle( file );
+		return false;
+	}
+
+	void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( nullptr == view )
+	{
+		CloseHandle( mapping );
+		CloseHandle( file );
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const uint8_t*>( view );
+	size = static_cast<size_t>( fileSize.QuadPart );
+#else
+	const int file = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( file < 0 )
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if ( fstat( file, &fileStat ) != 0 || fileStat.st_size <= 0 )
+	{
+		close( file );
+		return false;
+	}
+
+	void* view = mmap( nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+	// The mapping keeps its own reference to the file
+	close( file );
+
+	if ( view == MAP_FAILED )
+	{
+		return false;
+	}
+
+	data = static_cast<const uint8_t*>( view );
+	size = static_cast<size_t>( fileStat.st_size );
+#endif
+
+	return true;
+}
+
+// ============================
+// MappedFile::Close
+// ============================
+void MappedFile::Close()
+{
+	if ( nullptr == data )
+	{
+		return;
+	}
+
+#if ADM_PLATFORM == PLATFORM_WINDOWS
+	UnmapViewOfFile( data );
+	CloseHandle( mappingHandle );
+	CloseHandle( fileHandle );
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap( const_cast<uint8_t*>( data ), size );
+#endif
+
+	data = nullptr;
+	size = 0U;
+}
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// MappedFile
+//
+// Read-only memory mapping of a whole file
+// The OS pages it in on demand, so mapping a large file is cheap
+// until its contents are actually touched
+// ============================
+class MappedFile final
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	bool				Open( const Path& path );
+	void				Close();
+
+	bool				IsOpen() const
+	{
+		return nullptr != data;
+	}
+
+	const uint8_t*		GetData() const
+	{
+		return data;
+	}
+
+	size_t				GetSize() const
+	{
+		return size;
+	}
+
+private:
+	const uint8_t*		data{ nullptr };
+	size_t				size{ 0U };
+#if ADM_PLATFORM == PLATFORM_WINDOWS
+	void*				fileHandle{ nullptr };
+	void*				mappingHandle{ nullptr };
+#endif
+};
@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "NegativeLookupCache.hpp"
+
+// ============================
+// NegativeLookupCache::MakeKey
+// ============================
+String NegativeLookupCache::MakeKey( const String& normalisedPath, uint8_t filterFlags, bool noMountedDirectories )
+{
+	// Paths can't contain null characters, so the suffix can't clash with one
+	String key;
+	key.reserve( normalisedPath.size() + 3U );
+	key += normalisedPath;
+	key += '\0';
+	key += static_cast<char>( filterFlags );
+	key += noMountedDirectories ? '1' : '0';
+	return key;
+}
+
+// ============================
+// NegativeLookupCache::Contains
+// ============================
+bool NegativeLookupCache::Contains( const String& key, chrono::milliseconds lifetime )
+{
+	bool contains;
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		ExpireEntries( chrono::steady_clock::now() - lifetime );
+		contains = entries.count( key ) > 0U;
+	}
+
+	(contains ? numHits : numMisses).fetch_add( 1U, std::memory_order_relaxed );
+	return contains;
+}
+
+// ============================
+// NegativeLookupCache::Add
+// ============================
+void NegativeLookupCache::Add( String key, size_t capacity )
+{
+	if ( 0U == capacity )
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( mutex );
+	if ( !entries.insert( key ).second )
+	{
+		return;
+	}
+
+	insertionOrder.push_back( { std::move( key ), chrono::steady_clock::now() } );
+	while ( insertionOrder.size() > capacity )
+	{
+		entries.erase( insertionOrder.front().key );
+		insertionOrder.pop_front();
+	}
+}
+
+// ============================
+// NegativeLookupCache::Clear
+// ============================
+void NegativeLookupCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	entries.clear();
+	insertionOrder.clear();
+}
+
+// ============================
+// NegativeLookupCache::ExpireEntries
+// ============================
+void NegativeLookupCache::ExpireEntries( chrono::steady_clock::time_point cutoff )
+{
+	// Insertion order is also time order, so expired entries are all at the front
+	while ( !insertionOrder.empty() && insertionOrder.front().time < cutoff )
+	{
+		entries.erase( insertionOrder.front().key );
+		insertionOrder.pop_front();
+	}
+}
+
+// ============================
+// NegativeLookupCache::GetNumEntries
+// ============================
+size_t NegativeLookupCache::GetNumEntries() const
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	return entries.size();
+}
@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <deque>
+#include <unordered_set>
+
+// ============================
+// NegativeLookupCache
+//
+// Remembers paths that didn't resolve to anything, so probing for
+// optional files (per-map overrides, localised variants etc.) that
+// usually don't exist doesn't stat the disk every time
+//
+// Bounded, the oldest entries are evicted first. Files can appear
+// without anything telling the engine, so entries also expire after
+// a while, and the cache should be cleared whenever the index changes
+// All methods are thread-safe
+// ============================
+class NegativeLookupCache final
+{
+public:
+	// Identifies a lookup, the same path can exist as a file but not as a directory etc.
+	static String		MakeKey( const String& normalisedPath, uint8_t filterFlags, bool noMountedDirectories );
+
+	// Counts a hit or a miss, entries older than lifetime are forgotten
+	bool				Contains( const String& key, chrono::milliseconds lifetime );
+	// Does nothing if capacity is 0
+	void				Add( String key, size_t capacity );
+	void				Clear();
+
+	size_t				GetNumHits() const
+	{
+		return numHits.load( std::memory_order_relaxed );
+	}
+
+	size_t				GetNumMisses() const
+	{
+		return numMisses.load( std::memory_order_relaxed );
+	}
+
+	size_t				GetNumEntries() const;
+
+private:
+	struct Insertion
+	{
+		String			key;
+		chrono::steady_clock::time_point time;
+	};
+
+	// Forgets everything added before cutoff, the mutex must be held
+	void				ExpireEntries( chrono::steady_clock::time_point cutoff );
+
+private:
+	mutable std::mutex	mutex;
+	std::unordered_set<String> entries;
+	// Oldest first
+	std::deque<Insertion> insertionOrder;
+
+	std::atomic<size_t>	numHits{ 0U };
+	std::atomic<size_t>	numMisses{ 0U };
+};
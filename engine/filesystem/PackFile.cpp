@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "PackFile.hpp"
+#include "../jobsystem/JobSystem.hpp"
+
+// ============================
+// PackFile::Open
+// ============================
+bool PackFile::Open( const Path& packPath )
+{
+	if ( !mapping.Open( packPath ) )
+	{
+		return false;
+	}
+
+	const BtxPack::Header* header = BtxPack::ReadHeader( mapping.GetData(), mapping.GetSize() );
+	if ( nullptr == header )
+	{
+		mapping.Close();
+		return false;
+	}
+
+	// Entries are checked once here, so lookups don't have to
+	const auto* packEntries = reinterpret_cast<const BtxPack::Entry*>( mapping.GetData() + header->tocOffset );
+	for ( uint32_t i = 0U; i < header->numEntries; i++ )
+	{
+		if ( !BtxPack::ValidateEntry( *header, packEntries[i], mapping.GetData(), mapping.GetSize() ) )
+		{
+			mapping.Close();
+			return false;
+		}
+	}
+
+	std::error_code error;
+	path = packPath;
+	modifiedTime = std::filesystem::last_write_time( packPath, error ).time_since_epoch().count();
+	numEntries = header->numEntries;
+	blockSize = header->blockSize;
+	entries = packEntries;
+	strings = reinterpret_cast<const char*>( mapping.GetData() + header->stringTableOffset );
+	return true;
+}
+
+// ============================
+// PackFile::ReadEntry
+// ============================
+bool PackFile::ReadEntry( uint32_t index, uint64_t offset, uint64_t size, uint8_t* output, JobSystem* jobSystem ) const
+{
+	const BtxPack::Entry& entry = entries[index];
+	if ( offset > entry.size || size > entry.size - offset )
+	{
+		return false;
+	}
+
+	if ( 0U == size )
+	{
+		return true;
+	}
+
+	const uint8_t* data = GetEntryData( index );
+	if ( entry.compression == BtxPack::CompressionNone )
+	{
+		std::memcpy( output, data + offset, size );
+		return true;
+	}
+
+	const uint64_t firstBlock = offset / blockSize;
+	const uint64_t numBlocks = (offset + size - 1U) / blockSize - firstBlock + 1U;
+	std::atomic<bool> failed{ false };
+
+	const auto decompressBlocks = [&]( size_t begin, size_t end )
+	{
+		if ( failed.load( std::memory_order_relaxed ) )
+		{
+			return;
+		}
+
+		Vector<uint8_t> scratch;
+		if ( !BtxPack::ReadBlocks( entry, blockSize, data, offset, size, firstBlock + begin, firstBlock + end, output, scratch ) )
+		{
+			failed.store( true, std::memory_order_relaxed );
+		}
+	};
+
+	if ( nullptr != jobSystem )
+	{
+		jobSystem->ParallelFor( numBlocks, 1U, decompressBlocks );
+	}
+	else
+	{
+		decompressBlocks( 0U, numBlocks );
+	}
+
+	return !failed.load( std::memory_order_relaxed );
+}
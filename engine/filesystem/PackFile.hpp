@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "MappedFile.hpp"
+#include "PackFormat.hpp"
+
+class JobSystem;
+
+// ============================
+// PackFile
+//
+// A mounted .btxpack, see PackFormat.hpp
+// The whole pack is memory-mapped, so file contents are
+// handed out as pointers into the mapping, without copying
+// FileViews into a pack keep it alive through shared_from_this
+//
+// Compressed files can't be handed out like that, they're
+// decompressed with ReadEntry instead, one block per job
+// ============================
+class PackFile final : public std::enable_shared_from_this<PackFile>
+{
+public:
+	// Fails if the pack is missing, of another version, or damaged
+	bool				Open( const Path& packPath );
+
+	const Path&			GetPath() const
+	{
+		return path;
+	}
+
+	uint32_t			GetNumEntries() const
+	{
+		return numEntries;
+	}
+
+	StringView			GetEntryPath( uint32_t index ) const
+	{
+		return StringView( strings + entries[index].pathOffset, entries[index].pathLength );
+	}
+
+	// Valid for as long as the pack is open
+	// Compressed files start with their block offsets, see IsEntryCompressed
+	const uint8_t*		GetEntryData( uint32_t index ) const
+	{
+		return mapping.GetData() + entries[index].dataOffset;
+	}
+
+	// Uncompressed
+	uint64_t			GetEntrySize( uint32_t index ) const
+	{
+		return entries[index].size;
+	}
+
+	bool				IsEntryCompressed( uint32_t index ) const
+	{
+		return entries[index].compression != BtxPack::CompressionNone;
+	}
+
+	uint32_t			GetBlockSize() const
+	{
+		return blockSize;
+	}
+
+	// Of the pack file, when it was opened
+	int64_t				GetModifiedTime() const
+	{
+		return modifiedTime;
+	}
+
+	// Copies [offset, offset + size) of the file into output, decompressing
+	// only the blocks it overlaps. Blocks are spread across the job system
+	// if there's one, else decompressed on the calling thread
+	// Returns false if the range is out of bounds or a block is damaged
+	bool				ReadEntry( uint32_t index, uint64_t offset, uint64_t size, uint8_t* output, JobSystem* jobSystem ) const;
+
+private:
+	MappedFile			mapping;
+	Path				path;
+
+	uint32_t			numEntries{ 0U };
+	uint32_t			blockSize{ 0U };
+	int64_t				modifiedTime{ 0 };
+	const BtxPack::Entry* entries{ nullptr };
+	const char*			strings{ nullptr };
+};
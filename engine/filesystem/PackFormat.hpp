@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// This header is shared with tools/PackBuilder, which doesn't
+// link against anything, so it sticks to the standard library
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "Lz4.hpp"
+
+// ============================
+// BTX pack format (.btxpack)
+//
+// Baked game content, mounted like a directory but read straight
+// from a memory mapping:
+//   [Header] [file data...] [TOC entries] [path strings]
+//
+// Every file's data starts at a multiple of DataAlignment, so it can
+// be used in place. TOC entries are sorted by path, paths are relative
+// to the pack, use forward slashes and are not null-terminated
+// Directories aren't stored, they're implied by the paths of the files
+//
+// Compressed files are split into blocks of Header::blockSize bytes
+// (the last one may be shorter), compressed independently, so reading
+// a part of a file only decompresses the blocks it overlaps:
+//   [uint32 block offsets, numBlocks + 1] [block data...]
+// Offsets are relative to the file's data, block i spans [offset i, offset i+1)
+// A block whose stored size equals its uncompressed size is stored as is
+//
+// All numbers are little-endian
+// ============================
+namespace BtxPack
+{
+	constexpr char Magic[6] = { 'B', 'T', 'X', 'P', 'A', 'K' };
+	constexpr uint8_t Version = 2U;
+	constexpr uint64_t DataAlignment = 64U;
+	constexpr std::string_view Extension = ".btxpack";
+	constexpr uint32_t DefaultBlockSize = 64U * 1024U;
+
+	enum Compression : uint8_t
+	{
+		CompressionNone = 0,
+		CompressionLz4 = 1
+	};
+
+	struct Header
+	{
+		char			magic[6];
+		uint8_t			version;
+		uint8_t			reserved;
+		uint32_t		numEntries;
+		uint32_t		stringTableSize;
+		uint64_t		tocOffset;
+		uint64_t		stringTableOffset;
+		// Uncompressed size of a block in compressed files
+		uint32_t		blockSize;
+		uint32_t		reserved2;
+	};
+	static_assert( sizeof( Header ) == 40U );
+
+	struct Entry
+	{
+		uint64_t		dataOffset;
+		// Uncompressed
+		uint64_t		size;
+		// Including the block offsets, equal to size if uncompressed
+		uint64_t		storedSize;
+		uint32_t		pathOffset;
+		uint32_t		pathLength;
+		uint8_t			compression;
+		uint8_t			reserved[7];
+	};
+	static_assert( sizeof( Entry ) == 40U );
+
+	inline uint64_t Align( uint64_t offset )
+	{
+		return (offset + DataAlignment - 1U) & ~(DataAlignment - 1U);
+	}
+
+	inline uint64_t GetNumBlocks( uint64_t size, uint32_t blockSize )
+	{
+		// Rounded up without adding to size, which comes straight from the pack
+		return size / blockSize + (size % blockSize != 0U ? 1U : 0U);
+	}
+
+	// Returns nullptr if the header, the TOC or the string table don't fit into the pack
+	inline const Header* ReadHeader( const uint8_t* data, size_t size )
+	{
+		if ( size < sizeof( Header ) )
+		{
+			return nullptr;
+		}
+
+		const Header* header = reinterpret_cast<const Header*>( data );
+		if ( std::memcmp( header->magic, Magic, sizeof( Magic ) ) != 0 || header->version != Version || header->blockSize == 0U )
+		{
+			return nullptr;
+		}
+
+		const uint64_t tocSize = uint64_t( header->numEntries ) * sizeof( Entry );
+		if ( header->tocOffset % alignof( Entry ) != 0U
+			|| header->tocOffset > size || tocSize > size - header->tocOffset
+			|| header->stringTableOffset > size || header->stringTableSize > size - header->stringTableOffset )
+		{
+			return nullptr;
+		}
+
+		return header;
+	}
+
+	// Returns false if the entry or its blocks point outside of the pack
+	inline bool ValidateEntry( const Header& header, const Entry& entry, const uint8_t* packData, size_t packSize )
+	{
+		if ( entry.dataOffset > packSize || entry.storedSize > packSize - entry.dataOffset
+			|| entry.pathOffset > header.stringTableSize || entry.pathLength > header.stringTableSize - entry.pathOffset )
+		{
+			return false;
+		}
+
+		if ( entry.compression == CompressionNone )
+		{
+			return entry.storedSize == entry.size;
+		}
+
+		if ( entry.compression != CompressionLz4 || entry.dataOffset % alignof( uint32_t ) != 0U )
+		{
+			return false;
+		}
+
+		// Compared by division, a damaged size could overflow (numBlocks + 1) * 4
+		const uint64_t numBlocks = GetNumBlocks( entry.size, header.blockSize );
+		if ( numBlocks >= entry.storedSize / sizeof( uint32_t ) )
+		{
+			return false;
+		}
+
+		// Offsets must go forward and stay within the file's data
+		const uint32_t* blockOffsets = reinterpret_cast<const uint32_t*>( packData + entry.dataOffset );
+		if ( blockOffsets[0] != (numBlocks + 1U) * sizeof( uint32_t ) || blockOffsets[numBlocks] > entry.storedSize )
+		{
+			return false;
+		}
+
+		for ( uint64_t i = 0U; i < numBlocks; i++ )
+		{
+			if ( blockOffsets[i] > blockOffsets[i + 1U] )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Decompresses blocks [beginBlock, endBlock) of a compressed, validated entry, as far
+	// as they overlap [offset, offset + size), into output, which starts at offset
+	// Blocks that are only partially requested go through scratch
+	// PackFile::ReadEntry runs this once per job, the PackBuilder benchmark once per file
+	inline bool ReadBlocks( const Entry& entry, uint32_t blockSize, const uint8_t* data, uint64_t offset, uint64_t size,
+		uint64_t beginBlock, uint64_t endBlock, uint8_t* output, std::vector<uint8_t>& scratch )
+	{
+		const uint32_t* blockOffsets = reinterpret_cast<const uint32_t*>( data );
+
+		for ( uint64_t block = beginBlock; block < endBlock; block++ )
+		{
+			const uint64_t blockStart = block * blockSize;
+			const uint64_t blockLength = std::min<uint64_t>( blockSize, entry.size - blockStart );
+			const uint8_t* storedBlock = data + blockOffsets[block];
+			const uint64_t storedLength = blockOffsets[block + 1U] - blockOffsets[block];
+
+			const uint64_t copyStart = std::max( blockStart, offset );
+			const uint64_t copyEnd = std::min( blockStart + blockLength, offset + size );
+			const bool wholeBlock = copyStart == blockStart && copyEnd == blockStart + blockLength;
+
+			uint8_t* destination = output + (copyStart - offset);
+			if ( !wholeBlock )
+			{
+				scratch.resize( blockLength );
+				destination = scratch.data();
+			}
+
+			// Blocks that didn't get any smaller are stored as they are
+			if ( storedLength == blockLength )
+			{
+				std::memcpy( destination, storedBlock, blockLength );
+			}
+			else if ( !Lz4::Decompress( storedBlock, storedLength, destination, blockLength ) )
+			{
+				return false;
+			}
+
+			if ( !wholeBlock )
+			{
+				std::memcpy( output + (copyStart - offset), scratch.data() + (copyStart - blockStart), copyEnd - copyStart );
+			}
+		}
+
+		return true;
+	}
+}
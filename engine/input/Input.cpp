@@ -3,6 +3,7 @@
 
 #include "common/Precompiled.hpp"
 #include "Input.hpp"
+#include "../profiler/Profiler.hpp"
 
 #include "SDL.h"
 
@@ -76,6 +77,8 @@ void Input::Shutdown()
 // ============================
 void Input::Update()
 {
+	BTX_PROFILE_FUNCTION();
+
 	// Axis updates and general event handling
 	// TODO: give the user callbacks to handle SDL events in the game DLL
 
@@ -0,0 +1,347 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "JobSystem.hpp"
+#include "../profiler/Profiler.hpp"
+
+thread_local int32_t JobSystem::CurrentQueueIndex = -1;
+
+// ============================
+// JobSystem::Init
+// ============================
+bool JobSystem::Init( uint32_t numWorkerThreads )
+{
+	if ( 0U == numWorkerThreads )
+	{
+		const uint32_t numHardwareThreads = std::thread::hardware_concurrency();
+		numWorkerThreads = numHardwareThreads > 1U ? numHardwareThreads - 1U : 1U;
+	}
+
+	stopRequested = false;
+
+	// The main thread gets a queue too, so it can help while waiting
+	queues.reserve( numWorkerThreads + 1U );
+	for ( uint32_t i = 0U; i < numWorkerThreads + 1U; i++ )
+	{
+		queues.emplace_back( new WorkerQueue() );
+	}
+	CurrentQueueIndex = 0;
+
+	workerThreads.reserve( numWorkerThreads );
+	for ( uint32_t i = 1U; i <= numWorkerThreads; i++ )
+	{
+		workerThreads.emplace_back( [this, i]
+			{
+				WorkerThread( i );
+			} );
+	}
+
+	console->Print( adm::format( "JobSystem::Init: %u worker threads", numWorkerThreads ) );
+	return true;
+}
+
+// ============================
+// JobSystem::Shutdown
+// ============================
+void JobSystem::Shutdown()
+{
+	// Finish whatever is left, someone might be relying on it. Jobs that are still
+	// running can release dependents into any queue, so it's not enough for the
+	// queues to be empty, every scheduled job has to be finished
+	while ( numUnfinishedJobs.load( std::memory_order_acquire ) > 0U )
+	{
+		if ( JobHandle job = TryGetJob( 0U ) )
+		{
+			Execute( job );
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( sleepMutex );
+		stopRequested = true;
+	}
+	wakeWorkers.notify_all();
+
+	for ( auto& thread : workerThreads )
+	{
+		thread.join();
+	}
+
+	workerThreads.clear();
+	queues.clear();
+	numQueuedJobs = 0U;
+	numUnfinishedJobs = 0U;
+}
+
+// ============================
+// JobSystem::Schedule
+// ============================
+JobHandle JobSystem::Schedule( std::function<void()> function )
+{
+	JobHandle job = std::make_shared<Job>();
+	job->function = std::move( function );
+	job->numPendingDependencies.store( 0U, std::memory_order_relaxed );
+	numUnfinishedJobs.fetch_add( 1U, std::memory_order_relaxed );
+
+	Enqueue( job );
+	return job;
+}
+
+// ============================
+// JobSystem::Schedule
+// ============================
+JobHandle JobSystem::Schedule( std::function<void()> function, const Vector<JobHandle>& dependencies )
+{
+	JobHandle job = std::make_shared<Job>();
+	job->function = std::move( function );
+	job->numPendingDependencies.store( 1U + dependencies.size(), std::memory_order_relaxed );
+	numUnfinishedJobs.fetch_add( 1U, std::memory_order_relaxed );
+
+	for ( const JobHandle& dependency : dependencies )
+	{
+		if ( nullptr == dependency )
+		{
+			job->numPendingDependencies.fetch_sub( 1U, std::memory_order_relaxed );
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock( dependency->dependentsMutex );
+		if ( dependency->IsFinished() )
+		{
+			job->numPendingDependencies.fetch_sub( 1U, std::memory_order_relaxed );
+		}
+		else
+		{
+			dependency->dependents.push_back( job );
+		}
+	}
+
+	// Release the scheduling reference, if every dependency
+	// is already done, the job can go into the queue right away
+	if ( job->numPendingDependencies.fetch_sub( 1U, std::memory_order_acq_rel ) == 1U )
+	{
+		Enqueue( job );
+	}
+
+	return job;
+}
+
+// ============================
+// JobSystem::Wait
+// ============================
+void JobSystem::Wait( const JobHandle& job )
+{
+	if ( nullptr == job )
+	{
+		return;
+	}
+
+	const uint32_t queueIndex = GetQueueIndex();
+	while ( !job->IsFinished() )
+	{
+		if ( JobHandle otherJob = TryGetJob( queueIndex ) )
+		{
+			Execute( otherJob );
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+// ============================
+// JobSystem::WaitAll
+// ============================
+void JobSystem::WaitAll( const Vector<JobHandle>& jobs )
+{
+	for ( const JobHandle& job : jobs )
+	{
+		Wait( job );
+	}
+}
+
+// ============================
+// JobSystem::ParallelFor
+// ============================
+void JobSystem::ParallelFor( size_t count, size_t batchSize, const std::function<void( size_t begin, size_t end )>& function )
+{
+	if ( 0U == count )
+	{
+		return;
+	}
+
+	batchSize = std::max<size_t>( batchSize, 1U );
+
+	// Not worth going through the queues
+	if ( count <= batchSize )
+	{
+		function( 0U, count );
+		return;
+	}
+
+	Vector<JobHandle> batches;
+	batches.reserve( count / batchSize + 1U );
+
+	// The first batch is left for the calling thread
+	for ( size_t begin = batchSize; begin < count; begin += batchSize )
+	{
+		const size_t end = std::min( begin + batchSize, count );
+		batches.push_back( Schedule( [&function, begin, end]
+			{
+				function( begin, end );
+			} ) );
+	}
+
+	function( 0U, batchSize );
+	WaitAll( batches );
+}
+
+// ============================
+// JobSystem::GetNumThreads
+// ============================
+uint32_t JobSystem::GetNumThreads() const
+{
+	return queues.size();
+}
+
+// ============================
+// JobSystem::WorkerThread
+// ============================
+void JobSystem::WorkerThread( uint32_t queueIndex )
+{
+	CurrentQueueIndex = queueIndex;
+	adm::Singleton<Profiler>::GetInstance().SetThreadName( adm::format( "Job worker %u", queueIndex ) );
+
+	while ( true )
+	{
+		if ( JobHandle job = TryGetJob( queueIndex ) )
+		{
+			Execute( job );
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( sleepMutex );
+		wakeWorkers.wait( lock, [this]
+			{
+				return stopRequested || numQueuedJobs.load( std::memory_order_acquire ) > 0U;
+			} );
+
+		// Never leave queued jobs behind
+		if ( stopRequested && numQueuedJobs.load( std::memory_order_acquire ) == 0U )
+		{
+			return;
+		}
+	}
+}
+
+// ============================
+// JobSystem::Enqueue
+// ============================
+void JobSystem::Enqueue( JobHandle job )
+{
+	WorkerQueue& queue = *queues[GetQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		queue.jobs.push_back( std::move( job ) );
+	}
+
+	{
+		// Under the sleep mutex, so a worker can't miss the wakeup
+		// between checking the counter and going to sleep
+		std::lock_guard<std::mutex> lock( sleepMutex );
+		numQueuedJobs.fetch_add( 1U, std::memory_order_release );
+	}
+	wakeWorkers.notify_one();
+}
+
+// ============================
+// JobSystem::TryGetJob
+// ============================
+JobHandle JobSystem::TryGetJob( uint32_t queueIndex )
+{
+	if ( numQueuedJobs.load( std::memory_order_acquire ) == 0U )
+	{
+		return nullptr;
+	}
+
+	const uint32_t numQueues = queues.size();
+	for ( uint32_t i = 0U; i < numQueues; i++ )
+	{
+		const uint32_t victimIndex = (queueIndex + i) % numQueues;
+		WorkerQueue& queue = *queues[victimIndex];
+
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		if ( queue.jobs.empty() )
+		{
+			continue;
+		}
+
+		JobHandle job;
+		// Own queue: newest first, others: oldest first
+		if ( victimIndex == queueIndex )
+		{
+			job = std::move( queue.jobs.back() );
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = std::move( queue.jobs.front() );
+			queue.jobs.pop_front();
+		}
+
+		numQueuedJobs.fetch_sub( 1U, std::memory_order_relaxed );
+		return job;
+	}
+
+	return nullptr;
+}
+
+// ============================
+// JobSystem::Execute
+// ============================
+void JobSystem::Execute( const JobHandle& job )
+{
+	{
+		BTX_PROFILE_ZONE( "Job" );
+		job->function();
+	}
+	job->function = nullptr;
+
+	Vector<JobHandle> dependents;
+	{
+		std::lock_guard<std::mutex> lock( job->dependentsMutex );
+		job->finished.store( true, std::memory_order_release );
+		dependents.swap( job->dependents );
+	}
+
+	for ( JobHandle& dependent : dependents )
+	{
+		if ( dependent->numPendingDependencies.fetch_sub( 1U, std::memory_order_acq_rel ) == 1U )
+		{
+			Enqueue( std::move( dependent ) );
+		}
+	}
+
+	// Only after the dependents are queued, so Shutdown can't miss them
+	numUnfinishedJobs.fetch_sub( 1U, std::memory_order_release );
+}
+
+// ============================
+// JobSystem::GetQueueIndex
+// ============================
+uint32_t JobSystem::GetQueueIndex()
+{
+	if ( CurrentQueueIndex >= 0 )
+	{
+		return CurrentQueueIndex;
+	}
+
+	// Threads from outside the job system spread their jobs around
+	return nextForeignQueue.fetch_add( 1U, std::memory_order_relaxed ) % queues.size();
+}
@@ -0,0 +1,161 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+
+class JobSystem;
+
+// ============================
+// Job
+// 
+// A function that runs on one of the job system's threads, once
+// all the jobs it depends on are finished
+// ============================
+class Job final
+{
+public:
+	bool				IsFinished() const
+	{
+		return finished.load( std::memory_order_acquire );
+	}
+
+private:
+	friend class JobSystem;
+
+	std::function<void()> function;
+	// One extra is held while the job is being scheduled, so
+	// it can't start before all its dependencies are linked
+	std::atomic<uint32_t> numPendingDependencies{ 1U };
+	std::atomic<bool>	finished{ false };
+
+	// Jobs that are waiting for this one
+	std::mutex			dependentsMutex;
+	Vector<std::shared_ptr<Job>> dependents;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+// ============================
+// IJobSystem
+//
+// What plugins schedule jobs through. Every plugin library would otherwise
+// have to start its own threads, so the engine hands plugins its job
+// system instead, see GetJobSystem. See JobSystem for the details
+// ============================
+class IJobSystem
+{
+public:
+	virtual ~IJobSystem() = default;
+
+	virtual JobHandle	Schedule( std::function<void()> function ) = 0;
+	// The job will start only after all dependencies are finished
+	virtual JobHandle	Schedule( std::function<void()> function, const Vector<JobHandle>& dependencies ) = 0;
+
+	// Executes other jobs while waiting
+	virtual void		Wait( const JobHandle& job ) = 0;
+	virtual void		WaitAll( const Vector<JobHandle>& jobs ) = 0;
+
+	// Splits [0, count) into batches of batchSize, runs them on all threads
+	// and returns when they're all done. The calling thread helps too
+	virtual void		ParallelFor( size_t count, size_t batchSize, const std::function<void( size_t begin, size_t end )>& function ) = 0;
+
+	// Worker threads + the main thread
+	virtual uint32_t	GetNumThreads() const = 0;
+};
+
+// This module's way to the engine's job system. Set by JobSystem::Setup in the engine,
+// and by PluginSystem for plugin libraries that have BTX_JOBSYSTEM_PLUGIN somewhere
+inline IJobSystem* ModuleJobSystem = nullptr;
+
+// The engine's job system, from both the engine and plugins
+// Nullptr in plugin libraries that don't have BTX_JOBSYSTEM_PLUGIN
+inline IJobSystem* GetJobSystem()
+{
+	return ModuleJobSystem;
+}
+
+// Plugin libraries put this in one of their source files, so they can
+// schedule jobs on the engine's threads. PluginSystem calls it on load
+#define BTX_JOBSYSTEM_PLUGIN() extern "C" ADM_EXPORT IJobSystem** GetJobSystemSlot() { return &ModuleJobSystem; }
+using JobSystemSlotFunction = IJobSystem**();
+constexpr const char* JobSystemSlotFunctionName = "GetJobSystemSlot";
+
+// ============================
+// JobSystem
+// 
+// Work-stealing task scheduler. Every worker thread, and the main
+// thread, owns a queue. Owners take the newest job from their own
+// queue (it's the most likely to still be in cache), idle threads
+// steal the oldest job from the others
+// 
+// Waiting on a job doesn't block, the waiting thread executes
+// other jobs in the meantime
+// ============================
+class JobSystem final : public IJobSystem
+{
+public:
+	// 0 worker threads means one less than the number of hardware threads
+	bool				Init( uint32_t numWorkerThreads = 0U );
+	// Runs every job that's been scheduled, including ones released by
+	// dependencies finishing along the way, then stops the workers
+	void				Shutdown();
+
+	void				Setup( IConsole* console )
+	{
+		this->console = console;
+		ModuleJobSystem = this;
+	}
+
+	JobHandle			Schedule( std::function<void()> function ) override;
+	// The job will start only after all dependencies are finished
+	JobHandle			Schedule( std::function<void()> function, const Vector<JobHandle>& dependencies ) override;
+
+	// Executes other jobs while waiting
+	void				Wait( const JobHandle& job ) override;
+	void				WaitAll( const Vector<JobHandle>& jobs ) override;
+
+	// Splits [0, count) into batches of batchSize, runs them on all threads
+	// and returns when they're all done. The calling thread helps too
+	void				ParallelFor( size_t count, size_t batchSize, const std::function<void( size_t begin, size_t end )>& function ) override;
+
+	// Worker threads + the main thread
+	uint32_t			GetNumThreads() const override;
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex		mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	void				WorkerThread( uint32_t queueIndex );
+
+	void				Enqueue( JobHandle job );
+	// Pops from the back of its own queue, else steals from the front of others
+	JobHandle			TryGetJob( uint32_t queueIndex );
+	void				Execute( const JobHandle& job );
+	// Returns the queue of the calling thread, or any queue for foreign threads
+	uint32_t			GetQueueIndex();
+
+private:
+	// Index of the calling thread's queue, -1 for threads that don't belong here
+	static thread_local int32_t CurrentQueueIndex;
+
+	// [0] belongs to the main thread, the rest to the worker threads
+	Vector<UniquePtr<WorkerQueue>> queues;
+	Vector<std::thread>	workerThreads;
+
+	// Idle workers sleep on this
+	std::mutex			sleepMutex;
+	std::condition_variable wakeWorkers;
+	std::atomic<uint32_t> numQueuedJobs{ 0U };
+	// Scheduled but not finished yet, including jobs waiting on dependencies
+	std::atomic<uint32_t> numUnfinishedJobs{ 0U };
+	std::atomic<uint32_t> nextForeignQueue{ 0U };
+	bool				stopRequested{ false };
+
+	IConsole*			console{ nullptr };
+};
@@ -0,0 +1,269 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "../jobsystem/JobSystem.hpp"
+#include "../profiler/Profiler.hpp"
+#include "PluginSystem.hpp"
+#include "ApplicationUpdateGraph.hpp"
+
+// ============================
+// ApplicationUpdateGraph::Build
+// ============================
+void ApplicationUpdateGraph::Build( PluginSystem& pluginSystem, IConsole* console )
+{
+	Clear();
+
+	// Load order is the baseline, it's what breaks ties
+	Vector<IApplication*> applications;
+	pluginSystem.ForEachPluginOfType<IApplication>( [&]( IApplication* application )
+		{
+			const ApplicationUpdateDesc* desc = pluginSystem.GetApplicationUpdateDesc( application->GetPluginName() );
+			if ( nullptr != desc && desc->updateEveryFrame )
+			{
+				frameApplications.push_back( application );
+				return;
+			}
+
+			applications.push_back( application );
+		} );
+
+	const size_t numApplications = applications.size();
+	Vector<const ApplicationUpdateDesc*> descs( numApplications );
+	for ( size_t i = 0U; i < numApplications; i++ )
+	{
+		descs[i] = pluginSystem.GetApplicationUpdateDesc( applications[i]->GetPluginName() );
+	}
+
+	// explicitEdges[i] lists everything i explicitly wants to update after
+	Vector<Vector<uint32_t>> explicitEdges( numApplications );
+	for ( size_t i = 0U; i < numApplications; i++ )
+	{
+		if ( nullptr == descs[i] )
+		{
+			continue;
+		}
+
+		for ( size_t j = 0U; j < numApplications; j++ )
+		{
+			if ( i != j && Contains( descs[i]->after, applications[j]->GetPluginName() ) )
+			{
+				explicitEdges[i].push_back( j );
+			}
+		}
+	}
+
+	// Kahn's algorithm over the explicit edges only, always picking the earliest
+	// loaded application that's ready, so the result is the same on every run
+	// Implicit edges are added afterwards along this order, so they can't form cycles
+	Vector<uint32_t> numPendingEdges( numApplications );
+	Vector<uint32_t> sortedIndices( numApplications );
+	Vector<uint32_t> order;
+	Vector<bool> visited( numApplications, false );
+	for ( size_t i = 0U; i < numApplications; i++ )
+	{
+		numPendingEdges[i] = explicitEdges[i].size();
+	}
+
+	while ( order.size() < numApplications )
+	{
+		size_t next = numApplications;
+		for ( size_t i = 0U; i < numApplications; i++ )
+		{
+			if ( !visited[i] && numPendingEdges[i] == 0U )
+			{
+				next = i;
+				break;
+			}
+		}
+
+		if ( next == numApplications )
+		{
+			console->Warning( "ApplicationUpdateGraph::Build: applications have circular 'after' dependencies, they will update one by one in load order" );
+			nodes.clear();
+			for ( size_t i = 0U; i < numApplications; i++ )
+			{
+				nodes.emplace_back().application = applications[i];
+			}
+			return;
+		}
+
+		visited[next] = true;
+		sortedIndices[next] = static_cast<uint32_t>( order.size() );
+		order.push_back( static_cast<uint32_t>( next ) );
+
+		for ( size_t i = 0U; i < numApplications; i++ )
+		{
+			for ( const uint32_t dependency : explicitEdges[i] )
+			{
+				if ( dependency == next )
+				{
+					numPendingEdges[i]--;
+				}
+			}
+		}
+	}
+
+	for ( const uint32_t applicationIndex : order )
+	{
+		Node& node = nodes.emplace_back();
+		node.application = applications[applicationIndex];
+		node.desc = descs[applicationIndex];
+		anyDeclared |= nullptr != node.desc;
+
+		for ( const uint32_t dependency : explicitEdges[applicationIndex] )
+		{
+			node.dependencies.push_back( sortedIndices[dependency] );
+		}
+	}
+
+	// Nothing is known about what undeclared applications touch, so they conflict with
+	// everything and keep their place in the order. Only two declared applications
+	// that don't touch the same state are left unordered
+	for ( uint32_t i = 0U; i < nodes.size(); i++ )
+	{
+		Node& node = nodes[i];
+		for ( uint32_t j = 0U; j < i; j++ )
+		{
+			const Node& other = nodes[j];
+			const bool conflicting = nullptr == node.desc || nullptr == other.desc || Conflicts( *node.desc, *other.desc );
+			if ( conflicting && std::find( node.dependencies.begin(), node.dependencies.end(), j ) == node.dependencies.end() )
+			{
+				node.dependencies.push_back( j );
+			}
+		}
+	}
+
+	size_t numIndependent = 0U;
+	for ( const Node& node : nodes )
+	{
+		numIndependent += node.dependencies.empty() ? 1U : 0U;
+	}
+
+	console->Print( adm::format( "ApplicationUpdateGraph: %u applications, %u of them without dependencies, %u updating every frame",
+		uint32_t( nodes.size() ), uint32_t( numIndependent ), uint32_t( frameApplications.size() ) ) );
+}
+
+// ============================
+// ApplicationUpdateGraph::Clear
+// ============================
+void ApplicationUpdateGraph::Clear()
+{
+	nodes.clear();
+	jobs.clear();
+	anyDeclared = false;
+	frameApplications.clear();
+}
+
+// ============================
+// ApplicationUpdateGraph::Update
+// ============================
+void ApplicationUpdateGraph::Update( JobSystem& jobSystem )
+{
+	// Nothing to parallelise, or nobody opted in
+	if ( nodes.size() < 2U || !anyDeclared )
+	{
+		return UpdateSerial();
+	}
+
+	// Nodes are sorted, so by the time a node comes up, everything it
+	// depends on has either run on this thread or been scheduled
+	jobs.clear();
+	for ( const Node& node : nodes )
+	{
+		dependencyJobs.clear();
+		for ( const uint32_t dependency : node.dependencies )
+		{
+			// Null for applications that already ran on this thread
+			if ( nullptr != jobs[dependency] )
+			{
+				dependencyJobs.push_back( jobs[dependency] );
+			}
+		}
+
+		IApplication* application = node.application;
+
+		// Undeclared applications may be bound to this thread (windows, GL contexts, thread_locals)
+		if ( nullptr == node.desc )
+		{
+			jobSystem.WaitAll( dependencyJobs );
+
+			BTX_PROFILE_ZONE( application->GetPluginName() );
+			application->Update();
+			jobs.push_back( nullptr );
+			continue;
+		}
+
+		jobs.push_back( jobSystem.Schedule( [application]
+			{
+				BTX_PROFILE_ZONE( application->GetPluginName() );
+				application->Update();
+			}, dependencyJobs ) );
+	}
+
+	jobSystem.WaitAll( jobs );
+}
+
+// ============================
+// ApplicationUpdateGraph::UpdateSerial
+// ============================
+void ApplicationUpdateGraph::UpdateSerial()
+{
+	for ( const Node& node : nodes )
+	{
+		BTX_PROFILE_ZONE( node.application->GetPluginName() );
+		node.application->Update();
+	}
+}
+
+// ============================
+// ApplicationUpdateGraph::UpdateFrame
+// ============================
+void ApplicationUpdateGraph::UpdateFrame()
+{
+	for ( IApplication* application : frameApplications )
+	{
+		BTX_PROFILE_ZONE( application->GetPluginName() );
+		application->Update();
+	}
+}
+
+// ============================
+// ApplicationUpdateGraph::HasFrameApplications
+// ============================
+bool ApplicationUpdateGraph::HasFrameApplications() const
+{
+	return !frameApplications.empty();
+}
+
+// ============================
+// ApplicationUpdateGraph::Conflicts
+// ============================
+bool ApplicationUpdateGraph::Conflicts( const ApplicationUpdateDesc& a, const ApplicationUpdateDesc& b )
+{
+	for ( const String& written : a.writes )
+	{
+		if ( Contains( b.reads, written ) || Contains( b.writes, written ) )
+		{
+			return true;
+		}
+	}
+
+	for ( const String& written : b.writes )
+	{
+		if ( Contains( a.reads, written ) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// ============================
+// ApplicationUpdateGraph::Contains
+// ============================
+bool ApplicationUpdateGraph::Contains( const Vector<String>& names, StringView name )
+{
+	return std::find( names.begin(), names.end(), name ) != names.end();
+}
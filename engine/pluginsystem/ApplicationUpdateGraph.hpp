@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// ApplicationUpdateGraph
+// 
+// Figures out which IApplication plugins can update in parallel
+// 
+// Parallelism is strictly opt-in: if no application declares anything
+// in plugins.json, they all update serially on the calling thread
+// Otherwise, applications that don't declare anything still update on the
+// calling thread, since they may be bound to it, and are ordered against
+// every other application, since they may touch anything. Only declared
+// applications are handed to the job system, and only those that don't
+// share any state run at the same time
+// ============================
+class ApplicationUpdateGraph final
+{
+public:
+	// Call again whenever the set of loaded applications changes
+	void				Build( PluginSystem& pluginSystem, IConsole* console );
+	void				Clear();
+
+	// Independent declared applications update on the job system's threads
+	void				Update( JobSystem& jobSystem );
+	// Same order, one at a time
+	void				UpdateSerial();
+	// Applications with updateEveryFrame, which Update and UpdateSerial skip
+	// One at a time in load order, on the calling thread
+	void				UpdateFrame();
+	bool				HasFrameApplications() const;
+
+private:
+	struct Node
+	{
+		IApplication*	application{ nullptr };
+		const ApplicationUpdateDesc* desc{ nullptr };
+		// Indices into nodes, always lower than this node's own index
+		Vector<uint32_t> dependencies;
+	};
+
+	static bool			Conflicts( const ApplicationUpdateDesc& a, const ApplicationUpdateDesc& b );
+	static bool			Contains( const Vector<String>& names, StringView name );
+
+private:
+	// Topologically sorted
+	Vector<Node>		nodes;
+	// Whether any application has an entry in plugins.json
+	bool				anyDeclared{ false };
+	// In load order, see ApplicationUpdateDesc::updateEveryFrame
+	Vector<IApplication*> frameApplications;
+	// Reused every frame
+	Vector<JobHandle>	jobs;
+	Vector<JobHandle>	dependencyJobs;
+};
@@ -3,6 +3,8 @@
 
 #include "common/Precompiled.hpp"
 #include "PluginSystem.hpp"
+#include "../jobsystem/JobSystem.hpp"
+#include "../profiler/Profiler.hpp"
 
 // ============================
 // PluginSystem::Init
@@ -45,6 +47,7 @@ bool PluginSystem::Init( const Vector<String>& pluginsToLoad )
 void PluginSystem::Shutdown()
 {
 	pluginInterfaceMap.clear();
+	applicationUpdateDescs.clear();
 	pluginLibraries.clear();
 }
 
@@ -131,12 +134,33 @@ PluginLibrary* PluginSystem::LoadPluginLibrary( Path libraryPath )
 		return nullptr;
 	};
 
+	// Optional, see BTX_PROFILER_PLUGIN
+	auto profilerSlot = pluginModule.TryExecuteFunction<ProfilerSlotFunction>( ProfilerSlotFunctionName );
+	if ( profilerSlot && nullptr != profilerSlot.value() )
+	{
+		*profilerSlot.value() = &GetProfiler();
+	}
+
+	// Optional, see BTX_JOBSYSTEM_PLUGIN
+	auto jobSystemSlot = pluginModule.TryExecuteFunction<JobSystemSlotFunction>( JobSystemSlotFunctionName );
+	if ( jobSystemSlot && nullptr != jobSystemSlot.value() )
+	{
+		*jobSystemSlot.value() = GetJobSystem();
+	}
+
 	console->Print( adm::format( "PluginSystem::LoadPluginLibrary: successfully loaded '%s'", libraryPathStr.c_str() ) );
 
+	LoadApplicationUpdateDescs( pluginJson );
+
 	pluginLibraries.emplace_back( PluginLibrary( registry, pluginJson, libraryMetadataPath ), std::move( pluginModule ) );
 
 	AddPluginsToInterfaceMap( pluginLibraries.back().pluginLibrary );
 
+	if ( libraryChangeCallback )
+	{
+		libraryChangeCallback();
+	}
+
 	return &pluginLibraries.back().pluginLibrary;
 }
 
@@ -175,8 +199,23 @@ void PluginSystem::UnloadPluginLibrary( const PluginLibrary* pluginLibrary )
 	{
 		if ( &pair.pluginLibrary == pluginLibrary )
 		{
+			for ( const auto& plugin : pair.pluginLibrary.GetPlugins() )
+			{
+				if ( unloadCallback )
+				{
+					unloadCallback( plugin.get() );
+				}
+
+				applicationUpdateDescs.erase( plugin->GetPluginName() );
+			}
+
 			RemovePluginsFromInterfaceMap( pair.pluginLibrary );
 			pluginLibraries.remove( pair );
+
+			if ( libraryChangeCallback )
+			{
+				libraryChangeCallback();
+			}
 			break;
 		}
 	}
@@ -229,6 +268,69 @@ IPlugin* PluginSystem::GetPluginByNameRaw( StringView pluginName ) const
 	return nullptr;
 }
 
+// ============================
+// PluginSystem::GetApplicationUpdateDesc
+// ============================
+const ApplicationUpdateDesc* PluginSystem::GetApplicationUpdateDesc( StringView pluginName ) const
+{
+	auto result = applicationUpdateDescs.find( String( pluginName ) );
+	if ( result == applicationUpdateDescs.end() )
+	{
+		return nullptr;
+	}
+
+	return &result->second;
+}
+
+// ============================
+// PluginSystem::OnFileChanged
+// ============================
+bool PluginSystem::OnFileChanged( const Path& path )
+{
+	const auto realPath = fileSystem->GetPathTo( path, IFileSystem::Path_File );
+	if ( !realPath )
+	{
+		return false;
+	}
+
+	for ( const auto& pair : pluginLibraries )
+	{
+		const PluginLibrary& pluginLibrary = pair.pluginLibrary;
+		const Path& metadataPath = pluginLibrary.GetMetadataPath();
+
+		// Code can't be swapped out from under running plugins
+		if ( realPath->parent_path() == metadataPath.parent_path() && (realPath->extension() == ".dll" || realPath->extension() == ".so") )
+		{
+			console->Warning( adm::format( "PluginSystem: '%s' changed, restart to load it", path.string().c_str() ) );
+			return false;
+		}
+
+		if ( *realPath != metadataPath )
+		{
+			continue;
+		}
+
+		json pluginJson = adm::ParseJSON( metadataPath.string() );
+		if ( pluginJson.empty() )
+		{
+			console->Warning( adm::format( "PluginSystem: '%s' changed, but its JSON is faulty, keeping the old one", path.string().c_str() ) );
+			return false;
+		}
+
+		// Applications may have been removed from the JSON
+		for ( const auto& plugin : pluginLibrary.GetPlugins() )
+		{
+			applicationUpdateDescs.erase( plugin->GetPluginName() );
+		}
+
+		LoadApplicationUpdateDescs( pluginJson );
+		console->Print( adm::format( "PluginSystem: Reloaded application constraints from '%s'", path.string().c_str() ) );
+		return true;
+	}
+
+	return false;
+}
+
 // ============================
 // PluginSystem::AddPluginsToInterfaceMap
 // ============================
@@ -268,3 +370,31 @@ PluginLibrary* PluginSystem::GetPluginLibrary( Path metadataPath )
 
 	return nullptr;
 }
+
+// ============================
+// PluginSystem::LoadApplicationUpdateDescs
+// ============================
+void PluginSystem::LoadApplicationUpdateDescs( const json& pluginJson )
+{
+	auto applications = pluginJson.find( "applications" );
+	if ( applications == pluginJson.end() || !applications->is_object() )
+	{
+		return;
+	}
+
+	for ( const auto& [applicationName, applicationJson] : applications->items() )
+	{
+		if ( !applicationJson.is_object() )
+		{
+			console->Warning( adm::format( "PluginSystem: 'applications/%s' in plugins.json should be an object", applicationName.c_str() ) );
+			continue;
+		}
+
+		ApplicationUpdateDesc desc;
+		desc.after = applicationJson.value( "after", Vector<String>{} );
+		desc.reads = applicationJson.value( "reads", Vector<String>{} );
+		desc.writes = applicationJson.value( "writes", Vector<String>{} );
+		desc.updateEveryFrame = applicationJson.value( "updateEveryFrame", false );
+		applicationUpdateDescs[applicationName] = std::move( desc );
+	}
+}
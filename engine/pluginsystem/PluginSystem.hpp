@@ -26,6 +26,25 @@ struct PluginLibraryPair
 	}
 };
 
+// Scheduling constraints of an IApplication, from the "applications" section of plugins.json:
+// "applications": {
+//     "BotAI": { "after": [ "ServerGame" ], "reads": [ "world" ], "writes": [ "bots" ] }
+// }
+struct ApplicationUpdateDesc
+{
+	// Names of applications that must finish their Update first
+	Vector<String>		after;
+	// Arbitrary names of shared state this application reads or writes
+	// Two applications that touch the same state, where at least
+	// one of them writes it, update in load order
+	Vector<String>		reads;
+	Vector<String>		writes;
+	// Updated once per frame after the simulation steps, on the main thread,
+	// instead of in every step. For rendering, and interpolating between
+	// steps with Core::InterpolationAlpha, see engine_fixedTimestep
+	bool				updateEveryFrame{ false };
+};
+
 class PluginSystem final : public IPluginSystem
 {
 public:
@@ -45,18 +64,42 @@ public:
 
 	void UnloadPluginLibrary( const PluginLibrary* pluginLibrary ) override;
 
+	// Called for each of a library's plugins right before UnloadPluginLibrary unloads it,
+	// so whatever still uses them can let go. Not called by Shutdown, the engine shuts
+	// down everything that uses plugins before that
+	void SetUnloadCallback( std::function<void( IPlugin* )> callback )
+	{
+		unloadCallback = std::move( callback );
+	}
+
+	// Called after LoadPluginLibrary loaded a new library, and after UnloadPluginLibrary
+	// unloaded one, so whatever keeps track of plugins can catch up. Not called by Shutdown
+	void SetLibraryChangeCallback( std::function<void()> callback )
+	{
+		libraryChangeCallback = std::move( callback );
+	}
+
 	void ForEachPlugin( std::function<void( IPlugin* )> function ) override;
 
 	PluginList& GetPluginList( const char* interfaceName ) override;
 
 	IPlugin* GetPluginByNameRaw( StringView pluginName ) const override;
 
+	// Returns nullptr if the application didn't declare any constraints
+	const ApplicationUpdateDesc* GetApplicationUpdateDesc( StringView pluginName ) const;
+
+	// Reloads a plugin library's plugins.json if that's what changed, path is relative to the mounts
+	// Returns true if application update constraints changed, so the update graph needs rebuilding
+	bool OnFileChanged( const Path& path );
+
 private:
 	void AddPluginsToInterfaceMap( const PluginLibrary& library );
 	void RemovePluginsFromInterfaceMap( const PluginLibrary& library );
 
 	PluginLibrary* GetPluginLibrary( Path metadataPath );
 
+	void LoadApplicationUpdateDescs( const json& pluginJson );
+
 private:
 	LinkedList<PluginLibraryPair> pluginLibraries;
 
@@ -64,6 +107,12 @@ private:
 	// all plugins that implement IApplication for example
 	Map<StringView, PluginList> pluginInterfaceMap;
 
+	// Application name -> update scheduling constraints from plugins.json
+	Map<String, ApplicationUpdateDesc> applicationUpdateDescs;
+
+	std::function<void( IPlugin* )> unloadCallback;
+	std::function<void()> libraryChangeCallback;
+
 	ICore* core{ nullptr };
 	IConsole* console{ nullptr };
 	IFileSystem* fileSystem{ nullptr };
@@ -0,0 +1,245 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "common/Precompiled.hpp"
+#include "Profiler.hpp"
+
+#include <ctime>
+
+namespace fs = std::filesystem;
+
+CVar profile_directory( "profile_directory", "profiles", 0, "Directory for profiler captures" );
+
+thread_local Profiler::ThreadBuffer* Profiler::CurrentThreadBuffer = nullptr;
+
+// ============================
+// Profiler::Shutdown
+// ============================
+void Profiler::Shutdown()
+{
+	capturing.store( false, std::memory_order_relaxed );
+	requestedFrames.store( 0U, std::memory_order_relaxed );
+}
+
+// ============================
+// Profiler::BeginFrame
+// ============================
+void Profiler::BeginFrame()
+{
+	if ( IsCapturing() )
+	{
+		frameStart = Now();
+		return;
+	}
+
+	const uint32_t numFrames = requestedFrames.exchange( 0U, std::memory_order_relaxed );
+	if ( 0U == numFrames )
+	{
+		return;
+	}
+
+	numCaptureFrames = numFrames;
+	numCapturedFrames = 0U;
+	generation.fetch_add( 1U, std::memory_order_relaxed );
+	capturing.store( true, std::memory_order_release );
+	frameStart = Now();
+
+	console->Print( adm::format( "Profiler: capturing %u frames...", numFrames ) );
+}
+
+// ============================
+// Profiler::EndFrame
+// ============================
+void Profiler::EndFrame()
+{
+	if ( !IsCapturing() )
+	{
+		return;
+	}
+
+	// The frame itself is the outermost zone on the main thread
+	RecordZone( "Frame", frameStart, Now(), GetGeneration() );
+
+	numCapturedFrames++;
+	if ( numCapturedFrames < numCaptureFrames )
+	{
+		return;
+	}
+
+	// Zones that are still open on other threads will see
+	// this and won't be recorded, as they'd be cut off anyway
+	capturing.store( false, std::memory_order_relaxed );
+	WriteCapture( GetGeneration() );
+}
+
+// ============================
+// Profiler::RequestCapture
+// ============================
+void Profiler::RequestCapture( uint32_t numFrames )
+{
+	requestedFrames.store( numFrames, std::memory_order_relaxed );
+}
+
+// ============================
+// Profiler::SetThreadName
+// ============================
+void Profiler::SetThreadName( StringView name )
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock( buffersMutex );
+	buffer->threadName = name;
+}
+
+// ============================
+// Profiler::Now
+// ============================
+uint64_t Profiler::Now() const
+{
+	return chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now() - startTime ).count();
+}
+
+// ============================
+// Profiler::RecordZone
+// ============================
+void Profiler::RecordZone( const char* name, uint64_t start, uint64_t end, uint32_t zoneGeneration )
+{
+	// The capture this zone began in is already over
+	if ( !IsCapturing() || zoneGeneration != GetGeneration() )
+	{
+		return;
+	}
+
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	// First zone of this thread in the current capture, only
+	// the owning thread ever resets its own buffer
+	if ( buffer->generation.load( std::memory_order_relaxed ) != zoneGeneration )
+	{
+		// Threads that never record anything never pay for a buffer
+		if ( buffer->events.empty() )
+		{
+			buffer->events.resize( MaxEventsPerThread );
+		}
+
+		buffer->numEvents.store( 0U, std::memory_order_relaxed );
+		buffer->numDropped.store( 0U, std::memory_order_relaxed );
+		buffer->generation.store( zoneGeneration, std::memory_order_release );
+	}
+
+	const uint32_t index = buffer->numEvents.load( std::memory_order_relaxed );
+	if ( index >= buffer->events.size() )
+	{
+		buffer->numDropped.fetch_add( 1U, std::memory_order_relaxed );
+		return;
+	}
+
+	buffer->events[index] = { name, start, end };
+	buffer->numEvents.store( index + 1U, std::memory_order_release );
+}
+
+// ============================
+// Profiler::GetThreadBuffer
+// ============================
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	if ( nullptr != CurrentThreadBuffer )
+	{
+		return CurrentThreadBuffer;
+	}
+
+	// Buffers are never freed, so writing a capture can't
+	// race with a thread that's exiting
+	auto* buffer = new ThreadBuffer();
+
+	std::lock_guard<std::mutex> lock( buffersMutex );
+	buffer->threadIndex = static_cast<uint32_t>( buffers.size() );
+	buffer->threadName = adm::format( "Thread %u", buffer->threadIndex );
+	buffers.emplace_back( buffer );
+
+	CurrentThreadBuffer = buffer;
+	return buffer;
+}
+
+// ============================
+// Profiler::WriteCapture
+// ============================
+bool Profiler::WriteCapture( uint32_t captureGeneration )
+{
+	const std::time_t now = std::time( nullptr );
+	char timeString[32];
+	std::strftime( timeString, sizeof( timeString ), "%Y-%m-%d_%H-%M-%S", std::localtime( &now ) );
+
+	const Path directory = String( profile_directory.GetString() );
+	std::error_code error;
+	fs::create_directories( directory, error );
+
+	const Path filePath = directory / (String( "capture_" ) + timeString + ".json");
+	std::FILE* file = std::fopen( filePath.string().c_str(), "wb" );
+	if ( nullptr == file )
+	{
+		console->Warning( adm::format( "Profiler: cannot open '%s' for writing", filePath.string().c_str() ) );
+		return false;
+	}
+
+	// Zone names are mostly literals and function names, but quotes
+	// and backslashes would still break the JSON
+	String escapedName;
+	const auto escape = [&escapedName]( const char* name ) -> const char*
+	{
+		escapedName.clear();
+		for ( const char* c = name; *c; c++ )
+		{
+			if ( *c == '"' || *c == '\\' )
+			{
+				escapedName += '\\';
+			}
+			escapedName += *c;
+		}
+		return escapedName.c_str();
+	};
+
+	size_t numEvents = 0U;
+	size_t numDropped = 0U;
+	bool first = true;
+
+	std::fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file );
+
+	std::lock_guard<std::mutex> lock( buffersMutex );
+	for ( const auto& buffer : buffers )
+	{
+		std::fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", buffer->threadIndex, escape( buffer->threadName.c_str() ) );
+		first = false;
+
+		// This thread didn't record anything during the capture
+		if ( buffer->generation.load( std::memory_order_acquire ) != captureGeneration )
+		{
+			continue;
+		}
+
+		// Zones recorded after this point are left out
+		const uint32_t count = buffer->numEvents.load( std::memory_order_acquire );
+		for ( uint32_t i = 0U; i < count; i++ )
+		{
+			const ProfilerEvent& event = buffer->events[i];
+			// Trace event timestamps are in microseconds, fractions keep the nanoseconds
+			std::fprintf( file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				escape( event.name ), buffer->threadIndex, event.start / 1000.0, (event.end - event.start) / 1000.0 );
+		}
+
+		numEvents += count;
+		numDropped += buffer->numDropped.load( std::memory_order_relaxed );
+	}
+
+	std::fputs( "\n]}\n", file );
+	std::fclose( file );
+
+	console->Print( adm::format( "Profiler: wrote %zu zones to '%s'", numEvents, filePath.string().c_str() ) );
+	if ( numDropped > 0U )
+	{
+		console->Warning( adm::format( "Profiler: %zu zones didn't fit into the buffers and were dropped", numDropped ) );
+	}
+
+	return true;
+}
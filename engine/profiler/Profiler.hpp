@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// One finished zone
+struct ProfilerEvent
+{
+	// Must outlive the capture, string literals are best
+	const char*			name{ nullptr };
+	// Nanoseconds since the profiler was set up
+	uint64_t			start{ 0U };
+	uint64_t			end{ 0U };
+};
+
+// ============================
+// IProfiler
+//
+// What profile zones record into. Every plugin library has its own copy of
+// every adm::Singleton, so a plugin's zones would never reach the engine's
+// capture. Instead, the engine hands plugins its profiler, see GetProfiler
+// ============================
+class IProfiler
+{
+public:
+	virtual ~IProfiler() = default;
+
+	virtual bool		IsCapturing() const = 0;
+	// Shows up in the trace instead of "Thread N", for the calling thread
+	virtual void		SetThreadName( StringView name ) = 0;
+
+	// Nanoseconds since the profiler was set up
+	virtual uint64_t	Now() const = 0;
+	// Zones are nested by their timestamps, so only finished zones are recorded
+	virtual void		RecordZone( const char* name, uint64_t start, uint64_t end, uint32_t generation ) = 0;
+	virtual uint32_t	GetGeneration() const = 0;
+};
+
+// Where this module's zones go. Set by Profiler::Setup in the engine, and by
+// PluginSystem for plugin libraries that have BTX_PROFILER_PLUGIN somewhere
+inline IProfiler* ModuleProfiler = nullptr;
+
+// ============================
+// Profiler
+//
+// Records scoped zones during a capture of a given number of frames,
+// then writes them out in Chrome's trace event format, which can be
+// opened in chrome://tracing or ui.perfetto.dev
+//
+// Every thread writes into its own buffer, so recording a zone
+// takes no locks. Outside of a capture, a zone costs a single
+// atomic load
+// ============================
+class Profiler final : public IProfiler
+{
+public:
+	void				Setup( IConsole* console )
+	{
+		this->console = console;
+		ModuleProfiler = this;
+	}
+
+	void				Shutdown();
+
+	// Called by the engine around every frame, on the main thread
+	void				BeginFrame();
+	void				EndFrame();
+
+	// The capture starts at the beginning of the next frame
+	// Safe to call from any thread
+	void				RequestCapture( uint32_t numFrames );
+	bool				IsCapturing() const override
+	{
+		return capturing.load( std::memory_order_relaxed );
+	}
+
+	void				SetThreadName( StringView name ) override;
+
+	uint64_t			Now() const override;
+	void				RecordZone( const char* name, uint64_t start, uint64_t end, uint32_t generation ) override;
+	uint32_t			GetGeneration() const override
+	{
+		return generation.load( std::memory_order_relaxed );
+	}
+
+private:
+	struct ThreadBuffer
+	{
+		uint32_t		threadIndex{ 0U };
+		String			threadName;
+		// Allocated on the first capture, zones past the end are dropped and counted
+		Vector<ProfilerEvent> events;
+		// Written only by the owning thread, published with release
+		std::atomic<uint32_t> numEvents{ 0U };
+		std::atomic<uint32_t> generation{ 0U };
+		std::atomic<uint32_t> numDropped{ 0U };
+	};
+
+	// Registers the calling thread on its first zone
+	ThreadBuffer*		GetThreadBuffer();
+	bool				WriteCapture( uint32_t captureGeneration );
+
+private:
+	static constexpr uint32_t MaxEventsPerThread = 256U * 1024U;
+
+	static thread_local ThreadBuffer* CurrentThreadBuffer;
+
+	chrono::steady_clock::time_point startTime{ chrono::steady_clock::now() };
+
+	// Taken only when a thread registers, or when writing a capture
+	std::mutex			buffersMutex;
+	Vector<UniquePtr<ThreadBuffer>> buffers;
+
+	std::atomic<bool>	capturing{ false };
+	// Bumped with every capture, zones from older ones are thrown away
+	std::atomic<uint32_t> generation{ 0U };
+	std::atomic<uint32_t> requestedFrames{ 0U };
+	uint32_t			numCaptureFrames{ 0U };
+	uint32_t			numCapturedFrames{ 0U };
+	uint64_t			frameStart{ 0U };
+
+	IConsole*			console{ nullptr };
+};
+
+// ============================
+// ProfileZone
+//
+// Records the time between its construction and destruction
+// Use BTX_PROFILE_ZONE or BTX_PROFILE_FUNCTION instead of this
+// ============================
+class ProfileZone final
+{
+public:
+	ProfileZone( IProfiler& profiler, const char* name )
+	{
+		if ( profiler.IsCapturing() )
+		{
+			this->profiler = &profiler;
+			this->name = name;
+			generation = profiler.GetGeneration();
+			start = profiler.Now();
+		}
+	}
+
+	~ProfileZone()
+	{
+		if ( nullptr != profiler )
+		{
+			profiler->RecordZone( name, start, profiler->Now(), generation );
+		}
+	}
+
+	ProfileZone( const ProfileZone& ) = delete;
+	ProfileZone& operator=( const ProfileZone& ) = delete;
+
+private:
+	IProfiler*			profiler{ nullptr };
+	const char*			name{ nullptr };
+	uint64_t			start{ 0U };
+	uint32_t			generation{ 0U };
+};
+
+// ============================
+// NullProfiler
+//
+// Takes zones while there's no profiler to record them,
+// e.g. in a plugin library that doesn't have BTX_PROFILER_PLUGIN
+// ============================
+class NullProfiler final : public IProfiler
+{
+public:
+	bool				IsCapturing() const override
+	{
+		return false;
+	}
+
+	void				SetThreadName( StringView name ) override
+	{
+	}
+
+	uint64_t			Now() const override
+	{
+		return 0U;
+	}
+
+	void				RecordZone( const char* name, uint64_t start, uint64_t end, uint32_t generation ) override
+	{
+	}
+
+	uint32_t			GetGeneration() const override
+	{
+		return 0U;
+	}
+};
+
+// The engine's profiler, from both the engine and plugins
+inline IProfiler& GetProfiler()
+{
+	static NullProfiler nullProfiler;
+	return nullptr != ModuleProfiler ? *ModuleProfiler : nullProfiler;
+}
+
+// Plugin libraries put this in one of their source files, so they can
+// profile into the engine's captures. PluginSystem calls it on load
+#define BTX_PROFILER_PLUGIN() extern "C" ADM_EXPORT IProfiler** GetProfilerSlot() { return &ModuleProfiler; }
+using ProfilerSlotFunction = IProfiler**();
+constexpr const char* ProfilerSlotFunctionName = "GetProfilerSlot";
+
+#define BTX_PROFILE_CONCAT_INNER( a, b ) a##b
+#define BTX_PROFILE_CONCAT( a, b ) BTX_PROFILE_CONCAT_INNER( a, b )
+
+// Profiles the rest of the enclosing scope, name must outlive the capture
+#define BTX_PROFILE_ZONE( name ) ProfileZone BTX_PROFILE_CONCAT( profileZone, __LINE__ )( GetProfiler(), name )
+#define BTX_PROFILE_FUNCTION() BTX_PROFILE_ZONE( __FUNCTION__ )
@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+// Expands binary console logs (.btxlog) back into text
+// Usage: btxlogdecode console_2022-01-01_12-00-00.btxlog [more files...]
+// Output goes to stdout, in the same layout as the file logger
+
+#include "engine/console/BinaryLogFormat.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+// ============================
+// GenerateTimeString
+// ============================
+static const char* GenerateTimeString( double time )
+{
+	// mmm:ss.sss
+	static char buffer[32];
+
+	const int iTime = time;
+	const int seconds = iTime % 60;
+	const int minutes = iTime / 60;
+
+	const double flSeconds = seconds + (time - iTime);
+
+	std::snprintf( buffer, sizeof( buffer ), "%03i:%06.3f", minutes, flSeconds );
+	return buffer;
+}
+
+// ============================
+// DecodeFile
+// ============================
+static bool DecodeFile( const char* filePath )
+{
+	std::ifstream file( filePath, std::ios::binary );
+	if ( !file )
+	{
+		std::fprintf( stderr, "Cannot open '%s'\n", filePath );
+		return false;
+	}
+
+	const std::vector<uint8_t> contents( (std::istreambuf_iterator<char>( file )), std::istreambuf_iterator<char>() );
+	if ( !BinaryLog::ReadHeader( contents.data(), contents.size() ) )
+	{
+		std::fprintf( stderr, "'%s' is not a binary log, or its version is unsupported\n", filePath );
+		return false;
+	}
+
+	std::unordered_map<uint64_t, std::string> formats;
+	std::vector<std::string_view> arguments;
+	std::string text;
+	uint64_t time = 0U;
+
+	const uint8_t* data = contents.data() + BinaryLog::HeaderSize;
+	const uint8_t* end = contents.data() + contents.size();
+
+	const auto readString = [&]( std::string_view& outString )
+	{
+		uint64_t length = 0U;
+		if ( !BinaryLog::ReadVarint( data, end, length ) || length > uint64_t( end - data ) )
+		{
+			return false;
+		}
+
+		outString = std::string_view( reinterpret_cast<const char*>( data ), length );
+		data += length;
+		return true;
+	};
+
+	while ( data < end )
+	{
+		const uint8_t recordType = *data++;
+		bool valid = false;
+
+		if ( recordType == BinaryLog::RecordFormat )
+		{
+			uint64_t formatId = 0U;
+			std::string_view format;
+			valid = BinaryLog::ReadVarint( data, end, formatId ) && readString( format );
+			if ( valid )
+			{
+				formats[formatId] = std::string( format );
+			}
+		}
+		else if ( recordType == BinaryLog::RecordMessage )
+		{
+			uint64_t timeDelta = 0U;
+			uint64_t formatId = 0U;
+			uint64_t numArguments = 0U;
+			valid = BinaryLog::ReadVarint( data, end, timeDelta )
+				&& BinaryLog::ReadVarint( data, end, formatId )
+				&& BinaryLog::ReadVarint( data, end, numArguments );
+
+			arguments.clear();
+			for ( uint64_t i = 0U; valid && i < numArguments; i++ )
+			{
+				std::string_view argument;
+				valid = readString( argument );
+				arguments.push_back( argument );
+			}
+
+			auto format = formats.find( formatId );
+			if ( valid && format != formats.end() )
+			{
+				time += timeDelta;
+				BinaryLog::ExpandTemplate( format->second, arguments, text );
+				std::printf( "%s | %s\n", GenerateTimeString( time / 1'000'000.0 ), text.c_str() );
+			}
+			else if ( valid )
+			{
+				std::fprintf( stderr, "'%s': message refers to an unknown format %llu\n", filePath, static_cast<unsigned long long>( formatId ) );
+			}
+		}
+
+		if ( !valid )
+		{
+			// Most likely a log that was still being written, or got cut off
+			std::fprintf( stderr, "'%s': truncated or corrupt record at offset %zu\n", filePath, size_t( data - contents.data() ) );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 )
+	{
+		std::fprintf( stderr, "Usage: btxlogdecode <file.btxlog> [more files...]\n" );
+		return 1;
+	}
+
+	bool success = true;
+	for ( int i = 1; i < argc; i++ )
+	{
+		success &= DecodeFile( argv[i] );
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+// Compiles text models (.btm) into compiled models (.btmc), written next to them
+// Usage: btxcook [--force] path...
+// Paths can be text models or directories, which are searched recursively
+// Compiled models that are up to date with their text model are skipped, unless --force is given
+// The engine compiles stale models by itself when it loads them, this is for shipping builds
+
+#include "engine/assetmanager/ModelCompiler.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct CookStats
+{
+	uint32_t			numCooked{ 0U };
+	uint32_t			numUpToDate{ 0U };
+	uint32_t			numFailed{ 0U };
+	uint64_t			numSourceBytes{ 0U };
+	uint64_t			numCompiledBytes{ 0U };
+};
+
+// ============================
+// ReadWholeFile
+// ============================
+static bool ReadWholeFile( const fs::path& path, std::vector<uint8_t>& outContents )
+{
+	std::ifstream input( path, std::ios::binary | std::ios::ate );
+	if ( !input )
+	{
+		return false;
+	}
+
+	outContents.resize( static_cast<size_t>( input.tellg() ) );
+	input.seekg( 0 );
+	input.read( reinterpret_cast<char*>( outContents.data() ), outContents.size() );
+	return static_cast<bool>( input );
+}
+
+// ============================
+// WriteWholeFile
+//
+// Written under another name first, so the engine
+// never loads a half-written compiled model
+// ============================
+static bool WriteWholeFile( const fs::path& path, const std::vector<uint8_t>& contents )
+{
+	fs::path temporaryPath = path;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream output( temporaryPath, std::ios::binary | std::ios::trunc );
+		output.write( reinterpret_cast<const char*>( contents.data() ), contents.size() );
+		if ( !output )
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	fs::rename( temporaryPath, path, error );
+	if ( error )
+	{
+		fs::remove( temporaryPath, error );
+		return false;
+	}
+
+	return true;
+}
+
+// ============================
+// CookModel
+// ============================
+static void CookModel( const fs::path& sourcePath, bool force, CookStats& stats )
+{
+	std::vector<uint8_t> source;
+	if ( !ReadWholeFile( sourcePath, source ) )
+	{
+		std::fprintf( stderr, "Cannot read '%s'\n", sourcePath.string().c_str() );
+		stats.numFailed++;
+		return;
+	}
+
+	const fs::path compiledPath = fs::path( sourcePath ).replace_extension( BtxModel::CompiledExtension );
+	std::vector<uint8_t> compiled;
+	if ( !force && ReadWholeFile( compiledPath, compiled )
+		&& !BtxModel::IsStale( compiled.data(), compiled.size(), source.data(), source.size() ) )
+	{
+		stats.numUpToDate++;
+		return;
+	}
+
+	BtxModel::TextModel model;
+	std::string error;
+	const std::string_view text( reinterpret_cast<const char*>( source.data() ), source.size() );
+	if ( !BtxModel::ParseText( text, model, error ) )
+	{
+		std::fprintf( stderr, "%s, %s\n", sourcePath.string().c_str(), error.c_str() );
+		stats.numFailed++;
+		return;
+	}
+
+	if ( model.numSkippedBlocks > 0U )
+	{
+		std::fprintf( stderr, "%s: skipped %u unsupported blocks\n", sourcePath.string().c_str(), model.numSkippedBlocks );
+	}
+
+	compiled = BtxModel::Compile( model, source.size(), ContentHash::Hash( source.data(), source.size() ) );
+	if ( !WriteWholeFile( compiledPath, compiled ) )
+	{
+		std::fprintf( stderr, "Cannot write '%s'\n", compiledPath.string().c_str() );
+		stats.numFailed++;
+		return;
+	}
+
+	stats.numCooked++;
+	stats.numSourceBytes += source.size();
+	stats.numCompiledBytes += compiled.size();
+}
+
+// ============================
+// CookPath
+// ============================
+static void CookPath( const fs::path& path, bool force, CookStats& stats )
+{
+	std::error_code error;
+	if ( !fs::is_directory( path, error ) )
+	{
+		CookModel( path, force, stats );
+		return;
+	}
+
+	for ( auto iterator = fs::recursive_directory_iterator( path, error ); iterator != fs::recursive_directory_iterator(); iterator.increment( error ) )
+	{
+		if ( error )
+		{
+			std::fprintf( stderr, "Cannot read '%s': %s\n", path.string().c_str(), error.message().c_str() );
+			stats.numFailed++;
+			return;
+		}
+
+		if ( iterator->is_regular_file() && iterator->path().extension() == BtxModel::TextExtension )
+		{
+			CookModel( iterator->path(), force, stats );
+		}
+	}
+}
+
+// ============================
+// PrintUsage
+// ============================
+static void PrintUsage()
+{
+	std::fprintf( stderr, "Usage: btxcook [--force] path...\n" );
+	std::fprintf( stderr, "       Paths are text models (%s) or directories with them\n", BtxModel::TextExtension.data() );
+}
+
+// ============================
+// main
+// ============================
+int main( int argc, char** argv )
+{
+	bool force = false;
+	std::vector<const char*> paths;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const std::string argument = argv[i];
+		if ( argument == "--force" )
+		{
+			force = true;
+		}
+		else
+		{
+			paths.push_back( argv[i] );
+		}
+	}
+
+	if ( paths.empty() )
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	CookStats stats;
+	const auto startTime = std::chrono::steady_clock::now();
+	for ( const char* path : paths )
+	{
+		CookPath( path, force, stats );
+	}
+
+	const std::chrono::duration<double> cookTime = std::chrono::steady_clock::now() - startTime;
+	std::printf( "Cooked %u models (%.1f KiB of text into %.1f KiB) in %.1f ms, %u up to date, %u failed\n",
+		stats.numCooked, stats.numSourceBytes / 1024.0, stats.numCompiledBytes / 1024.0,
+		cookTime.count() * 1000.0, stats.numUpToDate, stats.numFailed );
+
+	return stats.numFailed > 0U ? 1 : 0;
+}
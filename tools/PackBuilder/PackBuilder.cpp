@@ -0,0 +1,466 @@
+// SPDX-FileCopyrightText: 2022 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+// Bakes a directory of loose content into a pack (.btxpack)
+// Usage: btxpack [--compress none|lz4] [--block-size KiB] contentDirectory output.btxpack
+//        btxpack --benchmark contentDirectory pack.btxpack
+// Put the pack at the root of a game directory and it gets mounted
+// together with it, loose files in that directory still take priority
+// --benchmark compares reading the loose files with reading them out of the pack,
+// then checks that every file in the pack matches its loose file
+
+#include "engine/filesystem/Lz4.hpp"
+#include "engine/filesystem/PackFormat.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct InputFile
+{
+	fs::path			sourcePath;
+	// Relative to the content directory, with forward slashes
+	std::string			packPath;
+};
+
+struct PackOptions
+{
+	uint8_t				compression{ BtxPack::CompressionLz4 };
+	uint32_t			blockSize{ BtxPack::DefaultBlockSize };
+};
+
+// Compressed files have to save at least this much,
+// otherwise they're not worth decompressing
+constexpr double MinCompressionSavings = 0.05;
+
+// ============================
+// CollectFiles
+// ============================
+static bool CollectFiles( const fs::path& contentDirectory, std::vector<InputFile>& outFiles )
+{
+	std::error_code error;
+	for ( auto iterator = fs::recursive_directory_iterator( contentDirectory, error ); iterator != fs::recursive_directory_iterator(); iterator.increment( error ) )
+	{
+		if ( error )
+		{
+			std::fprintf( stderr, "Cannot read '%s': %s\n", contentDirectory.string().c_str(), error.message().c_str() );
+			return false;
+		}
+
+		// Packs inside packs wouldn't be mounted anyway
+		if ( !iterator->is_regular_file() || iterator->path().extension() == BtxPack::Extension )
+		{
+			continue;
+		}
+
+		outFiles.push_back( { iterator->path(), iterator->path().lexically_relative( contentDirectory ).generic_string() } );
+	}
+
+	// The TOC is sorted by path, it also makes the output reproducible
+	std::sort( outFiles.begin(), outFiles.end(), []( const InputFile& a, const InputFile& b )
+		{
+			return a.packPath < b.packPath;
+		} );
+
+	return true;
+}
+
+// ============================
+// WritePadding
+// ============================
+static void WritePadding( std::ofstream& file, uint64_t& offset, uint64_t alignedOffset )
+{
+	static const char zeroes[BtxPack::DataAlignment] = {};
+	file.write( zeroes, alignedOffset - offset );
+	offset = alignedOffset;
+}
+
+// ============================
+// ReadWholeFile
+// ============================
+static bool ReadWholeFile( const fs::path& path, std::vector<char>& outContents )
+{
+	std::ifstream input( path, std::ios::binary | std::ios::ate );
+	if ( !input )
+	{
+		return false;
+	}
+
+	outContents.resize( static_cast<size_t>( input.tellg() ) );
+	input.seekg( 0 );
+	input.read( outContents.data(), outContents.size() );
+	return static_cast<bool>( input );
+}
+
+// ============================
+// CompressBlocks
+// 
+// Fills outStored with the block offsets followed by the blocks,
+// returns false if it didn't get small enough to be worth it
+// ============================
+static bool CompressBlocks( const std::vector<char>& contents, uint32_t blockSize, std::vector<uint8_t>& outStored )
+{
+	const uint64_t numBlocks = BtxPack::GetNumBlocks( contents.size(), blockSize );
+	const size_t tableSize = (numBlocks + 1U) * sizeof( uint32_t );
+	std::vector<uint32_t> blockOffsets( numBlocks + 1U );
+	std::vector<uint8_t> compressedBlock( Lz4::CompressBound( blockSize ) );
+
+	outStored.assign( tableSize, 0U );
+	for ( uint64_t block = 0U; block < numBlocks; block++ )
+	{
+		const uint8_t* blockData = reinterpret_cast<const uint8_t*>( contents.data() ) + block * blockSize;
+		const size_t blockLength = std::min<size_t>( blockSize, contents.size() - block * blockSize );
+		const size_t compressedLength = Lz4::Compress( blockData, blockLength, compressedBlock.data(), compressedBlock.size() );
+
+		// A block that's as big as the original is stored as is, so they must never be confused
+		blockOffsets[block] = static_cast<uint32_t>( outStored.size() );
+		if ( compressedLength < blockLength )
+		{
+			outStored.insert( outStored.end(), compressedBlock.data(), compressedBlock.data() + compressedLength );
+		}
+		else
+		{
+			outStored.insert( outStored.end(), blockData, blockData + blockLength );
+		}
+
+		// Block offsets are 32-bit
+		if ( outStored.size() > UINT32_MAX )
+		{
+			return false;
+		}
+	}
+
+	blockOffsets[numBlocks] = static_cast<uint32_t>( outStored.size() );
+	std::memcpy( outStored.data(), blockOffsets.data(), tableSize );
+
+	return outStored.size() <= contents.size() * (1.0 - MinCompressionSavings);
+}
+
+// ============================
+// BuildPack
+// ============================
+static bool BuildPack( const std::vector<InputFile>& files, const char* outputPath, const PackOptions& options )
+{
+	std::ofstream output( outputPath, std::ios::binary | std::ios::trunc );
+	if ( !output )
+	{
+		std::fprintf( stderr, "Cannot open '%s' for writing\n", outputPath );
+		return false;
+	}
+
+	BtxPack::Header header{};
+	std::memcpy( header.magic, BtxPack::Magic, sizeof( BtxPack::Magic ) );
+	header.version = BtxPack::Version;
+	header.numEntries = static_cast<uint32_t>( files.size() );
+	header.blockSize = options.blockSize;
+
+	// The header is written again at the end, once the offsets are known
+	output.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+	uint64_t offset = sizeof( header );
+
+	std::vector<BtxPack::Entry> entries;
+	std::string strings;
+	std::vector<char> contents;
+	std::vector<uint8_t> stored;
+	uint64_t totalSize = 0U;
+	entries.reserve( files.size() );
+
+	for ( const InputFile& inputFile : files )
+	{
+		if ( !ReadWholeFile( inputFile.sourcePath, contents ) )
+		{
+			std::fprintf( stderr, "Cannot read '%s'\n", inputFile.sourcePath.string().c_str() );
+			return false;
+		}
+
+		WritePadding( output, offset, BtxPack::Align( offset ) );
+
+		BtxPack::Entry entry{};
+		entry.dataOffset = offset;
+		entry.size = contents.size();
+		entry.storedSize = contents.size();
+		entry.pathOffset = static_cast<uint32_t>( strings.size() );
+		entry.pathLength = static_cast<uint32_t>( inputFile.packPath.size() );
+		strings += inputFile.packPath;
+
+		if ( options.compression == BtxPack::CompressionLz4 && !contents.empty() && CompressBlocks( contents, options.blockSize, stored ) )
+		{
+			entry.compression = BtxPack::CompressionLz4;
+			entry.storedSize = stored.size();
+			output.write( reinterpret_cast<const char*>( stored.data() ), stored.size() );
+		}
+		else
+		{
+			output.write( contents.data(), contents.size() );
+		}
+
+		entries.push_back( entry );
+		offset += entry.storedSize;
+		totalSize += entry.size;
+	}
+
+	WritePadding( output, offset, BtxPack::Align( offset ) );
+	header.tocOffset = offset;
+	output.write( reinterpret_cast<const char*>( entries.data() ), entries.size() * sizeof( BtxPack::Entry ) );
+	offset += entries.size() * sizeof( BtxPack::Entry );
+
+	header.stringTableOffset = offset;
+	header.stringTableSize = static_cast<uint32_t>( strings.size() );
+	output.write( strings.data(), strings.size() );
+
+	output.seekp( 0 );
+	output.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+
+	if ( !output )
+	{
+		std::fprintf( stderr, "Failed writing '%s'\n", outputPath );
+		return false;
+	}
+
+	std::printf( "Packed %zu files, %.2f MiB into %.2f MiB\n", files.size(), totalSize / 1048576.0, offset / 1048576.0 );
+	return true;
+}
+
+// ============================
+// ReadPackEntry
+// 
+// PackFile::ReadEntry on a whole file, with all
+// of its blocks decompressed on this thread
+// ============================
+static bool ReadPackEntry( const BtxPack::Header& header, const BtxPack::Entry& entry, const uint8_t* packData, std::vector<uint8_t>& output, std::vector<uint8_t>& scratch )
+{
+	const uint8_t* data = packData + entry.dataOffset;
+	output.resize( entry.size );
+
+	if ( 0U == entry.size )
+	{
+		return true;
+	}
+
+	if ( entry.compression == BtxPack::CompressionNone )
+	{
+		std::memcpy( output.data(), data, entry.size );
+		return true;
+	}
+
+	const uint64_t numBlocks = BtxPack::GetNumBlocks( entry.size, header.blockSize );
+	return BtxPack::ReadBlocks( entry, header.blockSize, data, 0U, entry.size, 0U, numBlocks, output.data(), scratch );
+}
+
+// ============================
+// Benchmark
+// 
+// Single-threaded, the engine spreads blocks across
+// the job system, so it scales with the number of cores
+// Run it twice to compare with a warm OS file cache
+// Afterwards, every file in the pack is compared with its loose file
+// ============================
+static bool Benchmark( const std::vector<InputFile>& files, const char* packPath )
+{
+	using Clock = std::chrono::steady_clock;
+	const auto secondsSince = []( Clock::time_point start )
+	{
+		return std::chrono::duration<double>( Clock::now() - start ).count();
+	};
+
+	std::vector<char> contents;
+	uint64_t looseBytes = 0U;
+	const auto looseStart = Clock::now();
+	for ( const InputFile& inputFile : files )
+	{
+		if ( !ReadWholeFile( inputFile.sourcePath, contents ) )
+		{
+			std::fprintf( stderr, "Cannot read '%s'\n", inputFile.sourcePath.string().c_str() );
+			return false;
+		}
+		looseBytes += contents.size();
+	}
+	const double looseSeconds = secondsSince( looseStart );
+
+	// Reading the pack stands in for mapping it, then every file is decompressed
+	const auto packStart = Clock::now();
+	std::vector<char> pack;
+	if ( !ReadWholeFile( packPath, pack ) )
+	{
+		std::fprintf( stderr, "Cannot read '%s'\n", packPath );
+		return false;
+	}
+
+	const uint8_t* packData = reinterpret_cast<const uint8_t*>( pack.data() );
+	const BtxPack::Header* header = BtxPack::ReadHeader( packData, pack.size() );
+	if ( nullptr == header )
+	{
+		std::fprintf( stderr, "'%s' is not a valid pack of version %u\n", packPath, BtxPack::Version );
+		return false;
+	}
+
+	const auto* entries = reinterpret_cast<const BtxPack::Entry*>( packData + header->tocOffset );
+	std::vector<uint8_t> output;
+	std::vector<uint8_t> scratch;
+	uint64_t packBytes = 0U;
+	uint64_t storedBytes = 0U;
+	for ( uint32_t i = 0U; i < header->numEntries; i++ )
+	{
+		const BtxPack::Entry& entry = entries[i];
+		if ( !BtxPack::ValidateEntry( *header, entry, packData, pack.size() ) )
+		{
+			std::fprintf( stderr, "Entry %u is damaged\n", i );
+			return false;
+		}
+
+		packBytes += entry.size;
+		storedBytes += entry.storedSize;
+
+		if ( !ReadPackEntry( *header, entry, packData, output, scratch ) )
+		{
+			std::fprintf( stderr, "Entry %u has a damaged block\n", i );
+			return false;
+		}
+	}
+	const double packSeconds = secondsSince( packStart );
+
+	const auto megabytesPerSecond = []( uint64_t bytes, double seconds )
+	{
+		return bytes / 1048576.0 / std::max( seconds, 1e-9 );
+	};
+
+	std::printf( "Loose:  %zu files, %.2f MiB in %.3f s, %.1f MiB/s\n", files.size(), looseBytes / 1048576.0, looseSeconds, megabytesPerSecond( looseBytes, looseSeconds ) );
+	std::printf( "Packed: %u files, %.2f MiB (%.2f MiB stored) in %.3f s, %.1f MiB/s\n", header->numEntries,
+		packBytes / 1048576.0, storedBytes / 1048576.0, packSeconds, megabytesPerSecond( packBytes, packSeconds ) );
+
+	// Both are sorted by path
+	const char* strings = reinterpret_cast<const char*>( packData + header->stringTableOffset );
+	size_t numMatchedFiles = 0U;
+	uint32_t numMismatches = 0U;
+	for ( uint32_t i = 0U; i < header->numEntries; i++ )
+	{
+		const BtxPack::Entry& entry = entries[i];
+		const std::string_view entryPath( strings + entry.pathOffset, entry.pathLength );
+		const auto inputFile = std::lower_bound( files.begin(), files.end(), entryPath, []( const InputFile& file, std::string_view path )
+			{
+				return file.packPath < path;
+			} );
+
+		if ( inputFile == files.end() || inputFile->packPath != entryPath )
+		{
+			std::fprintf( stderr, "'%.*s' is in the pack, but not in the content directory\n", int( entryPath.size() ), entryPath.data() );
+			numMismatches++;
+			continue;
+		}
+
+		numMatchedFiles++;
+		if ( !ReadWholeFile( inputFile->sourcePath, contents ) || !ReadPackEntry( *header, entry, packData, output, scratch )
+			|| contents.size() != output.size() || std::memcmp( contents.data(), output.data(), output.size() ) != 0 )
+		{
+			std::fprintf( stderr, "'%s' in the pack differs from the loose file\n", inputFile->packPath.c_str() );
+			numMismatches++;
+		}
+	}
+
+	if ( numMatchedFiles != files.size() )
+	{
+		std::fprintf( stderr, "%zu loose files are missing from the pack\n", files.size() - numMatchedFiles );
+		numMismatches++;
+	}
+
+	if ( numMismatches > 0U )
+	{
+		return false;
+	}
+
+	std::printf( "Verified: all %u files match the loose files\n", header->numEntries );
+	return true;
+}
+
+// ============================
+// PrintUsage
+// ============================
+static void PrintUsage()
+{
+	std::fprintf( stderr, "Usage: btxpack [--compress none|lz4] [--block-size KiB] contentDirectory output%s\n", BtxPack::Extension.data() );
+	std::fprintf( stderr, "       btxpack --benchmark contentDirectory pack%s\n", BtxPack::Extension.data() );
+}
+
+// ============================
+// main
+// ============================
+int main( int argc, char** argv )
+{
+	PackOptions options;
+	bool benchmark = false;
+	std::vector<const char*> positional;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const std::string argument = argv[i];
+		if ( argument == "--benchmark" )
+		{
+			benchmark = true;
+		}
+		else if ( argument == "--compress" && i + 1 < argc )
+		{
+			const std::string method = argv[++i];
+			if ( method == "none" )
+			{
+				options.compression = BtxPack::CompressionNone;
+			}
+			else if ( method == "lz4" )
+			{
+				options.compression = BtxPack::CompressionLz4;
+			}
+			else
+			{
+				std::fprintf( stderr, "Unknown compression method '%s'\n", method.c_str() );
+				return 1;
+			}
+		}
+		else if ( argument == "--block-size" && i + 1 < argc )
+		{
+			// Blocks must fit the 32-bit offsets with room to spare
+			const long kibibytes = std::atol( argv[++i] );
+			if ( kibibytes < 1 || kibibytes > 64 * 1024 )
+			{
+				std::fprintf( stderr, "Block size must be between 1 KiB and 64 MiB\n" );
+				return 1;
+			}
+			options.blockSize = static_cast<uint32_t>( kibibytes * 1024 );
+		}
+		else
+		{
+			positional.push_back( argv[i] );
+		}
+	}
+
+	if ( positional.size() != 2U )
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<InputFile> files;
+	if ( !CollectFiles( positional[0], files ) )
+	{
+		return 1;
+	}
+
+	if ( benchmark )
+	{
+		return Benchmark( files, positional[1] ) ? 0 : 1;
+	}
+
+	if ( !BuildPack( files, positional[1], options ) )
+	{
+		return 1;
+	}
+
+	std::printf( "Wrote '%s'\n", positional[1] );
+	return 0;
+}